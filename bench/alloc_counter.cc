@@ -0,0 +1,91 @@
+#include "alloc_counter.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace pc {
+namespace bench {
+
+static std::atomic<int64_t> g_count{0};
+static std::atomic<int64_t> g_live_bytes{0};
+static std::atomic<int64_t> g_base_bytes{0};
+static std::atomic<int64_t> g_peak_bytes{0};
+
+// every block starts with its size, padded to keep the default alignment
+constexpr size_t kHeaderSize = alignof(std::max_align_t);
+
+static void *counted_alloc(size_t size) {
+  auto block = static_cast<char *>(std::malloc(size + kHeaderSize));
+
+  if (!block) {
+    throw std::bad_alloc();
+  }
+
+  *reinterpret_cast<size_t *>(block) = size;
+
+  g_count.fetch_add(1, std::memory_order_relaxed);
+
+  int64_t live = g_live_bytes.fetch_add(static_cast<int64_t>(size),
+                                        std::memory_order_relaxed) +
+                 static_cast<int64_t>(size);
+  int64_t peak = g_peak_bytes.load(std::memory_order_relaxed);
+
+  while (live > peak && !g_peak_bytes.compare_exchange_weak(
+                            peak, live, std::memory_order_relaxed)) {
+  }
+
+  return block + kHeaderSize;
+}
+
+static void counted_free(void *ptr) {
+  if (!ptr) {
+    return;
+  }
+
+  auto block = static_cast<char *>(ptr) - kHeaderSize;
+
+  g_live_bytes.fetch_sub(
+      static_cast<int64_t>(*reinterpret_cast<size_t *>(block)),
+      std::memory_order_relaxed);
+
+  std::free(block);
+}
+
+void reset_alloc_stats() {
+  int64_t live = g_live_bytes.load(std::memory_order_relaxed);
+
+  g_count.store(0, std::memory_order_relaxed);
+  g_base_bytes.store(live, std::memory_order_relaxed);
+  g_peak_bytes.store(live, std::memory_order_relaxed);
+}
+
+AllocStats alloc_stats() {
+  AllocStats stats;
+
+  stats.count = g_count.load(std::memory_order_relaxed);
+  stats.peak_bytes = g_peak_bytes.load(std::memory_order_relaxed) -
+                     g_base_bytes.load(std::memory_order_relaxed);
+
+  return stats;
+}
+
+} // namespace bench
+} // namespace pc
+
+void *operator new(size_t size) { return pc::bench::counted_alloc(size); }
+
+void *operator new[](size_t size) { return pc::bench::counted_alloc(size); }
+
+void operator delete(void *ptr) noexcept { pc::bench::counted_free(ptr); }
+
+void operator delete[](void *ptr) noexcept { pc::bench::counted_free(ptr); }
+
+void operator delete(void *ptr, size_t) noexcept {
+  pc::bench::counted_free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept {
+  pc::bench::counted_free(ptr);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+namespace pc {
+namespace bench {
+
+/**
+ * Heap activity since the last reset_alloc_stats(), recorded by the global
+ * operator new and operator delete of the benchmark binary
+ */
+struct AllocStats {
+  int64_t count = 0;
+  // highest live heap size above the size at reset
+  int64_t peak_bytes = 0;
+};
+
+void reset_alloc_stats();
+
+AllocStats alloc_stats();
+
+} // namespace bench
+} // namespace pc
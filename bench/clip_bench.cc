@@ -0,0 +1,140 @@
+#include "alloc_counter.hpp"
+#include "polygon_clip.hpp"
+#include "shapes.hpp"
+
+#include <benchmark/benchmark.h>
+
+namespace pc {
+namespace bench {
+
+static Polygon run_op(BoolOp op, const Polygon &subject,
+                      const Polygon &clipping, Degeneracy degeneracy) {
+  switch (op) {
+  case BoolOp::kClip:
+    return Polygon::Clip(subject, clipping, degeneracy);
+  case BoolOp::kUnion:
+    return Polygon::Union(subject, clipping, degeneracy);
+  case BoolOp::kDiff:
+    return Polygon::Diff(subject, clipping, degeneracy);
+  }
+
+  return Polygon();
+}
+
+/**
+ * Time op on the two polygons and report time per input vertex, heap
+ * allocations per operation and the peak heap size above the inputs
+ */
+static void measure(benchmark::State &state, BoolOp op, const Polygon &subject,
+                    const Polygon &clipping,
+                    Degeneracy degeneracy = Degeneracy::kPerturb) {
+  uint32_t input = vertex_count(subject) + vertex_count(clipping);
+  uint32_t output = 0;
+
+  reset_alloc_stats();
+
+  for (auto _ : state) {
+    auto result = run_op(op, subject, clipping, degeneracy);
+
+    output = vertex_count(result);
+    benchmark::DoNotOptimize(result);
+  }
+
+  auto stats = alloc_stats();
+
+  state.counters["time/vertex"] =
+      benchmark::Counter(input, benchmark::Counter::kIsIterationInvariantRate |
+                                    benchmark::Counter::kInvert);
+  state.counters["allocs"] = benchmark::Counter(
+      static_cast<double>(stats.count), benchmark::Counter::kAvgIterations);
+  state.counters["peak_mem"] =
+      benchmark::Counter(static_cast<double>(stats.peak_bytes),
+                         benchmark::Counter::kDefaults,
+                         benchmark::Counter::OneK::kIs1024);
+  state.counters["out_vertices"] = output;
+}
+
+static BoolOp op_arg(const benchmark::State &state, int index) {
+  return static_cast<BoolOp>(state.range(index));
+}
+
+/**
+ * Two random stars around the same center, the second one turned by half a
+ * spike, so every spike crosses its two neighbours
+ */
+static void BM_Star(benchmark::State &state) {
+  auto spikes = static_cast<uint32_t>(state.range(0) / 2);
+  auto degeneracy = state.range(2) ? Degeneracy::kSymbolic
+                                   : Degeneracy::kPerturb;
+
+  float half_spike = 1.5707963f / spikes;
+
+  auto subject = random_star(spikes, Point(0.f, 0.f), 800.f, 1000.f, 1);
+  auto clipping =
+      random_star(spikes, Point(0.f, 0.f), 800.f, 1000.f, 2, half_spike);
+
+  measure(state, op_arg(state, 1), subject, clipping, degeneracy);
+}
+
+/**
+ * Two overlapping circles, only two crossings whatever the vertex count
+ */
+static void BM_Ngon(benchmark::State &state) {
+  auto count = static_cast<uint32_t>(state.range(0));
+
+  auto subject = regular_ngon(count, Point(0.f, 0.f), 1000.f);
+  auto clipping = regular_ngon(count, Point(500.f, 0.f), 1000.f, 0.1f);
+
+  measure(state, op_arg(state, 1), subject, clipping);
+}
+
+/**
+ * Comb against the same comb turned by 90 degrees, teeth * teeth crossings
+ * from only 8 * teeth vertices
+ */
+static void BM_Comb(benchmark::State &state) {
+  auto teeth = static_cast<uint32_t>(state.range(0));
+
+  auto subject = comb(teeth, Point(0.f, 0.f), 1000.f, 1000.f);
+  auto clipping = comb(teeth, Point(0.5f, 0.5f), 1000.f, 1000.f, true);
+
+  measure(state, op_arg(state, 1), subject, clipping);
+}
+
+/**
+ * Square with holes x holes holes against a star covering part of it
+ */
+static void BM_GridOfHoles(benchmark::State &state) {
+  auto holes = static_cast<uint32_t>(state.range(0));
+
+  auto subject = grid_of_holes(holes, Point(-1000.f, -1000.f), 2000.f);
+  auto clipping = random_star(64, Point(300.f, 200.f), 600.f, 900.f, 3);
+
+  measure(state, op_arg(state, 1), subject, clipping);
+}
+
+// op: 0 clip, 1 union, 2 diff
+BENCHMARK(BM_Star)
+    ->ArgNames({"vertices", "op", "symbolic"})
+    ->ArgsProduct({benchmark::CreateRange(64, 8 << 10, 8), {0, 1, 2}, {0, 1}})
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(BM_Ngon)
+    ->ArgNames({"vertices", "op"})
+    ->ArgsProduct({benchmark::CreateRange(64, 64 << 10, 8), {0, 1, 2}})
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(BM_Comb)
+    ->ArgNames({"teeth", "op"})
+    ->ArgsProduct({benchmark::CreateRange(4, 256, 4), {0, 1, 2}})
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(BM_GridOfHoles)
+    ->ArgNames({"holes", "op"})
+    ->ArgsProduct({{1, 4, 16, 64}, {0, 1, 2}})
+    ->Unit(benchmark::kMicrosecond);
+
+} // namespace bench
+} // namespace pc
+
+BENCHMARK_MAIN();
@@ -0,0 +1,134 @@
+#include "shapes.hpp"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace pc {
+namespace bench {
+
+constexpr float kPi = 3.14159265358979f;
+
+Polygon random_star(uint32_t count, Point center, float inner, float outer,
+                    uint32_t seed, float angle) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> radius(inner, outer);
+
+  std::vector<Point> points;
+  points.reserve(count * 2);
+
+  for (uint32_t i = 0; i < count * 2; i++) {
+    float a = angle + kPi * i / count;
+    // spike tips alternate with points on the inner circle
+    float r = (i % 2 == 0) ? radius(rng) : inner * 0.5f;
+
+    points.emplace_back(center.x + r * std::cos(a),
+                        center.y + r * std::sin(a));
+  }
+
+  Polygon polygon;
+  polygon.append_vertices(points);
+
+  return polygon;
+}
+
+Polygon regular_ngon(uint32_t count, Point center, float radius, float angle) {
+  std::vector<Point> points;
+  points.reserve(count);
+
+  for (uint32_t i = 0; i < count; i++) {
+    float a = angle + 2.f * kPi * i / count;
+
+    points.emplace_back(center.x + radius * std::cos(a),
+                        center.y + radius * std::sin(a));
+  }
+
+  Polygon polygon;
+  polygon.append_vertices(points);
+
+  return polygon;
+}
+
+Polygon comb(uint32_t teeth, Point left_top, float width, float height,
+             bool rotated) {
+  float pitch = width / teeth;
+  float spine = height * 0.1f;
+
+  std::vector<Point> points;
+  points.reserve(teeth * 4 + 2);
+
+  // spine along the top edge, teeth hang down to height
+
+  points.emplace_back(0.f, 0.f);
+  points.emplace_back(width, 0.f);
+
+  for (uint32_t i = teeth; i > 0; i--) {
+    float right = pitch * i;
+    float left = right - pitch * 0.5f;
+
+    points.emplace_back(right, height);
+    points.emplace_back(left, height);
+    points.emplace_back(left, spine);
+    points.emplace_back(left - pitch * 0.5f, spine);
+  }
+
+  for (auto &p : points) {
+    p = rotated ? Point(left_top.x + p.y, left_top.y + p.x)
+                : Point(left_top.x + p.x, left_top.y + p.y);
+  }
+
+  Polygon polygon;
+  polygon.append_vertices(points);
+
+  return polygon;
+}
+
+Polygon grid_of_holes(uint32_t holes, Point left_top, float size) {
+  Polygon polygon;
+
+  polygon.append_vertices({
+      Point(left_top.x, left_top.y),
+      Point(left_top.x + size, left_top.y),
+      Point(left_top.x + size, left_top.y + size),
+      Point(left_top.x, left_top.y + size),
+  });
+
+  float cell = size / holes;
+  float margin = cell * 0.25f;
+
+  for (uint32_t i = 0; i < holes; i++) {
+    for (uint32_t j = 0; j < holes; j++) {
+      float l = left_top.x + cell * i + margin;
+      float t = left_top.y + cell * j + margin;
+      float r = l + cell - margin * 2.f;
+      float b = t + cell - margin * 2.f;
+
+      // holes run the other way round
+      polygon.append_vertices({
+          Point(l, t),
+          Point(l, b),
+          Point(r, b),
+          Point(r, t),
+      });
+    }
+  }
+
+  return polygon;
+}
+
+uint32_t vertex_count(const Polygon &polygon) {
+  uint32_t count = 0;
+
+  for (auto head : polygon.get_vertices()) {
+    auto v = head;
+    do {
+      count++;
+      v = v->next;
+    } while (v != head);
+  }
+
+  return count;
+}
+
+} // namespace bench
+} // namespace pc
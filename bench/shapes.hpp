@@ -0,0 +1,43 @@
+#pragma once
+
+#include "polygon_clip.hpp"
+
+#include <cstdint>
+
+namespace pc {
+namespace bench {
+
+/**
+ * Star with count spikes around center, rotated by angle radians. The radius
+ * of every spike tip is picked at random between inner and outer radius. Same
+ * seed, same shape.
+ */
+Polygon random_star(uint32_t count, Point center, float inner, float outer,
+                    uint32_t seed, float angle = 0.f);
+
+/**
+ * Regular polygon with count corners on a circle, rotated by angle radians
+ */
+Polygon regular_ngon(uint32_t count, Point center, float radius,
+                     float angle = 0.f);
+
+/**
+ * Comb with teeth pointing down, spread over width. Crossing it with a comb
+ * rotated by 90 degrees gives about teeth * teeth intersections.
+ */
+Polygon comb(uint32_t teeth, Point left_top, float width, float height,
+             bool rotated = false);
+
+/**
+ * Square of size with a holes x holes grid of square holes, one ring for the
+ * outline and one for each hole
+ */
+Polygon grid_of_holes(uint32_t holes, Point left_top, float size);
+
+/**
+ * Total vertex count of all rings
+ */
+uint32_t vertex_count(const Polygon &polygon);
+
+} // namespace bench
+} // namespace pc
@@ -1,102 +1,1106 @@
 #pragma once
 
 #include <algorithm>
+#include <cstdint>
+#include <cstdio>
 #include <memory>
 #include <optional>
+#include <string>
 #include <vector>
 
 namespace pc {
 
+/**
+ * Coordinates are float by default. Every type below is a template over the
+ * coordinate type and is instantiated for float, double and int32_t, the
+ * double variants carry a D suffix and the integer variants an I suffix.
+ *
+ * Integer coordinates must lie within [-2^30, 2^30], append_vertices() and
+ * the operations on views throw std::out_of_range for any outside it. Their
+ * predicates are exact, degeneracies are always resolved as with
+ * Degeneracy::kSymbolic and intersection points are rounded to the nearest
+ * grid point.
+ */
 using Scalar = float;
 
-struct Point {
-  Scalar x = {};
-  Scalar y = {};
+template <typename T> struct BasicPoint {
+  T x = {};
+  T y = {};
 
-  Point() = default;
-  Point(Scalar x, Scalar y) : x(x), y(y) {}
+  BasicPoint() = default;
+  BasicPoint(T x, T y) : x(x), y(y) {}
 
-  Point(const Point &) = default;
-  Point &operator=(const Point &) = default;
+  BasicPoint(const BasicPoint &) = default;
+  BasicPoint &operator=(const BasicPoint &) = default;
 };
 
-struct Vertex {
-  Point point = {};
+template <typename T> struct BasicRect {
+  BasicPoint<T> left_top = {};
+  BasicPoint<T> right_bottom = {};
+
+  BasicRect() = default;
+  BasicRect(BasicPoint<T> left_top, BasicPoint<T> right_bottom)
+      : left_top(left_top), right_bottom(right_bottom) {}
+
+  bool overlaps(const BasicRect &other) const {
+    return left_top.x <= other.right_bottom.x &&
+           other.left_top.x <= right_bottom.x &&
+           left_top.y <= other.right_bottom.y &&
+           other.left_top.y <= right_bottom.y;
+  }
+};
+
+template <typename T> struct BasicVertex {
+  BasicPoint<T> point = {};
   // double linked list in polygon
-  Vertex *prev = nullptr;
-  Vertex *next = nullptr;
+  BasicVertex *prev = nullptr;
+  BasicVertex *next = nullptr;
   // state during sweep and mark
   bool intersect = false;
   bool entry_exit = false;
   bool marked = false;
   // pointer to neighbour in subject or clip polygon
-  Vertex *neighbour = nullptr;
+  BasicVertex *neighbour = nullptr;
 
-  Vertex() = default;
+  BasicVertex() = default;
 
-  Vertex(Point point) : point(std::move(point)) {}
+  BasicVertex(BasicPoint<T> point) : point(std::move(point)) {}
 
-  Vertex(const Vertex &) = default;
-  Vertex &operator=(const Vertex &) = default;
+  BasicVertex(const BasicVertex &) = default;
+  BasicVertex &operator=(const BasicVertex &) = default;
 };
 
-class Polygon {
-  friend class ClipAlgorithm;
+/**
+ * Chunked storage for vertices.
+ *
+ * Vertices are placed contiguously inside chunks and never move once
+ * allocated, so the raw pointers used by the linked lists stay valid. All
+ * vertices are released together with the arena.
+ */
+template <typename T> class BasicVertexArena {
+public:
+  using Point = BasicPoint<T>;
+  using Vertex = BasicVertex<T>;
+
+  BasicVertexArena() = default;
+  ~BasicVertexArena() = default;
+
+  BasicVertexArena(const BasicVertexArena &) = delete;
+  BasicVertexArena &operator=(const BasicVertexArena &) = delete;
+
+  // the moved from arena is left empty
+  BasicVertexArena(BasicVertexArena &&other) noexcept;
+  BasicVertexArena &operator=(BasicVertexArena &&other) noexcept;
+
+  /**
+   * Make sure the next count allocations are placed in the same chunk
+   */
+  void reserve(size_t count);
+
+  Vertex *allocate(const Point &p);
+
+  /**
+   * Take over all chunks of other, vertices in other keep their address
+   */
+  void merge(BasicVertexArena &&other);
+
+  /**
+   * Drop all vertices but keep the chunks, later allocations fill them again
+   */
+  void clear();
+
+  size_t size() const { return m_size; }
+
+  size_t capacity() const { return m_capacity; }
+
+  /**
+   * Visit all allocated vertices in allocation order
+   */
+  template <typename F> void for_each(F &&func) const {
+    for (const auto &chunk : m_chunks) {
+      for (size_t i = 0; i < chunk.size; i++) {
+        func(&chunk.data[i]);
+      }
+    }
+  }
+
+private:
+  struct Chunk {
+    std::unique_ptr<Vertex[]> data = {};
+    size_t size = 0;
+    size_t capacity = 0;
+  };
+
+  std::vector<Chunk> m_chunks = {};
+  // chunk new vertices are placed in, earlier chunks are only filled again
+  // after clear
+  size_t m_current = 0;
+  size_t m_size = 0;
+  size_t m_capacity = 0;
+};
+
+enum class BoolOp {
+  kClip,
+  kUnion,
+  kDiff,
+};
+
+/**
+ * How vertices lying exactly on an edge of the other polygon are resolved.
+ */
+enum class Degeneracy {
+  // move such a vertex a little along its edge inside the working copy,
+  // results depend on the order in which edge pairs are tested
+  kPerturb,
+  // decide with exact orientation tests as if the clipping polygon was moved
+  // by an infinitely small offset, no vertex is ever written
+  kSymbolic,
+};
+
+/**
+ * Which points are inside a polygon whose rings overlap or self-intersect.
+ */
+enum class FillRule {
+  // inside if a ray from the point crosses the boundary an odd number of times
+  kEvenOdd,
+  // inside if the boundary winds around the point a nonzero number of times
+  kNonZero,
+};
+
+/**
+ * Shape of one ring of a polygon, classified when the ring is added.
+ */
+struct RingShape {
+  // 1 if the ring runs counter-clockwise when y points up, -1 if clockwise
+  // and 0 if it encloses no area
+  int8_t orientation = 0;
+  // every turn goes the same way and the ring winds around its inside once,
+  // repeated and collinear vertices are allowed
+  bool convex = false;
+};
+
+/**
+ * Counters and phase timings of one Boolean operation.
+ *
+ * Only collected when the library is built with PC_ENABLE_STATS, otherwise the
+ * object handed to an operation is left untouched. Bytes cover the working
+ * copies, the sweep edge lists and the result, short lived temporaries of the
+ * result walk are not counted.
+ */
+struct ClipStats {
+  // edge pairs with overlapping bounding boxes handed to the segment test
+  uint64_t pair_tests = 0;
+  uint64_t intersections = 0;
+  // edge pairs of one input crossing or touching, only searched for when the
+  // operation was given a FillRule
+  uint64_t self_intersections = 0;
+  // vertices moved by Degeneracy::kPerturb
+  uint64_t perturbations = 0;
+  // vertices of the working copies and of the result
+  uint64_t vertices_allocated = 0;
+  uint64_t bytes_allocated = 0;
+  // wall time of each phase in nanoseconds
+  uint64_t setup_ns = 0;
+  uint64_t fill_ns = 0;
+  uint64_t intersection_ns = 0;
+  uint64_t mark_ns = 0;
+  uint64_t walk_ns = 0;
+
+  /**
+   * True if the library was built with PC_ENABLE_STATS
+   */
+  static bool enabled();
+};
+
+template <typename T> class EdgeIndex;
+
+/**
+ * Polygon over coordinate buffers owned by the caller.
+ *
+ * Nothing is copied, the buffers may be memory-mapped and must stay alive and
+ * unchanged while the view is in use. Vertex i has x at coords[i * stride]
+ * and y at coords[i * stride + 1], so interleaved pairs use a stride of 2 and
+ * records carrying more values per vertex a larger one. Ring r owns vertices
+ * [ring_offsets[r], ring_offsets[r + 1]), so ring_offsets holds
+ * ring_count + 1 entries. Rings are closed implicitly and, as with
+ * append_vertices(), rings of fewer than three vertices are skipped.
+ */
+template <typename T> struct BasicPolygonView {
+  using Point = BasicPoint<T>;
+  using Rect = BasicRect<T>;
+
+  const T *coords = nullptr;
+  const uint32_t *ring_offsets = nullptr;
+  size_t ring_count = 0;
+  size_t stride = 2;
+  // edge index over the vertices, used as the one of build_index. Set by
+  // BasicPolygonFile::indexed_view, views made by hand leave it empty.
+  std::shared_ptr<const EdgeIndex<T>> index = {};
+
+  BasicPolygonView() = default;
+  BasicPolygonView(const T *coords, const uint32_t *ring_offsets,
+                   size_t ring_count, size_t stride = 2)
+      : coords(coords), ring_offsets(ring_offsets), ring_count(ring_count),
+        stride(stride) {}
+
+  size_t vertex_count() const {
+    return ring_count == 0 ? 0 : ring_offsets[ring_count];
+  }
+
+  size_t ring_size(size_t ring) const {
+    return ring_offsets[ring + 1] - ring_offsets[ring];
+  }
+
+  Point point(size_t i) const {
+    return Point(coords[i * stride], coords[i * stride + 1]);
+  }
+
+  /**
+   * Bounding box of the rings which are not skipped, computed on each call
+   */
+  std::optional<Rect> get_bounds() const;
+};
+
+template <typename T> class BasicPolygon;
+
+/**
+ * Result of a Boolean operation as flat arrays, ready for rendering or
+ * serialization.
+ *
+ * Vertex i is at (coords[2 * i], coords[2 * i + 1]) and ring r owns vertices
+ * [ring_offsets[r], ring_offsets[r + 1]). Operations writing into a buffer
+ * replace its content and keep its memory, so a buffer reused for a series of
+ * operations stops allocating once it has grown large enough.
+ */
+template <typename T> struct BasicPolygonBuffer {
+  using Point = BasicPoint<T>;
+
+  std::vector<T> coords = {};
+  std::vector<uint32_t> ring_offsets = {0};
+
+  size_t ring_count() const { return ring_offsets.size() - 1; }
+
+  size_t vertex_count() const { return ring_offsets.back(); }
+
+  Point point(size_t i) const {
+    return Point(coords[2 * i], coords[2 * i + 1]);
+  }
+
+  /**
+   * Remove all rings, the memory is kept
+   */
+  void clear() {
+    coords.clear();
+    ring_offsets.assign(1, 0);
+  }
+
+  /**
+   * Append the rings of polygon
+   */
+  void append(const BasicPolygon<T> &polygon);
+
+  /**
+   * View over the arrays, valid until the buffer is changed
+   */
+  BasicPolygonView<T> view() const {
+    return BasicPolygonView<T>(coords.data(), ring_offsets.data(),
+                               ring_count());
+  }
+};
+
+template <typename T> class ClipAlgorithm;
+template <typename T> class UnionMerger;
+template <typename T> class ConvexClipper;
+template <typename T> class ResultSink;
+template <typename T> struct ClipWorkspace;
+template <typename T> class BasicClipContext;
+
+template <typename T> class BasicPolygon {
+  template <typename> friend class ClipAlgorithm;
+  template <typename> friend class UnionMerger;
+  template <typename> friend class ConvexClipper;
+  template <typename> friend class ResultSink;
 
 public:
-  Polygon() = default;
-  ~Polygon() = default;
+  using Point = BasicPoint<T>;
+  using Rect = BasicRect<T>;
+  using Vertex = BasicVertex<T>;
+
+  BasicPolygon() = default;
+  ~BasicPolygon() = default;
 
   // copy is depth clone
-  Polygon(const Polygon &other);
+  BasicPolygon(const BasicPolygon &other);
   // merge two polygon with depth clone
-  Polygon(const Polygon &p1, const Polygon &p2, bool pr_reserve = false);
+  BasicPolygon(const BasicPolygon &p1, const BasicPolygon &p2,
+               bool pr_reserve = false);
+
+  // move keeps all vertices in place
+  BasicPolygon(BasicPolygon &&other) = default;
+  BasicPolygon &operator=(BasicPolygon &&other) = default;
+  // merge two polygon by taking over their vertices, no vertex is copied
+  BasicPolygon(BasicPolygon &&p1, BasicPolygon &&p2, bool p2_reverse = false);
 
   /**
    * Append a closed shape into this polygon
    *
+   * Integer coordinates outside [-2^30, 2^30] throw std::out_of_range and
+   * leave the polygon unchanged.
    */
   void append_vertices(const std::vector<Point> &points);
 
+  /**
+   * Append every ring of view, a copy for callers needing a Polygon
+   */
+  void append_vertices(const BasicPolygonView<T> &view);
+
   const std::vector<Vertex *> &get_vertices() const { return m_sub_polygons; }
 
-  bool contains(const Point &p) const;
+  /**
+   * Remove all rings, the memory is kept for the vertices appended later
+   */
+  void clear();
+
+  /**
+   * Bounding box of all vertices, empty if this polygon has no vertex
+   */
+  std::optional<Rect> get_bounds() const;
+
+  /**
+   * Bounding box of each sub polygon, same order as get_vertices()
+   */
+  const std::vector<Rect> &get_sub_bounds() const { return m_sub_bounds; }
+
+  /**
+   * Shape of each sub polygon, same order as get_vertices()
+   */
+  const std::vector<RingShape> &get_sub_shapes() const {
+    return m_sub_shapes;
+  }
+
+  /**
+   * Whether p is inside under rule, kEvenOdd matches the Boolean operations
+   * run without a FillRule
+   */
+  bool contains(const Point &p, FillRule rule = FillRule::kEvenOdd) const;
+
+  /**
+   * Build a spatial index over the edges of this polygon.
+   * The index is kept until append_vertices modifies the polygon and is
+   * shared by copies. Once built, contains() and every Boolean operation this
+   * polygon takes part in query it instead of scanning all edges, which pays
+   * off for polygons reused against many others.
+   * Not thread safe, build it before sharing the polygon between threads.
+   */
+  void build_index() const;
+
+  bool has_index() const { return m_index != nullptr; }
 
   /**
    * Doing clip operation on subject, and output the subpolygon inside clipping
    *
-   * @subject   polygon need to be clipped
-   * @clipping  clip boundary for this clip operator
+   * @subject     polygon need to be clipped
+   * @clipping    clip boundary for this clip operator
+   * @degeneracy  how vertices on the boundary of the other polygon are
+   *              handled, ignored for integer coordinates
+   * @stats       if set, filled with the counters of this operation
+   */
+  static BasicPolygon Clip(const BasicPolygon &subject,
+                           const BasicPolygon &clipping,
+                           Degeneracy degeneracy = Degeneracy::kPerturb,
+                           ClipStats *stats = nullptr);
+
+  /**
+   * Clip one subject against many clipping windows.
+   * The subject is prepared once and shared by all windows, axis-aligned
+   * rectangle windows take a faster path. Integer coordinates run one full
+   * clip per window.
+   *
+   * @subject     polygon need to be clipped
+   * @clippings   clip boundaries
+   * @degeneracy  how vertices on the boundary of the other polygon are
+   *              handled, ignored for integer coordinates
+   *
+   * @return one result for each clipping, in the same order
+   */
+  static std::vector<BasicPolygon>
+  Clip(const BasicPolygon &subject, const std::vector<BasicPolygon> &clippings,
+       Degeneracy degeneracy = Degeneracy::kPerturb);
+
+  /**
+   * Clip subject against the axis-aligned rectangle from min to max.
+   * Each ring is streamed once through the four sides and the parts inside
+   * are joined along the boundary, without the intersection search of Clip.
+   * The region is the same as Clip with the rectangle as clipping polygon,
+   * rings must not cross themselves.
    */
-  static Polygon Clip(const Polygon &subject, const Polygon &clipping);
+  static BasicPolygon ClipRect(const BasicPolygon &subject, const Point &min,
+                               const Point &max);
 
   /**
    * Doing union on subject and clipping.
    *
    */
-  static Polygon Union(const Polygon &subject, const Polygon &clipping);
+  static BasicPolygon Union(const BasicPolygon &subject,
+                            const BasicPolygon &clipping,
+                            Degeneracy degeneracy = Degeneracy::kPerturb,
+                            ClipStats *stats = nullptr);
 
   /**
    * Calculate the area inside subject but not in clipping
    *
    *
    */
-  static Polygon Diff(const Polygon &subject, const Polygon &clipping);
+  static BasicPolygon Diff(const BasicPolygon &subject,
+                           const BasicPolygon &clipping,
+                           Degeneracy degeneracy = Degeneracy::kPerturb,
+                           ClipStats *stats = nullptr);
+
+  /**
+   * Same as above but consume the inputs.
+   * When there is no intersection the result is built from the input
+   * vertices directly instead of copying them.
+   */
+  static BasicPolygon Clip(BasicPolygon &&subject, BasicPolygon &&clipping,
+                           Degeneracy degeneracy = Degeneracy::kPerturb,
+                           ClipStats *stats = nullptr);
+
+  static BasicPolygon Union(BasicPolygon &&subject, BasicPolygon &&clipping,
+                            Degeneracy degeneracy = Degeneracy::kPerturb,
+                            ClipStats *stats = nullptr);
+
+  static BasicPolygon Diff(BasicPolygon &&subject, BasicPolygon &&clipping,
+                           Degeneracy degeneracy = Degeneracy::kPerturb,
+                           ClipStats *stats = nullptr);
+
+  /**
+   * Clip, Union and Diff reading both inputs straight from caller-owned
+   * buffers. The working copies of the intersection search are filled from
+   * the views, no polygon is built for either input. Inputs are never taken
+   * as convex windows and no edge index is used.
+   */
+  static BasicPolygon Clip(const BasicPolygonView<T> &subject,
+                           const BasicPolygonView<T> &clipping,
+                           Degeneracy degeneracy = Degeneracy::kPerturb,
+                           ClipStats *stats = nullptr);
+
+  static BasicPolygon Union(const BasicPolygonView<T> &subject,
+                            const BasicPolygonView<T> &clipping,
+                            Degeneracy degeneracy = Degeneracy::kPerturb,
+                            ClipStats *stats = nullptr);
+
+  static BasicPolygon Diff(const BasicPolygonView<T> &subject,
+                           const BasicPolygonView<T> &clipping,
+                           Degeneracy degeneracy = Degeneracy::kPerturb,
+                           ClipStats *stats = nullptr);
+
+  /**
+   * Clip, Union and Diff writing the result walk straight into a flat
+   * buffer, no polygon is built for the result. result is replaced.
+   */
+  static void Clip(const BasicPolygon &subject, const BasicPolygon &clipping,
+                   BasicPolygonBuffer<T> &result,
+                   Degeneracy degeneracy = Degeneracy::kPerturb,
+                   ClipStats *stats = nullptr);
+
+  static void Union(const BasicPolygon &subject, const BasicPolygon &clipping,
+                    BasicPolygonBuffer<T> &result,
+                    Degeneracy degeneracy = Degeneracy::kPerturb,
+                    ClipStats *stats = nullptr);
+
+  static void Diff(const BasicPolygon &subject, const BasicPolygon &clipping,
+                   BasicPolygonBuffer<T> &result,
+                   Degeneracy degeneracy = Degeneracy::kPerturb,
+                   ClipStats *stats = nullptr);
+
+  static void Clip(const BasicPolygonView<T> &subject,
+                   const BasicPolygonView<T> &clipping,
+                   BasicPolygonBuffer<T> &result,
+                   Degeneracy degeneracy = Degeneracy::kPerturb,
+                   ClipStats *stats = nullptr);
+
+  static void Union(const BasicPolygonView<T> &subject,
+                    const BasicPolygonView<T> &clipping,
+                    BasicPolygonBuffer<T> &result,
+                    Degeneracy degeneracy = Degeneracy::kPerturb,
+                    ClipStats *stats = nullptr);
+
+  static void Diff(const BasicPolygonView<T> &subject,
+                   const BasicPolygonView<T> &clipping,
+                   BasicPolygonBuffer<T> &result,
+                   Degeneracy degeneracy = Degeneracy::kPerturb,
+                   ClipStats *stats = nullptr);
+
+  /**
+   * Union of many simple polygons.
+   * The inputs are ordered along a Hilbert curve through their bounding boxes
+   * and merged pairwise along a binary tree, every level of the tree runs on
+   * a thread pool. A merge only processes the rings whose bounding boxes touch
+   * a ring of the other side, groups lying apart are simply concatenated.
+   * The workers also split the intersection search of the final merge, which
+   * therefore always resolves degeneracies as with Degeneracy::kSymbolic.
+   *
+   * @polygons      polygons to merge, only read
+   * @thread_count  number of worker threads, 0 means one per hardware thread
+   */
+  static BasicPolygon UnionAll(const std::vector<BasicPolygon> &polygons,
+                               uint32_t thread_count = 0,
+                               Degeneracy degeneracy = Degeneracy::kPerturb);
+
+  /**
+   * Clip, Union and Diff of inputs whose rings may cross themselves and each
+   * other, the inside of each input is decided by fill_rule. Each input is
+   * first rebuilt into rings which at most touch at vertices, outer rings
+   * counter-clockwise and holes clockwise when y points up, so callers need no
+   * clean up pass of their own.
+   */
+  static BasicPolygon Clip(const BasicPolygon &subject,
+                           const BasicPolygon &clipping, FillRule fill_rule,
+                           Degeneracy degeneracy = Degeneracy::kPerturb,
+                           ClipStats *stats = nullptr);
+
+  static BasicPolygon Union(const BasicPolygon &subject,
+                            const BasicPolygon &clipping, FillRule fill_rule,
+                            Degeneracy degeneracy = Degeneracy::kPerturb,
+                            ClipStats *stats = nullptr);
+
+  static BasicPolygon Diff(const BasicPolygon &subject,
+                           const BasicPolygon &clipping, FillRule fill_rule,
+                           Degeneracy degeneracy = Degeneracy::kPerturb,
+                           ClipStats *stats = nullptr);
+
+  /**
+   * Clip, Union and Diff run with the scratch memory of context, see
+   * BasicClipContext. The result is owned by context and stays valid until
+   * its next operation.
+   */
+  static const BasicPolygon &Clip(const BasicPolygon &subject,
+                                  const BasicPolygon &clipping,
+                                  BasicClipContext<T> &context);
+
+  static const BasicPolygon &Union(const BasicPolygon &subject,
+                                   const BasicPolygon &clipping,
+                                   BasicClipContext<T> &context);
+
+  static const BasicPolygon &Diff(const BasicPolygon &subject,
+                                  const BasicPolygon &clipping,
+                                  BasicClipContext<T> &context);
 
 private:
-  Vertex *allocate_vertex(const Point &p);
+  void append_polygon(const BasicPolygon &other, bool reverse);
+
+  /**
+   * Copy ring of other with its bounds and shape
+   */
+  void append_ring(const BasicPolygon &other, size_t ring, bool reverse);
+
+  void append_ring(const BasicPolygonView<T> &view, size_t ring, bool reverse);
 
-  Vertex *allocate_vertex(Vertex *p1, Vertex *p2, float t);
+  void expand_bounds(const Rect &bounds);
 
 private:
   // polygon lists
   // a complex polygon may contains many sub closed polygon
   std::vector<Vertex *> m_sub_polygons = {};
-  // just a list to store all allocated vertices
-  std::vector<std::unique_ptr<Vertex>> m_vertex = {};
+  // bounding box of each sub polygon
+  std::vector<Rect> m_sub_bounds = {};
+  // convexity and orientation of each sub polygon
+  std::vector<RingShape> m_sub_shapes = {};
+  // storage of all allocated vertices
+  BasicVertexArena<T> m_vertex = {};
 
   std::optional<Point> m_left_top = {};
   std::optional<Point> m_right_bottom = {};
+
+  // built on request by build_index, immutable once built
+  mutable std::shared_ptr<const EdgeIndex<T>> m_index = {};
+};
+
+/**
+ * Point in polygon queries against a fixed polygon.
+ *
+ * The edges are copied once into a segment tree over thin horizontal bands.
+ * An edge is stored whole at the few nodes whose bands it fully crosses,
+ * sorted by x with suffix sums of their direction, and only the bands holding
+ * its end points test it one by one. A query walks from its band up to the
+ * root, so it costs O(log^2 n) for polygons whose edges rarely overlap in x.
+ * Later changes to the polygon are not seen. Points on the boundary may be
+ * reported either way.
+ */
+template <typename T> class BasicPreparedPolygon {
+public:
+  using Point = BasicPoint<T>;
+  using Polygon = BasicPolygon<T>;
+
+  explicit BasicPreparedPolygon(const Polygon &polygon);
+  ~BasicPreparedPolygon() = default;
+
+  /**
+   * Signed number of times the boundary winds around p, counter-clockwise
+   * rings count positive when y points up
+   */
+  int32_t winding(const Point &p) const;
+
+  bool contains(const Point &p, FillRule rule = FillRule::kEvenOdd) const;
+
+  /**
+   * Test count points at once, inside[i] is the answer for points[i]
+   */
+  void contains(const Point *points, size_t count, bool *inside,
+                FillRule rule = FillRule::kEvenOdd) const;
+
+private:
+  struct Node {
+    // edges [full_begin, full_end) cross every band below the node and are
+    // sorted by x_min
+    uint32_t full_begin = 0;
+    uint32_t full_end = 0;
+    // widest x-range of these edges
+    double full_width = 0;
+  };
+
+  uint32_t band_of(T y) const;
+
+  /**
+   * Direction of edge k if it crosses the ray from p towards +x, else 0
+   */
+  int32_t crossing(uint32_t k, const Point &p) const;
+
+private:
+  // band b covers [m_band_start[b], m_band_start[b + 1]), the last band
+  // ends at m_bottom
+  std::vector<T> m_band_start = {};
+  T m_bottom = 0;
+  T m_right = 0;
+  // edges [m_partial[b], m_partial[b + 1]) end inside band b
+  std::vector<uint32_t> m_partial = {};
+  // band b is node m_leaf_base + b, the parent of node i is i / 2
+  std::vector<Node> m_nodes = {};
+  uint32_t m_leaf_base = 0;
+  // edge k runs from (m_x1[k], m_y1[k]) to (m_x2[k], m_y2[k])
+  std::vector<T> m_x1 = {};
+  std::vector<T> m_y1 = {};
+  std::vector<T> m_x2 = {};
+  std::vector<T> m_y2 = {};
+  std::vector<T> m_x_min = {};
+  // sum of the directions of the edges from k to the end of their node
+  std::vector<int32_t> m_suffix = {};
+};
+
+/**
+ * Union of many polygons added one at a time or in batches.
+ *
+ * Added polygons are kept on a stack of partial unions, and whenever the top
+ * one holds as many inputs as the one below, the two are merged, like the
+ * carries of a binary counter. Every input therefore takes part in
+ * O(log n) merges instead of one per later input. A merge only hands the rings
+ * whose bounding box touches a ring of the other side to the Boolean
+ * operation, all others are copied over unchanged, so merging neighbouring
+ * groups only redoes the region where they meet. Polygons added in one batch
+ * are merged in the order of a Hilbert curve through their bounding boxes.
+ *
+ * Inputs must be simple polygons as for Union.
+ */
+template <typename T> class BasicUnionAccumulator {
+public:
+  using Polygon = BasicPolygon<T>;
+
+  explicit BasicUnionAccumulator(Degeneracy degeneracy = Degeneracy::kPerturb);
+  ~BasicUnionAccumulator();
+
+  BasicUnionAccumulator(const BasicUnionAccumulator &) = delete;
+  BasicUnionAccumulator &operator=(const BasicUnionAccumulator &) = delete;
+
+  void add(const Polygon &polygon);
+
+  void add(Polygon &&polygon);
+
+  void add(const std::vector<Polygon> &polygons);
+
+  /**
+   * Merge everything added so far, the result stays valid until the next
+   * call to add or clear. Adding more polygons later continues from it.
+   */
+  const Polygon &result();
+
+  /**
+   * Number of polygons added since construction or the last clear
+   */
+  size_t size() const { return m_count; }
+
+  void clear();
+
+private:
+  struct Partial {
+    Polygon polygon = {};
+    // number of inputs merged into polygon
+    size_t count = 0;
+  };
+
+  void push(Polygon &&polygon);
+
+  /**
+   * Merge the two partials on top of the stack
+   */
+  void merge_top();
+
+private:
+  std::vector<Partial> m_stack = {};
+  std::unique_ptr<ClipWorkspace<T>> m_workspace;
+  size_t m_count = 0;
+};
+
+/**
+ * Scratch memory for a series of Boolean operations.
+ *
+ * Every operation needs working copies of both inputs, the edge lists of the
+ * intersection search, the lists of the result walk and the vertices of the
+ * result. A context keeps all of them between operations, so once it has seen
+ * inputs of a similar size later operations run without allocating. The
+ * result lives in the context, its memory is reused by the next operation.
+ *
+ * A context serves one thread at a time, threads working in parallel each
+ * keep their own.
+ */
+template <typename T> class BasicClipContext {
+public:
+  using Polygon = BasicPolygon<T>;
+
+  explicit BasicClipContext(Degeneracy degeneracy = Degeneracy::kPerturb);
+  ~BasicClipContext();
+
+  BasicClipContext(const BasicClipContext &) = delete;
+  BasicClipContext &operator=(const BasicClipContext &) = delete;
+
+  void set_degeneracy(Degeneracy degeneracy);
+
+  /**
+   * If set, the inputs of later operations are resolved under fill_rule as
+   * for the FillRule overloads of Clip, Union and Diff
+   */
+  void set_fill_rule(std::optional<FillRule> fill_rule);
+
+  /**
+   * If set, filled with the counters of each later operation
+   */
+  void set_stats(ClipStats *stats);
+
+  /**
+   * Run op, the result stays valid until the next call of run or take_result
+   */
+  const Polygon &run(BoolOp op, const Polygon &subject,
+                     const Polygon &clipping);
+
+  const Polygon &run(BoolOp op, const BasicPolygonView<T> &subject,
+                     const BasicPolygonView<T> &clipping);
+
+  const Polygon &result() const { return m_result; }
+
+  /**
+   * Move the last result out, the next operation allocates its result anew
+   */
+  Polygon take_result() { return std::move(m_result); }
+
+private:
+  std::unique_ptr<ClipWorkspace<T>> m_workspace;
+  Polygon m_result = {};
+};
+
+/**
+ * Polygons stored in a binary file, mapped into memory for reading.
+ *
+ * Every polygon is a record of contiguous interleaved coordinates, followed
+ * by its edge index if the file was written with one. Tables at the end hold
+ * the ring offsets and the bounding box of every polygon and ring. Opening
+ * maps the file and checks the tables, coordinates are only paged in when an
+ * operation reads them. Views point straight into the mapping and stay valid
+ * until the file is closed.
+ *
+ * Files are written by BasicPolygonFileWriter of the same coordinate type and
+ * can only be read on machines of the same byte order.
+ */
+template <typename T> class BasicPolygonFile {
+public:
+  using Rect = BasicRect<T>;
+  using View = BasicPolygonView<T>;
+
+  BasicPolygonFile() = default;
+  ~BasicPolygonFile();
+
+  BasicPolygonFile(const BasicPolygonFile &) = delete;
+  BasicPolygonFile &operator=(const BasicPolygonFile &) = delete;
+
+  /**
+   * Map the file at path, false if it cannot be read, is damaged or was not
+   * written for T
+   */
+  bool open(const std::string &path);
+
+  void close();
+
+  bool is_open() const { return m_data != nullptr; }
+
+  size_t polygon_count() const { return m_polygon_count; }
+
+  /**
+   * Whether an edge index is stored with every polygon
+   */
+  bool has_index() const { return m_indexed; }
+
+  /**
+   * Polygon i, nothing is copied
+   */
+  View view(size_t i) const;
+
+  /**
+   * Polygon i carrying its stored edge index. The index is copied out of the
+   * file on every call, which is still much cheaper than building it, so a
+   * view used for many operations should be kept.
+   */
+  View indexed_view(size_t i) const;
+
+  /**
+   * Bounding box of polygon i, none for a polygon without rings
+   */
+  std::optional<Rect> get_bounds(size_t i) const;
+
+  /**
+   * Bounding boxes of the rings of polygon i, one for each ring of view(i)
+   */
+  const Rect *get_sub_bounds(size_t i) const;
+
+private:
+  /**
+   * Edge index of polygon i read from the file, null if it does not fit
+   */
+  std::shared_ptr<const EdgeIndex<T>> load_index(size_t i,
+                                                 const View &view) const;
+
+private:
+  const unsigned char *m_data = nullptr;
+  size_t m_size = 0;
+  // file contents where the platform has no mmap
+  std::vector<unsigned char> m_copy = {};
+  bool m_indexed = false;
+
+  size_t m_polygon_count = 0;
+  const unsigned char *m_entries = nullptr;
+  const uint32_t *m_ring_offsets = nullptr;
+  const Rect *m_bounds = nullptr;
+  const Rect *m_sub_bounds = nullptr;
+};
+
+/**
+ * Writes polygons one at a time into the file read by BasicPolygonFile.
+ *
+ * The record of each polygon goes to the file when it is written, only its
+ * ring offsets and bounding boxes are kept until close writes the tables, so
+ * results can be streamed out as they are computed. Rings of fewer than three
+ * vertices are dropped, a polygon may hold up to 2^32 - 1 vertices.
+ */
+template <typename T> class BasicPolygonFileWriter {
+public:
+  using Rect = BasicRect<T>;
+  using Polygon = BasicPolygon<T>;
+  using View = BasicPolygonView<T>;
+  using Buffer = BasicPolygonBuffer<T>;
+
+  BasicPolygonFileWriter() = default;
+  // closes the file if it is still open
+  ~BasicPolygonFileWriter();
+
+  BasicPolygonFileWriter(const BasicPolygonFileWriter &) = delete;
+  BasicPolygonFileWriter &operator=(const BasicPolygonFileWriter &) = delete;
+
+  /**
+   * Create the file at path or replace it, with build_index an edge index is
+   * built and stored for every polygon
+   */
+  bool open(const std::string &path, bool build_index = false);
+
+  /**
+   * Append a polygon, false if it could not be written. After a failure
+   * nothing more is written and close fails as well.
+   */
+  bool write(const Polygon &polygon);
+
+  bool write(const View &view);
+
+  bool write(const Buffer &buffer);
+
+  /**
+   * Write the tables and the header, only then the file can be read
+   */
+  bool close();
+
+  /**
+   * Number of polygons written so far
+   */
+  size_t size() const { return m_records.size(); }
+
+private:
+  struct Record {
+    uint64_t coords;
+    uint64_t index;
+    uint32_t ring_count;
+    uint32_t vertex_count;
+  };
+
+  /**
+   * Write view, which must have a stride of 2 and no ring to skip
+   */
+  bool write_record(const View &view);
+
+  bool write_bytes(const void *data, size_t size);
+
+  /**
+   * Pad the file to a multiple of 8 bytes
+   */
+  bool align();
+
+private:
+  std::FILE *m_file = nullptr;
+  bool m_index = false;
+  bool m_failed = false;
+  uint64_t m_offset = 0;
+
+  std::vector<Record> m_records = {};
+  // 0 followed by the end of every ring, for each polygon
+  std::vector<uint32_t> m_ring_offsets = {};
+  std::vector<Rect> m_bounds = {};
+  std::vector<Rect> m_sub_bounds = {};
+  // rings of a polygon which has to be copied before it is written
+  Buffer m_stage = {};
+};
+
+using Point = BasicPoint<float>;
+using Rect = BasicRect<float>;
+using Vertex = BasicVertex<float>;
+using VertexArena = BasicVertexArena<float>;
+using Polygon = BasicPolygon<float>;
+using PolygonView = BasicPolygonView<float>;
+using PolygonBuffer = BasicPolygonBuffer<float>;
+using PolygonFile = BasicPolygonFile<float>;
+using PolygonFileWriter = BasicPolygonFileWriter<float>;
+using PreparedPolygon = BasicPreparedPolygon<float>;
+using UnionAccumulator = BasicUnionAccumulator<float>;
+using ClipContext = BasicClipContext<float>;
+
+using PointD = BasicPoint<double>;
+using RectD = BasicRect<double>;
+using VertexD = BasicVertex<double>;
+using VertexArenaD = BasicVertexArena<double>;
+using PolygonD = BasicPolygon<double>;
+using PolygonViewD = BasicPolygonView<double>;
+using PolygonBufferD = BasicPolygonBuffer<double>;
+using PolygonFileD = BasicPolygonFile<double>;
+using PolygonFileWriterD = BasicPolygonFileWriter<double>;
+using PreparedPolygonD = BasicPreparedPolygon<double>;
+using UnionAccumulatorD = BasicUnionAccumulator<double>;
+using ClipContextD = BasicClipContext<double>;
+
+using PointI = BasicPoint<int32_t>;
+using RectI = BasicRect<int32_t>;
+using VertexI = BasicVertex<int32_t>;
+using VertexArenaI = BasicVertexArena<int32_t>;
+using PolygonI = BasicPolygon<int32_t>;
+using PolygonViewI = BasicPolygonView<int32_t>;
+using PolygonBufferI = BasicPolygonBuffer<int32_t>;
+using PolygonFileI = BasicPolygonFile<int32_t>;
+using PolygonFileWriterI = BasicPolygonFileWriter<int32_t>;
+using PreparedPolygonI = BasicPreparedPolygon<int32_t>;
+using UnionAccumulatorI = BasicUnionAccumulator<int32_t>;
+using ClipContextI = BasicClipContext<int32_t>;
+
+extern template struct BasicPolygonView<float>;
+extern template struct BasicPolygonView<double>;
+extern template struct BasicPolygonView<int32_t>;
+extern template struct BasicPolygonBuffer<float>;
+extern template struct BasicPolygonBuffer<double>;
+extern template struct BasicPolygonBuffer<int32_t>;
+extern template class BasicVertexArena<float>;
+extern template class BasicVertexArena<double>;
+extern template class BasicVertexArena<int32_t>;
+extern template class BasicPolygon<float>;
+extern template class BasicPolygon<double>;
+extern template class BasicPolygon<int32_t>;
+extern template class BasicPreparedPolygon<float>;
+extern template class BasicPreparedPolygon<double>;
+extern template class BasicPreparedPolygon<int32_t>;
+extern template class BasicUnionAccumulator<float>;
+extern template class BasicUnionAccumulator<double>;
+extern template class BasicUnionAccumulator<int32_t>;
+extern template class BasicClipContext<float>;
+extern template class BasicClipContext<double>;
+extern template class BasicClipContext<int32_t>;
+extern template class BasicPolygonFile<float>;
+extern template class BasicPolygonFile<double>;
+extern template class BasicPolygonFile<int32_t>;
+extern template class BasicPolygonFileWriter<float>;
+extern template class BasicPolygonFileWriter<double>;
+extern template class BasicPolygonFileWriter<int32_t>;
+
+/**
+ * One independent Boolean operation on float polygons for BatchExecutor.
+ * The polygons are only read and must stay alive until the run returns.
+ */
+struct BoolJob {
+  const Polygon *subject = nullptr;
+  const Polygon *clipping = nullptr;
+  BoolOp op = BoolOp::kClip;
+  Degeneracy degeneracy = Degeneracy::kPerturb;
+  // if set, filled with the counters of this job
+  ClipStats *stats = nullptr;
+
+  BoolJob() = default;
+  BoolJob(const Polygon *subject, const Polygon *clipping, BoolOp op,
+          Degeneracy degeneracy = Degeneracy::kPerturb,
+          ClipStats *stats = nullptr)
+      : subject(subject), clipping(clipping), op(op), degeneracy(degeneracy),
+        stats(stats) {}
+};
+
+class ThreadPool;
+
+/**
+ * Run many independent Boolean operations on a fixed pool of threads.
+ *
+ * Jobs are scheduled with work stealing, every worker keeps its own working
+ * memory for the whole run, and results always come back in job order no
+ * matter which worker computed them.
+ */
+class BatchExecutor {
+public:
+  /**
+   * @thread_count  number of worker threads, 0 means one per hardware thread
+   */
+  explicit BatchExecutor(uint32_t thread_count = 0);
+  ~BatchExecutor();
+
+  BatchExecutor(const BatchExecutor &) = delete;
+  BatchExecutor &operator=(const BatchExecutor &) = delete;
+
+  uint32_t thread_count() const;
+
+  /**
+   * Run all jobs and block until they are done
+   *
+   * @return one result for each job, in the same order
+   */
+  std::vector<Polygon> run(const std::vector<BoolJob> &jobs);
+
+  /**
+   * Run a single job on the calling thread, the search for edge
+   * intersections of large inputs is split across the worker threads.
+   * Perturbation depends on the order of the tests, so the job always
+   * resolves degeneracies as with Degeneracy::kSymbolic and job.degeneracy
+   * is ignored. The result is the same for any thread count.
+   */
+  Polygon run(const BoolJob &job);
+
+private:
+  std::unique_ptr<ThreadPool> m_pool;
+  std::vector<std::unique_ptr<ClipWorkspace<float>>> m_workspaces;
 };
 
 } // namespace pc
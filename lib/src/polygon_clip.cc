@@ -1,90 +1,280 @@
 #include "polygon_clip.hpp"
+#include "polygon_clip_batch.hpp"
+#include "polygon_clip_convex.hpp"
+#include "polygon_clip_index.hpp"
+#include "polygon_clip_math.hpp"
 #include "polygon_clip_priv.hpp"
+#include "polygon_clip_sink.hpp"
+#include "polygon_clip_union.hpp"
+
+#include <limits>
+#include <utility>
 
 namespace pc {
 
-Polygon::Polygon(const Polygon &other) {
+constexpr size_t kMinChunkSize = 64;
 
-  for (auto v : other.m_sub_polygons) {
-    auto p = v;
-    std::vector<Point> points{};
-    points.emplace_back(p->point);
+template <typename T>
+BasicVertexArena<T>::BasicVertexArena(BasicVertexArena &&other) noexcept
+    : m_chunks(std::move(other.m_chunks)),
+      m_current(std::exchange(other.m_current, 0)),
+      m_size(std::exchange(other.m_size, 0)),
+      m_capacity(std::exchange(other.m_capacity, 0)) {
+  other.m_chunks.clear();
+}
 
-    p = p->next;
+template <typename T>
+BasicVertexArena<T> &
+BasicVertexArena<T>::operator=(BasicVertexArena &&other) noexcept {
+  if (this != &other) {
+    m_chunks = std::move(other.m_chunks);
+    m_current = std::exchange(other.m_current, 0);
+    m_size = std::exchange(other.m_size, 0);
+    m_capacity = std::exchange(other.m_capacity, 0);
 
-    while (p != v) {
-      points.emplace_back(p->point);
-      p = p->next;
-    }
+    other.m_chunks.clear();
+  }
 
-    if (points.size() < 3) {
-      continue;
+  return *this;
+}
+
+template <typename T> void BasicVertexArena<T>::reserve(size_t count) {
+  // chunks left over from before a clear are filled first
+  for (; m_current < m_chunks.size(); m_current++) {
+    const auto &chunk = m_chunks[m_current];
+    if (chunk.capacity - chunk.size >= count) {
+      return;
     }
+  }
+
+  // grow geometrically so the number of chunks stays logarithmic
+  Chunk chunk;
+  chunk.capacity = std::max(count, std::max(kMinChunkSize, m_capacity));
+  chunk.data = std::make_unique<Vertex[]>(chunk.capacity);
 
-    this->append_vertices(points);
+  m_capacity += chunk.capacity;
+  m_chunks.emplace_back(std::move(chunk));
+  m_current = m_chunks.size() - 1;
+}
+
+template <typename T>
+void BasicVertexArena<T>::merge(BasicVertexArena &&other) {
+  for (auto &chunk : other.m_chunks) {
+    m_chunks.emplace_back(std::move(chunk));
   }
+
+  m_size += other.m_size;
+  m_capacity += other.m_capacity;
+
+  other.m_chunks.clear();
+  other.m_current = 0;
+  other.m_size = 0;
+  other.m_capacity = 0;
 }
 
-Polygon::Polygon(const Polygon &p1, const Polygon &p2, bool p2_reserve) {
+template <typename T> void BasicVertexArena<T>::clear() {
+  for (auto &chunk : m_chunks) {
+    chunk.size = 0;
+  }
 
-  for (auto v : p1.m_sub_polygons) {
-    auto p = v;
-    std::vector<Point> points{};
-    points.emplace_back(p->point);
+  m_current = 0;
+  m_size = 0;
+}
 
-    p = p->next;
+template <typename T>
+BasicVertex<T> *BasicVertexArena<T>::allocate(const Point &p) {
+  reserve(1);
 
-    while (p != v) {
-      points.emplace_back(p->point);
+  auto &chunk = m_chunks[m_current];
+  auto vertex = &chunk.data[chunk.size];
+  chunk.size++;
+  m_size++;
+
+  vertex->point = p;
+
+  return vertex;
+}
+
+template <typename T>
+static size_t
+count_vertices(const std::vector<BasicVertex<T> *> &sub_polygons) {
+  size_t count = 0;
+
+  for (auto v : sub_polygons) {
+    auto p = v;
+    do {
+      count++;
       p = p->next;
-    }
+    } while (p != v);
+  }
 
-    if (points.size() < 3) {
-      continue;
-    }
+  return count;
+}
 
-    this->append_vertices(points);
+/**
+ * Orientation and convexity of the closed ring through point(0) to
+ * point(n - 1)
+ */
+template <typename T, typename P>
+static RingShape classify_ring(size_t n, const P &point) {
+  auto same = [](const BasicPoint<T> &p1, const BasicPoint<T> &p2) {
+    return p1.x == p2.x && p1.y == p2.y;
+  };
+
+  auto step = [](T from, T to) { return (to > from) - (to < from); };
+
+  // repeated points are skipped, the turn at b is taken from the last point
+  // before b that differs from it
+  BasicPoint<T> first = point(0);
+  size_t last = n - 1;
+  while (last > 0 && same(point(last), first)) {
+    last--;
   }
 
-  for (auto v : p2.m_sub_polygons) {
-    auto p = v;
-    std::vector<Point> points{};
-    points.emplace_back(p->point);
+  RingShape shape;
+  if (last == 0) {
+    return shape;
+  }
 
-    if (p2_reserve) {
-      p = p->prev;
-    } else {
-      p = p->next;
+  auto a = point(last);
+  int turn = 0;
+  bool convex = true;
+  // a ring winding around once changes the sign of its x and y steps twice
+  int dx_first = 0;
+  int dx_last = 0;
+  int dy_first = 0;
+  int dy_last = 0;
+  int changes = 0;
+  double area = 0;
+
+  for (size_t i = 0; i < n; i++) {
+    BasicPoint<T> b = point(i);
+    BasicPoint<T> c = point(i + 1 < n ? i + 1 : 0);
+
+    area += (static_cast<double>(b.x) - first.x) *
+                (static_cast<double>(c.y) - first.y) -
+            (static_cast<double>(c.x) - first.x) *
+                (static_cast<double>(b.y) - first.y);
+
+    if (!convex || same(b, c)) {
+      continue;
     }
 
-    while (p != v) {
-      points.emplace_back(p->point);
-      if (p2_reserve) {
-        p = p->prev;
-      } else {
-        p = p->next;
-      }
+    int o = Math::orientation(a, b, c, 0);
+    if (o != 0) {
+      convex = turn == 0 || o == turn;
+      turn = o;
     }
 
-    if (points.size() < 3) {
-      continue;
+    int dx = step(b.x, c.x);
+    int dy = step(b.y, c.y);
+    if (dx != 0) {
+      changes += dx_last != 0 && dx != dx_last;
+      dx_first = dx_first != 0 ? dx_first : dx;
+      dx_last = dx;
+    }
+    if (dy != 0) {
+      changes += dy_last != 0 && dy != dy_last;
+      dy_first = dy_first != 0 ? dy_first : dy;
+      dy_last = dy;
+    }
+
+    a = b;
+  }
+
+  changes += (dx_first != dx_last) + (dy_first != dy_last);
+
+  shape.convex = convex && turn != 0 && changes <= 4;
+  if (shape.convex) {
+    shape.orientation = static_cast<int8_t>(turn);
+  } else {
+    shape.orientation = static_cast<int8_t>((area > 0) - (area < 0));
+  }
+
+  return shape;
+}
+
+template <typename T>
+BasicPolygon<T>::BasicPolygon(const BasicPolygon &other)
+    : m_index(other.m_index) {
+  m_vertex.reserve(count_vertices(other.m_sub_polygons));
+
+  // same rings in the same order, so the index stays valid
+  append_polygon(other, false);
+}
+
+template <typename T>
+BasicPolygon<T>::BasicPolygon(const BasicPolygon &p1, const BasicPolygon &p2,
+                              bool p2_reserve) {
+  m_vertex.reserve(count_vertices(p1.m_sub_polygons) +
+                   count_vertices(p2.m_sub_polygons));
+
+  append_polygon(p1, false);
+  append_polygon(p2, p2_reserve);
+}
+
+template <typename T>
+BasicPolygon<T>::BasicPolygon(BasicPolygon &&p1, BasicPolygon &&p2,
+                              bool p2_reverse)
+    : BasicPolygon(std::move(p1)) {
+  m_index.reset();
+
+  if (p2_reverse) {
+    p2.m_vertex.for_each(
+        [](Vertex *vert) { std::swap(vert->prev, vert->next); });
+  }
+
+  m_vertex.merge(std::move(p2.m_vertex));
+
+  m_sub_polygons.insert(m_sub_polygons.end(), p2.m_sub_polygons.begin(),
+                        p2.m_sub_polygons.end());
+  m_sub_bounds.insert(m_sub_bounds.end(), p2.m_sub_bounds.begin(),
+                      p2.m_sub_bounds.end());
+
+  for (auto shape : p2.m_sub_shapes) {
+    if (p2_reverse) {
+      shape.orientation = static_cast<int8_t>(-shape.orientation);
     }
+    m_sub_shapes.emplace_back(shape);
+  }
 
-    this->append_vertices(points);
+  if (auto bounds = p2.get_bounds()) {
+    expand_bounds(*bounds);
   }
+
+  p2.m_sub_polygons.clear();
+  p2.m_sub_bounds.clear();
+  p2.m_sub_shapes.clear();
+  p2.m_left_top.reset();
+  p2.m_right_bottom.reset();
 }
 
-void Polygon::append_vertices(const std::vector<Point> &points) {
+template <typename T>
+void BasicPolygon<T>::append_vertices(const std::vector<Point> &points) {
   if (points.size() < 3) {
     // not a closed path
     return;
   }
 
-  auto head = allocate_vertex(points.front());
+  Rect bounds{points.front(), points.front()};
+
+  for (const auto &p : points) {
+    check_coordinate(p.x);
+    check_coordinate(p.y);
+
+    bounds.left_top.x = std::min(bounds.left_top.x, p.x);
+    bounds.left_top.y = std::min(bounds.left_top.y, p.y);
+    bounds.right_bottom.x = std::max(bounds.right_bottom.x, p.x);
+    bounds.right_bottom.y = std::max(bounds.right_bottom.y, p.y);
+  }
+
+  m_vertex.reserve(points.size());
+
+  auto head = m_vertex.allocate(points.front());
 
   auto prev = head;
   for (size_t i = 1; i < points.size(); i++) {
-    auto next = allocate_vertex(points[i]);
+    auto next = m_vertex.allocate(points[i]);
     prev->next = next;
     next->prev = prev;
 
@@ -95,85 +285,589 @@ void Polygon::append_vertices(const std::vector<Point> &points) {
   head->prev = prev;
 
   m_sub_polygons.emplace_back(head);
+  m_sub_bounds.emplace_back(bounds);
+  m_sub_shapes.emplace_back(classify_ring<T>(
+      points.size(), [&points](size_t i) { return points[i]; }));
+
+  expand_bounds(bounds);
+
+  m_index.reset();
 }
 
-bool Polygon::contains(const Point &p) const {
-  bool contains = false;
-  int32_t winding_num = 0;
+template <typename T>
+void BasicPolygon<T>::append_vertices(const BasicPolygonView<T> &view) {
+  check_coordinates(view);
 
-  PolygonIter iter(m_sub_polygons);
+  m_vertex.reserve(view.vertex_count());
 
-  while (iter.has_next()) {
-    auto curr = iter.current();
-    auto next = curr->next;
+  for (size_t r = 0; r < view.ring_count; r++) {
+    if (view.ring_size(r) >= 3) {
+      append_ring(view, r, false);
+    }
+  }
 
-    if (((next->point.y > p.y) != (curr->point.y > p.y)) &&
-        (p.x < (curr->point.x - next->point.x) * (p.y - next->point.y) /
-                       (curr->point.y - next->point.y) +
-                   next->point.x)) {
-      contains = !contains;
+  m_index.reset();
+}
 
-      if (curr->point == next->point ||
-          scalar_is_zero(curr->point.x - next->point.x)) {
-        iter.move_next();
-        continue;
-      }
+template <typename T> void BasicPolygon<T>::clear() {
+  m_sub_polygons.clear();
+  m_sub_bounds.clear();
+  m_sub_shapes.clear();
+  m_vertex.clear();
+  m_left_top.reset();
+  m_right_bottom.reset();
+  m_index.reset();
+}
 
-      if (curr->point < next->point) {
-        winding_num += 1;
-      } else {
-        winding_num -= 1;
-      }
-    }
+template <typename T>
+void BasicPolygon<T>::append_polygon(const BasicPolygon &other, bool reverse) {
+  for (size_t i = 0; i < other.m_sub_polygons.size(); i++) {
+    append_ring(other, i, reverse);
+  }
+}
+
+template <typename T>
+void BasicPolygon<T>::append_ring(const BasicPolygon &other, size_t ring,
+                                  bool reverse) {
+  auto head = other.m_sub_polygons[ring];
+  const auto &bounds = other.m_sub_bounds[ring];
+  auto shape = other.m_sub_shapes[ring];
+
+  auto first = m_vertex.allocate(head->point);
+
+  auto prev = first;
+  auto p = reverse ? head->prev : head->next;
+
+  while (p != head) {
+    auto next = m_vertex.allocate(p->point);
+    prev->next = next;
+    next->prev = prev;
+
+    prev = next;
+    p = reverse ? p->prev : p->next;
+  }
 
-    iter.move_next();
+  prev->next = first;
+  first->prev = prev;
+
+  if (reverse) {
+    shape.orientation = static_cast<int8_t>(-shape.orientation);
   }
 
-  return contains;
+  m_sub_polygons.emplace_back(first);
+  m_sub_bounds.emplace_back(bounds);
+  m_sub_shapes.emplace_back(shape);
+
+  expand_bounds(bounds);
 }
 
-Vertex *Polygon::allocate_vertex(const Point &p) {
+template <typename T>
+void BasicPolygon<T>::append_ring(const BasicPolygonView<T> &view, size_t ring,
+                                  bool reverse) {
+  size_t begin = view.ring_offsets[ring];
+  size_t n = view.ring_size(ring);
+
+  // vertex k of the copy, walking backwards from the first one on reverse
+  auto point = [&view, begin, n, reverse](size_t k) {
+    return view.point(begin + (reverse && k > 0 ? n - k : k));
+  };
+
+  Rect bounds{point(0), point(0)};
+
+  auto first = m_vertex.allocate(point(0));
+
+  auto prev = first;
+  for (size_t k = 1; k < n; k++) {
+    auto p = point(k);
+
+    bounds.left_top.x = std::min(bounds.left_top.x, p.x);
+    bounds.left_top.y = std::min(bounds.left_top.y, p.y);
+    bounds.right_bottom.x = std::max(bounds.right_bottom.x, p.x);
+    bounds.right_bottom.y = std::max(bounds.right_bottom.y, p.y);
+
+    auto next = m_vertex.allocate(p);
+    prev->next = next;
+    next->prev = prev;
+
+    prev = next;
+  }
+
+  prev->next = first;
+  first->prev = prev;
+
+  m_sub_polygons.emplace_back(first);
+  m_sub_bounds.emplace_back(bounds);
+  m_sub_shapes.emplace_back(classify_ring<T>(n, point));
+
+  expand_bounds(bounds);
+}
+
+template <typename T>
+void BasicPolygon<T>::expand_bounds(const Rect &bounds) {
   if (!m_left_top) {
-    m_left_top = p;
+    m_left_top = bounds.left_top;
   } else {
-    if (m_left_top->x >= p.x)
-      m_left_top->x = p.x;
-
-    if (m_left_top->y >= p.y)
-      m_left_top->y = p.y;
+    m_left_top->x = std::min(m_left_top->x, bounds.left_top.x);
+    m_left_top->y = std::min(m_left_top->y, bounds.left_top.y);
   }
 
   if (!m_right_bottom) {
-    m_right_bottom = p;
+    m_right_bottom = bounds.right_bottom;
+  } else {
+    m_right_bottom->x = std::max(m_right_bottom->x, bounds.right_bottom.x);
+    m_right_bottom->y = std::max(m_right_bottom->y, bounds.right_bottom.y);
+  }
+}
+
+template <typename T>
+std::optional<BasicRect<T>> BasicPolygon<T>::get_bounds() const {
+  if (!m_left_top || !m_right_bottom) {
+    return std::nullopt;
+  }
+
+  return Rect(*m_left_top, *m_right_bottom);
+}
+
+template <typename T>
+std::optional<BasicRect<T>> BasicPolygonView<T>::get_bounds() const {
+  std::optional<Rect> bounds;
+
+  for (size_t r = 0; r < ring_count; r++) {
+    if (ring_size(r) < 3) {
+      continue;
+    }
+
+    if (!bounds) {
+      bounds = Rect(point(ring_offsets[r]), point(ring_offsets[r]));
+    }
+
+    for (size_t i = ring_offsets[r]; i < ring_offsets[r + 1]; i++) {
+      auto p = point(i);
+
+      bounds->left_top.x = std::min(bounds->left_top.x, p.x);
+      bounds->left_top.y = std::min(bounds->left_top.y, p.y);
+      bounds->right_bottom.x = std::max(bounds->right_bottom.x, p.x);
+      bounds->right_bottom.y = std::max(bounds->right_bottom.y, p.y);
+    }
+  }
+
+  return bounds;
+}
+
+template <typename T>
+void BasicPolygonBuffer<T>::append(const BasicPolygon<T> &polygon) {
+  for (auto head : polygon.get_vertices()) {
+    auto v = head;
+    do {
+      coords.emplace_back(v->point.x);
+      coords.emplace_back(v->point.y);
+      v = v->next;
+    } while (v != head);
+
+    ring_offsets.emplace_back(static_cast<uint32_t>(coords.size() / 2));
+  }
+}
+
+/**
+ * Whether edge a -> b crosses the horizontal ray from p towards +x
+ */
+template <typename T>
+static bool ray_crosses(const BasicPoint<T> &a, const BasicPoint<T> &b,
+                        const BasicPoint<T> &p) {
+  if ((b.y > p.y) == (a.y > p.y)) {
+    return false;
+  }
+
+  if constexpr (ScalarTraits<T>::kExact) {
+    // same test as FlatPolygon::contains, without dividing
+    int side = Math::orientation(a, b, p, 0);
+    return b.y > a.y ? side > 0 : side < 0;
+  } else {
+    return p.x < (a.x - b.x) * (p.y - b.y) / (a.y - b.y) + b.x;
+  }
+}
+
+template <typename T>
+bool BasicPolygon<T>::contains(const Point &p, FillRule rule) const {
+  // upward edges right of p count +1, downward ones -1
+  int32_t winding = 0;
+
+  auto count = [&winding, &p](const Point &a, const Point &b) {
+    if (ray_crosses(a, b, p)) {
+      winding += b.y > a.y ? 1 : -1;
+    }
+  };
+
+  if (m_index) {
+    Rect ray(p, Point(std::numeric_limits<T>::max(), p.y));
+
+    m_index->query(ray, [&count](const typename EdgeIndex<T>::Edge &edge) {
+      count(edge.p1, edge.p2);
+    });
+  } else {
+    PolygonIter<T> iter(m_sub_polygons);
+
+    while (iter.has_next()) {
+      auto curr = iter.current();
+
+      count(curr->point, curr->next->point);
+
+      iter.move_next();
+    }
+  }
+
+  return rule == FillRule::kNonZero ? winding != 0 : (winding & 1) != 0;
+}
+
+template <typename T> void BasicPolygon<T>::build_index() const {
+  if (!m_index) {
+    m_index = std::make_shared<const EdgeIndex<T>>(*this);
+  }
+}
+
+bool ClipStats::enabled() {
+#ifdef PC_ENABLE_STATS
+  return true;
+#else
+  return false;
+#endif
+}
+
+template <typename T>
+BasicPolygon<T> BasicPolygon<T>::Clip(const BasicPolygon &subject,
+                                      const BasicPolygon &clipping,
+                                      Degeneracy degeneracy, ClipStats *stats) {
+  return ClipAlgorithm<T>::do_clip(subject, clipping, degeneracy, stats);
+}
+
+template <typename T>
+std::vector<BasicPolygon<T>>
+BasicPolygon<T>::Clip(const BasicPolygon &subject,
+                      const std::vector<BasicPolygon> &clippings,
+                      Degeneracy degeneracy) {
+  std::vector<BasicPolygon> result;
+  result.reserve(clippings.size());
+
+  if constexpr (ScalarTraits<T>::kExact) {
+    // the shared subject relies on perturbation, exact coordinates take the
+    // symbolic path of a full clip instead
+    for (const auto &clipping : clippings) {
+      result.emplace_back(Clip(subject, clipping, degeneracy));
+    }
   } else {
-    if (m_right_bottom->x < p.x)
-      m_right_bottom->x = p.x;
+    BatchClipper<T> clipper(subject, degeneracy);
+
+    for (const auto &clipping : clippings) {
+      result.emplace_back(clipper.clip(clipping));
+    }
+  }
+
+  return result;
+}
+
+template <typename T>
+BasicPolygon<T> BasicPolygon<T>::ClipRect(const BasicPolygon &subject,
+                                          const Point &min, const Point &max) {
+  BasicPolygon result;
 
-    if (m_right_bottom->y < p.y)
-      m_right_bottom->y = p.y;
+  if (!(min.x < max.x && min.y < max.y)) {
+    return result;
   }
 
-  m_vertex.emplace_back(std::make_unique<Vertex>(p));
+  std::vector<Point> ring;
+  ResultSink<T> sink(result, ring);
+
+  ConvexClipper<T> clipper;
+  clipper.set_window({min, Point(max.x, min.y), max, Point(min.x, max.y)});
+  clipper.clip(subject, ConvexClipper<T>::Region::kIntersection, sink);
+
+  return result;
+}
+
+template <typename T>
+BasicPolygon<T> BasicPolygon<T>::Union(const BasicPolygon &subject,
+                                       const BasicPolygon &clipping,
+                                       Degeneracy degeneracy,
+                                       ClipStats *stats) {
+  return ClipAlgorithm<T>::do_union(subject, clipping, degeneracy, stats);
+}
+
+template <typename T>
+BasicPolygon<T> BasicPolygon<T>::Diff(const BasicPolygon &subject,
+                                      const BasicPolygon &clipping,
+                                      Degeneracy degeneracy, ClipStats *stats) {
+  return ClipAlgorithm<T>::do_diff(subject, clipping, degeneracy, stats);
+}
+
+template <typename T>
+BasicPolygon<T> BasicPolygon<T>::Clip(BasicPolygon &&subject,
+                                      BasicPolygon &&clipping,
+                                      Degeneracy degeneracy, ClipStats *stats) {
+  return ClipAlgorithm<T>::do_clip(std::move(subject), std::move(clipping),
+                                   degeneracy, stats);
+}
+
+template <typename T>
+BasicPolygon<T> BasicPolygon<T>::Union(BasicPolygon &&subject,
+                                       BasicPolygon &&clipping,
+                                       Degeneracy degeneracy,
+                                       ClipStats *stats) {
+  return ClipAlgorithm<T>::do_union(std::move(subject), std::move(clipping),
+                                    degeneracy, stats);
+}
+
+template <typename T>
+BasicPolygon<T> BasicPolygon<T>::Diff(BasicPolygon &&subject,
+                                      BasicPolygon &&clipping,
+                                      Degeneracy degeneracy, ClipStats *stats) {
+  return ClipAlgorithm<T>::do_diff(std::move(subject), std::move(clipping),
+                                   degeneracy, stats);
+}
+
+template <typename T>
+BasicPolygon<T> BasicPolygon<T>::Clip(const BasicPolygonView<T> &subject,
+                                      const BasicPolygonView<T> &clipping,
+                                      Degeneracy degeneracy, ClipStats *stats) {
+  ClipWorkspace<T> workspace;
+  workspace.degeneracy = degeneracy;
+  workspace.stats = stats;
+
+  return ClipAlgorithm<T>::do_op(BoolOp::kClip, subject, clipping, workspace);
+}
+
+template <typename T>
+BasicPolygon<T> BasicPolygon<T>::Union(const BasicPolygonView<T> &subject,
+                                       const BasicPolygonView<T> &clipping,
+                                       Degeneracy degeneracy,
+                                       ClipStats *stats) {
+  ClipWorkspace<T> workspace;
+  workspace.degeneracy = degeneracy;
+  workspace.stats = stats;
+
+  return ClipAlgorithm<T>::do_op(BoolOp::kUnion, subject, clipping, workspace);
+}
+
+template <typename T>
+BasicPolygon<T> BasicPolygon<T>::Diff(const BasicPolygonView<T> &subject,
+                                      const BasicPolygonView<T> &clipping,
+                                      Degeneracy degeneracy, ClipStats *stats) {
+  ClipWorkspace<T> workspace;
+  workspace.degeneracy = degeneracy;
+  workspace.stats = stats;
+
+  return ClipAlgorithm<T>::do_op(BoolOp::kDiff, subject, clipping, workspace);
+}
+
+template <typename T>
+void BasicPolygon<T>::Clip(const BasicPolygon &subject,
+                           const BasicPolygon &clipping,
+                           BasicPolygonBuffer<T> &result, Degeneracy degeneracy,
+                           ClipStats *stats) {
+  ClipWorkspace<T> workspace;
+  workspace.degeneracy = degeneracy;
+  workspace.stats = stats;
+
+  ClipAlgorithm<T>::do_op(BoolOp::kClip, subject, clipping, result, workspace);
+}
+
+template <typename T>
+void BasicPolygon<T>::Union(const BasicPolygon &subject,
+                            const BasicPolygon &clipping,
+                            BasicPolygonBuffer<T> &result,
+                            Degeneracy degeneracy, ClipStats *stats) {
+  ClipWorkspace<T> workspace;
+  workspace.degeneracy = degeneracy;
+  workspace.stats = stats;
+
+  ClipAlgorithm<T>::do_op(BoolOp::kUnion, subject, clipping, result,
+                          workspace);
+}
+
+template <typename T>
+void BasicPolygon<T>::Diff(const BasicPolygon &subject,
+                           const BasicPolygon &clipping,
+                           BasicPolygonBuffer<T> &result, Degeneracy degeneracy,
+                           ClipStats *stats) {
+  ClipWorkspace<T> workspace;
+  workspace.degeneracy = degeneracy;
+  workspace.stats = stats;
+
+  ClipAlgorithm<T>::do_op(BoolOp::kDiff, subject, clipping, result, workspace);
+}
+
+template <typename T>
+void BasicPolygon<T>::Clip(const BasicPolygonView<T> &subject,
+                           const BasicPolygonView<T> &clipping,
+                           BasicPolygonBuffer<T> &result, Degeneracy degeneracy,
+                           ClipStats *stats) {
+  ClipWorkspace<T> workspace;
+  workspace.degeneracy = degeneracy;
+  workspace.stats = stats;
+
+  ClipAlgorithm<T>::do_op(BoolOp::kClip, subject, clipping, result, workspace);
+}
 
-  return m_vertex.back().get();
+template <typename T>
+void BasicPolygon<T>::Union(const BasicPolygonView<T> &subject,
+                            const BasicPolygonView<T> &clipping,
+                            BasicPolygonBuffer<T> &result,
+                            Degeneracy degeneracy, ClipStats *stats) {
+  ClipWorkspace<T> workspace;
+  workspace.degeneracy = degeneracy;
+  workspace.stats = stats;
+
+  ClipAlgorithm<T>::do_op(BoolOp::kUnion, subject, clipping, result,
+                          workspace);
 }
 
-Vertex *Polygon::allocate_vertex(Vertex *p1, Vertex *p2, float t) {
-  // point between p1 and p2
-  auto p = p1->point * (1.f - t) + p2->point * t;
-  return allocate_vertex(p);
+template <typename T>
+void BasicPolygon<T>::Diff(const BasicPolygonView<T> &subject,
+                           const BasicPolygonView<T> &clipping,
+                           BasicPolygonBuffer<T> &result, Degeneracy degeneracy,
+                           ClipStats *stats) {
+  ClipWorkspace<T> workspace;
+  workspace.degeneracy = degeneracy;
+  workspace.stats = stats;
+
+  ClipAlgorithm<T>::do_op(BoolOp::kDiff, subject, clipping, result, workspace);
+}
+
+template <typename T>
+BasicPolygon<T>
+BasicPolygon<T>::UnionAll(const std::vector<BasicPolygon> &polygons,
+                          uint32_t thread_count, Degeneracy degeneracy) {
+  return UnionMerger<T>::merge_all(polygons, thread_count, degeneracy);
+}
+
+template <typename T>
+BasicPolygon<T> BasicPolygon<T>::Clip(const BasicPolygon &subject,
+                                      const BasicPolygon &clipping,
+                                      FillRule fill_rule, Degeneracy degeneracy,
+                                      ClipStats *stats) {
+  ClipWorkspace<T> workspace;
+  workspace.degeneracy = degeneracy;
+  workspace.stats = stats;
+  workspace.fill_rule = fill_rule;
+
+  return ClipAlgorithm<T>::do_op(BoolOp::kClip, subject, clipping, workspace);
+}
+
+template <typename T>
+BasicPolygon<T> BasicPolygon<T>::Union(const BasicPolygon &subject,
+                                       const BasicPolygon &clipping,
+                                       FillRule fill_rule,
+                                       Degeneracy degeneracy,
+                                       ClipStats *stats) {
+  ClipWorkspace<T> workspace;
+  workspace.degeneracy = degeneracy;
+  workspace.stats = stats;
+  workspace.fill_rule = fill_rule;
+
+  return ClipAlgorithm<T>::do_op(BoolOp::kUnion, subject, clipping, workspace);
 }
 
-Polygon Polygon::Clip(const Polygon &subject, const Polygon &clipping) {
-  return ClipAlgorithm::do_clip(Polygon(subject), Polygon(clipping));
+template <typename T>
+BasicPolygon<T> BasicPolygon<T>::Diff(const BasicPolygon &subject,
+                                      const BasicPolygon &clipping,
+                                      FillRule fill_rule, Degeneracy degeneracy,
+                                      ClipStats *stats) {
+  ClipWorkspace<T> workspace;
+  workspace.degeneracy = degeneracy;
+  workspace.stats = stats;
+  workspace.fill_rule = fill_rule;
+
+  return ClipAlgorithm<T>::do_op(BoolOp::kDiff, subject, clipping, workspace);
 }
 
-Polygon Polygon::Union(const Polygon &subject, const Polygon &clipping) {
-  return ClipAlgorithm::do_union(Polygon(subject), Polygon(clipping));
+template <typename T>
+const BasicPolygon<T> &BasicPolygon<T>::Clip(const BasicPolygon &subject,
+                                             const BasicPolygon &clipping,
+                                             BasicClipContext<T> &context) {
+  return context.run(BoolOp::kClip, subject, clipping);
 }
 
-Polygon Polygon::Diff(const Polygon &subject, const Polygon &clipping) {
-  return ClipAlgorithm::do_diff(Polygon(subject), Polygon(clipping));
+template <typename T>
+const BasicPolygon<T> &BasicPolygon<T>::Union(const BasicPolygon &subject,
+                                              const BasicPolygon &clipping,
+                                              BasicClipContext<T> &context) {
+  return context.run(BoolOp::kUnion, subject, clipping);
+}
+
+template <typename T>
+const BasicPolygon<T> &BasicPolygon<T>::Diff(const BasicPolygon &subject,
+                                             const BasicPolygon &clipping,
+                                             BasicClipContext<T> &context) {
+  return context.run(BoolOp::kDiff, subject, clipping);
+}
+
+template <typename T>
+BasicClipContext<T>::BasicClipContext(Degeneracy degeneracy)
+    : m_workspace(std::make_unique<ClipWorkspace<T>>()) {
+  m_workspace->degeneracy = degeneracy;
+}
+
+template <typename T> BasicClipContext<T>::~BasicClipContext() = default;
+
+template <typename T>
+void BasicClipContext<T>::set_degeneracy(Degeneracy degeneracy) {
+  m_workspace->degeneracy = degeneracy;
 }
 
+template <typename T>
+void BasicClipContext<T>::set_fill_rule(std::optional<FillRule> fill_rule) {
+  m_workspace->fill_rule = fill_rule;
+}
+
+template <typename T> void BasicClipContext<T>::set_stats(ClipStats *stats) {
+  m_workspace->stats = stats;
+}
+
+template <typename T>
+const BasicPolygon<T> &BasicClipContext<T>::run(BoolOp op,
+                                                const Polygon &subject,
+                                                const Polygon &clipping) {
+  if (&subject == &m_result || &clipping == &m_result) {
+    // chained on the previous result, which must stay intact until the
+    // working copies are made
+    auto result = ClipAlgorithm<T>::do_op(op, subject, clipping, *m_workspace);
+    m_workspace->result = std::move(m_result);
+    m_result = std::move(result);
+
+    return m_result;
+  }
+
+  // the previous result becomes the storage of the new one
+  m_workspace->result = std::move(m_result);
+  m_result = ClipAlgorithm<T>::do_op(op, subject, clipping, *m_workspace);
+
+  return m_result;
+}
+
+template <typename T>
+const BasicPolygon<T> &
+BasicClipContext<T>::run(BoolOp op, const BasicPolygonView<T> &subject,
+                         const BasicPolygonView<T> &clipping) {
+  // views never point into the previous result
+  m_workspace->result = std::move(m_result);
+  m_result = ClipAlgorithm<T>::do_op(op, subject, clipping, *m_workspace);
+
+  return m_result;
+}
+
+template struct BasicPolygonView<float>;
+template struct BasicPolygonView<double>;
+template struct BasicPolygonView<int32_t>;
+template struct BasicPolygonBuffer<float>;
+template struct BasicPolygonBuffer<double>;
+template struct BasicPolygonBuffer<int32_t>;
+template class BasicVertexArena<float>;
+template class BasicVertexArena<double>;
+template class BasicVertexArena<int32_t>;
+template class BasicPolygon<float>;
+template class BasicPolygon<double>;
+template class BasicPolygon<int32_t>;
+template class BasicClipContext<float>;
+template class BasicClipContext<double>;
+template class BasicClipContext<int32_t>;
+
 } // namespace pc
@@ -0,0 +1,589 @@
+#include "polygon_clip_batch.hpp"
+#include "polygon_clip_priv.hpp"
+#include "polygon_clip_sweep.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace pc {
+
+// crossing vertices on the subject side are addressed with this bit set
+constexpr uint32_t kCrossingNode = 1u << 31;
+
+constexpr uint32_t kEdgesPerBand = 8;
+
+template <typename T>
+static bool is_axis_aligned_rect(const FlatPolygon<T> &window) {
+  if (window.ring_count() != 1 || window.input_count() != 4) {
+    return false;
+  }
+
+  const auto &bounds = *window.bounds;
+
+  if (bounds.left_top.x == bounds.right_bottom.x ||
+      bounds.left_top.y == bounds.right_bottom.y) {
+    return false;
+  }
+
+  uint32_t corners = 0;
+
+  for (uint32_t i = 0; i < 4; i++) {
+    uint32_t j = (i + 1) % 4;
+
+    bool x_min = window.x[i] == bounds.left_top.x;
+    bool x_max = window.x[i] == bounds.right_bottom.x;
+    bool y_min = window.y[i] == bounds.left_top.y;
+    bool y_max = window.y[i] == bounds.right_bottom.y;
+
+    if ((!x_min && !x_max) || (!y_min && !y_max)) {
+      return false;
+    }
+
+    // every edge must be horizontal or vertical
+    if (window.x[i] != window.x[j] && window.y[i] != window.y[j]) {
+      return false;
+    }
+
+    corners |= 1u << ((x_max ? 1 : 0) + (y_max ? 2 : 0));
+  }
+
+  return corners == 0xf;
+}
+
+/**
+ * Same half-open rule as the crossing test in FlatPolygon::contains
+ */
+template <typename T>
+static bool rect_contains(const BasicRect<T> &rect, const BasicPoint<T> &p) {
+  return p.x >= rect.left_top.x && p.x < rect.right_bottom.x &&
+         p.y >= rect.left_top.y && p.y < rect.right_bottom.y;
+}
+
+/**
+ * Same for p moved by shift times the symbolic offset (e, e^2), never
+ * undecided on the boundary
+ */
+template <typename T>
+static bool rect_contains(const BasicRect<T> &rect, const BasicPoint<T> &p,
+                          int shift) {
+  if (shift > 0) {
+    return rect_contains(rect, p);
+  }
+
+  return p.x > rect.left_top.x && p.x <= rect.right_bottom.x &&
+         p.y > rect.left_top.y && p.y <= rect.right_bottom.y;
+}
+
+template <typename T>
+static void append_ring(BasicPolygon<T> &result, const FlatPolygon<T> &polygon,
+                        size_t ring) {
+  std::vector<BasicPoint<T>> pts;
+
+  for (uint32_t i = polygon.ring_offsets[ring];
+       i < polygon.ring_offsets[ring + 1]; i++) {
+    pts.emplace_back(polygon.point(i));
+  }
+
+  result.append_vertices(pts);
+}
+
+template <typename T>
+BatchClipper<T>::BatchClipper(const Polygon &subject, Degeneracy degeneracy)
+    : m_subject(subject), m_degeneracy(degeneracy) {
+  m_edge_crossing.resize(m_subject.input_count(), kInvalidIndex);
+  m_local.resize(m_subject.input_count(), kInvalidIndex);
+
+  build_bands();
+}
+
+template <typename T> void BatchClipper<T>::build_bands() {
+  if (!m_subject.bounds) {
+    return;
+  }
+
+  uint32_t count = m_subject.input_count();
+  uint32_t band_count = std::max<uint32_t>(1, count / kEdgesPerBand);
+
+  T height = m_subject.bounds->right_bottom.y - m_subject.bounds->left_top.y;
+
+  if (height <= 0) {
+    band_count = 1;
+    height = 1;
+  }
+
+  m_band_top = m_subject.bounds->left_top.y;
+  m_band_height = height / band_count;
+  m_band_offsets.assign(band_count + 1, 0);
+
+  // count edges in each band, then place them
+  for (uint32_t e = 0; e < count; e++) {
+    auto j = m_subject.next[e];
+    auto b0 = band_of(std::min(m_subject.y[e], m_subject.y[j]));
+    auto b1 = band_of(std::max(m_subject.y[e], m_subject.y[j]));
+
+    for (auto b = b0; b <= b1; b++) {
+      m_band_offsets[b + 1]++;
+    }
+  }
+
+  for (uint32_t b = 0; b < band_count; b++) {
+    m_band_offsets[b + 1] += m_band_offsets[b];
+  }
+
+  std::vector<uint32_t> cursor(m_band_offsets.begin(),
+                               m_band_offsets.end() - 1);
+  m_band_edges.resize(m_band_offsets.back());
+
+  for (uint32_t e = 0; e < count; e++) {
+    auto j = m_subject.next[e];
+    auto b0 = band_of(std::min(m_subject.y[e], m_subject.y[j]));
+    auto b1 = band_of(std::max(m_subject.y[e], m_subject.y[j]));
+
+    for (auto b = b0; b <= b1; b++) {
+      m_band_edges[cursor[b]++] = e;
+    }
+  }
+}
+
+template <typename T> uint32_t BatchClipper<T>::band_of(T y) const {
+  auto band_count = static_cast<int64_t>(m_band_offsets.size()) - 1;
+  auto band =
+      static_cast<int64_t>(std::floor((y - m_band_top) / m_band_height));
+
+  return static_cast<uint32_t>(std::clamp<int64_t>(band, 0, band_count - 1));
+}
+
+template <typename T>
+void BatchClipper<T>::collect_edges(const Rect &bounds, bool skip_inner,
+                                    std::vector<uint32_t> &edges) const {
+  auto b0 = band_of(bounds.left_top.y);
+  auto b1 = band_of(bounds.right_bottom.y);
+
+  for (auto b = b0; b <= b1; b++) {
+    for (auto k = m_band_offsets[b]; k < m_band_offsets[b + 1]; k++) {
+      auto e = m_band_edges[k];
+      auto j = m_subject.next[e];
+
+      Rect edge{Point(std::min(m_subject.x[e], m_subject.x[j]),
+                      std::min(m_subject.y[e], m_subject.y[j])),
+                Point(std::max(m_subject.x[e], m_subject.x[j]),
+                      std::max(m_subject.y[e], m_subject.y[j]))};
+
+      // an edge spanning several bands is only reported once
+      if (std::max(band_of(edge.left_top.y), b0) != b) {
+        continue;
+      }
+
+      if (!edge.overlaps(bounds)) {
+        continue;
+      }
+
+      if (skip_inner && edge.left_top.x > bounds.left_top.x &&
+          edge.right_bottom.x < bounds.right_bottom.x &&
+          edge.left_top.y > bounds.left_top.y &&
+          edge.right_bottom.y < bounds.right_bottom.y) {
+        continue;
+      }
+
+      edges.emplace_back(e);
+    }
+  }
+}
+
+template <typename T>
+bool BatchClipper<T>::subject_contains(const Point &p) const {
+  if (!m_subject.bounds || p.y < m_subject.bounds->left_top.y ||
+      p.y > m_subject.bounds->right_bottom.y) {
+    return false;
+  }
+
+  bool contains = false;
+
+  auto b = band_of(p.y);
+
+  for (auto k = m_band_offsets[b]; k < m_band_offsets[b + 1]; k++) {
+    auto curr = m_band_edges[k];
+    auto next = m_subject.next[curr];
+
+    const auto &x = m_subject.x;
+    const auto &y = m_subject.y;
+
+    if (((y[next] > p.y) != (y[curr] > p.y)) &&
+        (p.x < (x[curr] - x[next]) * (p.y - y[next]) / (y[curr] - y[next]) +
+                   x[next])) {
+      contains = !contains;
+    }
+  }
+
+  return contains;
+}
+
+template <typename T>
+bool BatchClipper<T>::subject_contains(const Point &p, int shift) const {
+  if (!m_subject.bounds || p.y < m_subject.bounds->left_top.y ||
+      p.y > m_subject.bounds->right_bottom.y) {
+    return false;
+  }
+
+  bool contains = false;
+
+  auto b = band_of(p.y);
+
+  for (auto k = m_band_offsets[b]; k < m_band_offsets[b + 1]; k++) {
+    auto curr = m_band_edges[k];
+
+    if (m_subject.ray_crosses(curr, m_subject.next[curr], p, shift)) {
+      contains = !contains;
+    }
+  }
+
+  return contains;
+}
+
+template <typename T> uint32_t BatchClipper<T>::ring_of(uint32_t v) const {
+  auto it = std::upper_bound(m_subject.ring_offsets.begin(),
+                             m_subject.ring_offsets.end(), v);
+
+  return static_cast<uint32_t>(it - m_subject.ring_offsets.begin()) - 1;
+}
+
+template <typename T>
+std::vector<EdgeIntersection<T>>
+BatchClipper<T>::find_crossings(const std::vector<uint32_t> &edges,
+                                const Polygon &window,
+                                FlatPolygon<T> &clipping, bool &symbolic) {
+  using EdgeRef = typename SweepLine<T>::EdgeRef;
+
+  std::vector<EdgeRef> refs;
+  refs.reserve(edges.size());
+
+  if (!symbolic) {
+    // Math::segment_intersect may perturb the vertices it tests, so the
+    // candidate edges are tested on local copies and the prepared subject is
+    // never modified
+    FlatPolygon<T> local;
+    std::vector<uint32_t> copied;
+
+    auto local_index = [&](uint32_t v) {
+      if (m_local[v] == kInvalidIndex) {
+        m_local[v] = local.allocate_vertex(m_subject.point(v));
+        copied.emplace_back(v);
+      }
+
+      return m_local[v];
+    };
+
+    for (auto e : edges) {
+      auto from = local_index(e);
+      auto to = local_index(m_subject.next[e]);
+
+      refs.emplace_back(EdgeRef{e, from, to});
+    }
+
+    auto intersections =
+        SweepLine<T>(local, refs, clipping).find_intersections();
+
+    for (auto v : copied) {
+      m_local[v] = kInvalidIndex;
+    }
+
+    // the crossings are placed on the prepared subject and the inside tests
+    // read its points, which no longer agree with a moved vertex
+    if (local.perturbations == 0 && clipping.perturbations == 0) {
+      return intersections;
+    }
+
+    symbolic = true;
+    clipping.assign(window);
+    refs.clear();
+  }
+
+  // the symbolic tests never write a vertex, the subject is swept in place
+  for (auto e : edges) {
+    refs.emplace_back(EdgeRef{e, e, m_subject.next[e]});
+  }
+
+  return SweepLine<T>(m_subject, refs, clipping, Degeneracy::kSymbolic)
+      .find_intersections();
+}
+
+template <typename T>
+BasicPolygon<T> BatchClipper<T>::clip(const Polygon &window) {
+  Polygon result;
+
+  auto window_bounds = window.get_bounds();
+
+  if (!window_bounds || !m_subject.bounds ||
+      !window_bounds->overlaps(*m_subject.bounds)) {
+    return result;
+  }
+
+  FlatPolygon<T> clipping(window);
+
+  bool rect = is_axis_aligned_rect(clipping);
+
+  std::vector<uint32_t> edges;
+  collect_edges(*window_bounds, rect, edges);
+
+  bool symbolic = m_degeneracy == Degeneracy::kSymbolic;
+
+  auto intersections = find_crossings(edges, window, clipping, symbolic);
+
+  // the subject is tested as if moved by minus the offset of the window, the
+  // window as if moved by plus it, see ClipAlgorithm::mark_vertices
+  auto inside_window = [&](const Point &p) {
+    if (symbolic) {
+      return rect ? rect_contains(*window_bounds, p, -1)
+                  : clipping.contains(p, -1);
+    }
+
+    return rect ? rect_contains(*window_bounds, p) : clipping.contains(p);
+  };
+
+  auto inside_subject = [&](const Point &p) {
+    return symbolic ? subject_contains(p, 1) : subject_contains(p);
+  };
+
+  // sorted by edge and t, the crossings follow the ring order of the subject
+  std::sort(intersections.begin(), intersections.end(),
+            [](const EdgeIntersection<T> &e1, const EdgeIntersection<T> &e2) {
+              if (e1.subject_edge != e2.subject_edge) {
+                return e1.subject_edge < e2.subject_edge;
+              }
+
+              return VertDistCompiler()(VertexDist<T>(0, e1.t1, e1.t1_order),
+                                        VertexDist<T>(0, e2.t1, e2.t1_order));
+            });
+
+  auto crossing_count = static_cast<uint32_t>(intersections.size());
+
+  // side table of the subject crossings
+  FlatPolygon<T> crossings;
+  crossings.reserve(crossing_count);
+  clipping.reserve(clipping.vertex_count() + crossing_count);
+
+  std::vector<uint32_t> crossing_edge(crossing_count);
+
+  for (uint32_t k = 0; k < crossing_count; k++) {
+    const auto &e = intersections[k];
+
+    auto from = e.subject_edge;
+    auto to = m_subject.next[from];
+
+    crossings.allocate_vertex(m_subject.point(from) * (1 - e.t1) +
+                              m_subject.point(to) * e.t1);
+    crossings.set_flag(k, kVertexIntersect, true);
+
+    auto i2 = clipping.allocate_vertex(e.clipping_edge,
+                                       clipping.next[e.clipping_edge], e.t2);
+    clipping.set_flag(i2, kVertexIntersect, true);
+
+    crossings.neighbour[k] = i2;
+    clipping.neighbour[i2] = k;
+
+    crossing_edge[k] = from;
+
+    if (m_edge_crossing[from] == kInvalidIndex) {
+      m_edge_crossing[from] = k;
+    }
+  }
+
+  // insert crossings into clipping edges
+  std::vector<uint32_t> clipping_order(crossing_count);
+  for (uint32_t k = 0; k < crossing_count; k++) {
+    clipping_order[k] = k;
+  }
+
+  std::sort(clipping_order.begin(), clipping_order.end(),
+            [&intersections](uint32_t i1, uint32_t i2) {
+              return intersections[i1].clipping_edge <
+                     intersections[i2].clipping_edge;
+            });
+
+  std::vector<VertexDist<T>> intersect_list;
+
+  for (size_t i = 0; i < clipping_order.size(); i++) {
+    const auto &e = intersections[clipping_order[i]];
+
+    intersect_list.emplace_back(VertexDist<T>(
+        crossings.neighbour[clipping_order[i]], e.t2, e.t2_order));
+
+    if (i + 1 == clipping_order.size() ||
+        intersections[clipping_order[i + 1]].clipping_edge !=
+            e.clipping_edge) {
+      clipping.insert_intersections(e.clipping_edge, intersect_list);
+      intersect_list.clear();
+    }
+  }
+
+  // mark clipping rings
+  std::vector<bool> clipping_crossed(clipping.ring_count(), false);
+
+  for (size_t r = 0; r < clipping.ring_count(); r++) {
+    auto head = clipping.ring_offsets[r];
+    bool status = !inside_subject(clipping.point(head));
+
+    auto current = head;
+    do {
+      if (clipping.has_flag(current, kVertexIntersect)) {
+        clipping.set_flag(current, kVertexEntryExit, status);
+        status = !status;
+
+        clipping_crossed[r] = true;
+      }
+
+      current = clipping.next[current];
+    } while (current != head);
+  }
+
+  // mark subject rings, crossings are already in ring order
+  std::vector<uint32_t> subject_crossed;
+
+  for (uint32_t k = 0; k < crossing_count;) {
+    auto ring = ring_of(crossing_edge[k]);
+    auto end = m_subject.ring_offsets[ring + 1];
+
+    bool status =
+        !inside_window(m_subject.point(m_subject.ring_offsets[ring]));
+
+    for (; k < crossing_count && crossing_edge[k] < end; k++) {
+      crossings.set_flag(k, kVertexEntryExit, status);
+      status = !status;
+    }
+
+    subject_crossed.emplace_back(ring);
+  }
+
+  // walk the subject through the side table
+  auto next_node = [&](uint32_t node) {
+    if (node & kCrossingNode) {
+      auto k = node & ~kCrossingNode;
+      if (k + 1 < crossing_count && crossing_edge[k + 1] == crossing_edge[k]) {
+        return (k + 1) | kCrossingNode;
+      }
+
+      return m_subject.next[crossing_edge[k]];
+    }
+
+    if (m_edge_crossing[node] != kInvalidIndex) {
+      return m_edge_crossing[node] | kCrossingNode;
+    }
+
+    return m_subject.next[node];
+  };
+
+  auto prev_node = [&](uint32_t node) {
+    if (node & kCrossingNode) {
+      auto k = node & ~kCrossingNode;
+      if (k > 0 && crossing_edge[k - 1] == crossing_edge[k]) {
+        return (k - 1) | kCrossingNode;
+      }
+
+      return crossing_edge[k];
+    }
+
+    auto prev = m_subject.prev[node];
+    auto k = m_edge_crossing[prev];
+
+    if (k == kInvalidIndex) {
+      return prev;
+    }
+
+    while (k + 1 < crossing_count && crossing_edge[k + 1] == prev) {
+      k++;
+    }
+
+    return k | kCrossingNode;
+  };
+
+  auto node_point = [&](uint32_t node) {
+    return node & kCrossingNode ? crossings.point(node & ~kCrossingNode)
+                                : m_subject.point(node);
+  };
+
+  for (uint32_t vert = 0; vert < crossing_count; vert++) {
+    if (crossings.has_flag(vert, kVertexMarked)) {
+      continue;
+    }
+
+    std::vector<Point> pts;
+
+    crossings.set_flag(vert, kVertexMarked, true);
+
+    uint32_t side = 0;
+    uint32_t current = vert | kCrossingNode;
+
+    pts.emplace_back(node_point(current));
+
+    do {
+      if (side == 0) {
+        bool forward = crossings.has_flag(current & ~kCrossingNode,
+                                          kVertexEntryExit);
+        do {
+          current = forward ? next_node(current) : prev_node(current);
+
+          pts.emplace_back(node_point(current));
+        } while (!(current & kCrossingNode));
+
+        auto k = current & ~kCrossingNode;
+        crossings.set_flag(k, kVertexMarked, true);
+        current = crossings.neighbour[k];
+        clipping.set_flag(current, kVertexMarked, true);
+      } else {
+        bool forward = clipping.has_flag(current, kVertexEntryExit);
+        do {
+          current = forward ? clipping.next[current] : clipping.prev[current];
+
+          pts.emplace_back(clipping.point(current));
+        } while (!clipping.has_flag(current, kVertexIntersect));
+
+        clipping.set_flag(current, kVertexMarked, true);
+        current = clipping.neighbour[current] | kCrossingNode;
+        crossings.set_flag(current & ~kCrossingNode, kVertexMarked, true);
+      }
+
+      side ^= 1;
+    } while (side != 0 || current != (vert | kCrossingNode));
+
+    result.append_vertices(pts);
+  }
+
+  for (auto e : crossing_edge) {
+    m_edge_crossing[e] = kInvalidIndex;
+  }
+
+  // rings without any crossing are either inside the other polygon or
+  // outside of it
+  size_t crossed = 0;
+  for (size_t r = 0; r < m_subject.ring_count(); r++) {
+    if (crossed < subject_crossed.size() && subject_crossed[crossed] == r) {
+      crossed++;
+      continue;
+    }
+
+    if (!m_subject.ring_bounds[r].overlaps(*window_bounds)) {
+      continue;
+    }
+
+    if (inside_window(m_subject.point(m_subject.ring_offsets[r]))) {
+      append_ring(result, m_subject, r);
+    }
+  }
+
+  for (size_t r = 0; r < clipping.ring_count(); r++) {
+    if (clipping_crossed[r]) {
+      continue;
+    }
+
+    if (inside_subject(clipping.point(clipping.ring_offsets[r]))) {
+      append_ring(result, clipping, r);
+    }
+  }
+
+  return result;
+}
+
+template class BatchClipper<float>;
+template class BatchClipper<double>;
+
+} // namespace pc
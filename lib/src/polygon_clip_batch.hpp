@@ -0,0 +1,97 @@
+#pragma once
+
+#include "polygon_clip.hpp"
+#include "polygon_clip_flat.hpp"
+#include "polygon_clip_sweep.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace pc {
+
+/**
+ * Clip one subject against many clipping windows.
+ *
+ * The subject is converted into a FlatPolygon once and its edges are indexed
+ * by horizontal bands. A window only visits the subject edges inside its
+ * bounding box, and the intersection vertices on the subject side live in a
+ * side table over the prepared subject, so no window copies, re-sorts or
+ * modifies the subject.
+ *
+ * Axis-aligned rectangle windows answer point in window by comparison and
+ * skip the segment tests for subject edges lying strictly inside them.
+ *
+ * Entry and exit marking starts from the state of the first vertex of each
+ * ring, and rings without any crossing are kept when they lie inside the
+ * other polygon.
+ *
+ * The prepared subject can not be perturbed. Under Degeneracy::kPerturb a
+ * window touching it, with a vertex on an edge or collinear edges, is
+ * searched again with Degeneracy::kSymbolic, and the inside tests of that
+ * window take the same symbolic offset, so they agree with the crossings
+ * found. Under Degeneracy::kSymbolic every window is searched that way.
+ */
+template <typename T> class BatchClipper {
+public:
+  using Point = BasicPoint<T>;
+  using Rect = BasicRect<T>;
+  using Polygon = BasicPolygon<T>;
+
+  explicit BatchClipper(const Polygon &subject,
+                        Degeneracy degeneracy = Degeneracy::kPerturb);
+  ~BatchClipper() = default;
+
+  Polygon clip(const Polygon &window);
+
+private:
+  void build_bands();
+
+  uint32_t band_of(T y) const;
+
+  /**
+   * Crossings of the subject edges with clipping. Unless symbolic is set they
+   * are first searched on copies of the edges the sweep may perturb, if a
+   * vertex was moved the search is repeated with Degeneracy::kSymbolic and
+   * symbolic is set.
+   */
+  std::vector<EdgeIntersection<T>>
+  find_crossings(const std::vector<uint32_t> &edges, const Polygon &window,
+                 FlatPolygon<T> &clipping, bool &symbolic);
+
+  /**
+   * Subject edges overlapping bounds, edges strictly inside bounds are skipped
+   * if skip_inner is true
+   */
+  void collect_edges(const Rect &bounds, bool skip_inner,
+                     std::vector<uint32_t> &edges) const;
+
+  /**
+   * Even-odd point in subject test, only scans the band containing p
+   */
+  bool subject_contains(const Point &p) const;
+
+  /**
+   * Same test for p moved by shift times the symbolic offset
+   */
+  bool subject_contains(const Point &p, int shift) const;
+
+  uint32_t ring_of(uint32_t v) const;
+
+private:
+  FlatPolygon<T> m_subject = {};
+  Degeneracy m_degeneracy = Degeneracy::kPerturb;
+  // edges overlapping band b are stored in
+  // m_band_edges[m_band_offsets[b], m_band_offsets[b + 1])
+  T m_band_top = 0;
+  T m_band_height = 1;
+  std::vector<uint32_t> m_band_offsets = {};
+  std::vector<uint32_t> m_band_edges = {};
+  // per subject vertex scratch, reset after every window
+  std::vector<uint32_t> m_edge_crossing = {};
+  std::vector<uint32_t> m_local = {};
+};
+
+extern template class BatchClipper<float>;
+extern template class BatchClipper<double>;
+
+} // namespace pc
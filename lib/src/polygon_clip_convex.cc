@@ -0,0 +1,757 @@
+#include "polygon_clip_convex.hpp"
+#include "polygon_clip_math.hpp"
+#include "polygon_clip_scalar.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace pc {
+
+template <typename T>
+void ConvexClipper<T>::set_window(const std::vector<Point> &corners) {
+  m_corners.assign(corners.begin(), corners.end());
+
+  build_window();
+}
+
+template <typename T> void ConvexClipper<T>::set_window(const Vertex *head) {
+  m_corners.clear();
+
+  auto v = head;
+  do {
+    m_corners.emplace_back(v->point);
+    v = v->next;
+  } while (v != head);
+
+  build_window();
+}
+
+template <typename T> void ConvexClipper<T>::build_window() {
+  auto same = [](const Point &p1, const Point &p2) {
+    return p1.x == p2.x && p1.y == p2.y;
+  };
+
+  m_corners.erase(std::unique(m_corners.begin(), m_corners.end(), same),
+                  m_corners.end());
+  while (m_corners.size() > 1 && same(m_corners.front(), m_corners.back())) {
+    m_corners.pop_back();
+  }
+
+  // a corner on the line through its neighbours would make a point on the
+  // boundary lie on two sides
+  m_ring.clear();
+  for (size_t i = 0; i < m_corners.size(); i++) {
+    const auto &prev = m_corners[i > 0 ? i - 1 : m_corners.size() - 1];
+    const auto &next = m_corners[i + 1 < m_corners.size() ? i + 1 : 0];
+
+    if (Math::orientation(prev, m_corners[i], next, 0) != 0) {
+      m_ring.emplace_back(m_corners[i]);
+    }
+  }
+  m_corners.swap(m_ring);
+
+  m_corner_pos.clear();
+  m_directions.clear();
+
+  if (m_corners.size() < 3) {
+    m_corners.clear();
+    return;
+  }
+
+  if (Math::orientation(m_corners[0], m_corners[1], m_corners[2], 0) < 0) {
+    std::reverse(m_corners.begin(), m_corners.end());
+  }
+
+  // positions only need to grow along each side, the length along x plus the
+  // length along y keeps them exact for axis-aligned sides
+  double pos = 0;
+  m_bounds = Rect(m_corners[0], m_corners[0]);
+
+  auto step = [](T from, T to) {
+    return static_cast<int8_t>((to > from) - (to < from));
+  };
+
+  for (uint32_t side = 0; side < side_count(); side++) {
+    const auto &c = m_corners[side];
+    const auto &d = m_corners[side + 1 < side_count() ? side + 1 : 0];
+
+    m_directions.emplace_back(SideDirection{step(c.x, d.x), step(c.y, d.y)});
+    m_corner_pos.emplace_back(pos);
+    pos += std::abs(static_cast<double>(d.x) - c.x) +
+           std::abs(static_cast<double>(d.y) - c.y);
+
+    m_bounds.left_top.x = std::min(m_bounds.left_top.x, c.x);
+    m_bounds.left_top.y = std::min(m_bounds.left_top.y, c.y);
+    m_bounds.right_bottom.x = std::max(m_bounds.right_bottom.x, c.x);
+    m_bounds.right_bottom.y = std::max(m_bounds.right_bottom.y, c.y);
+  }
+
+  m_corner_pos.emplace_back(pos);
+}
+
+template <typename T>
+void ConvexClipper<T>::clip(const Polygon &subject, Region region,
+                            ResultSink<T> &sink) {
+  m_outward = region == Region::kSubjectOnly || region == Region::kUnion;
+  bool keep_inside =
+      region == Region::kIntersection || region == Region::kSubjectOnly;
+
+  m_points.clear();
+  m_fragments.clear();
+  m_crossings.clear();
+  m_open_rings.clear();
+  m_kept_rings.clear();
+
+  if (m_corners.empty()) {
+    // a window without area leaves the subject as it is
+    if (m_outward) {
+      for (size_t r = 0; r < subject.m_sub_polygons.size(); r++) {
+        sink.add_ring(subject, r, false);
+      }
+    }
+    return;
+  }
+
+  for (uint32_t i = 0; i < subject.m_sub_polygons.size(); i++) {
+    const auto &bounds = subject.m_sub_bounds[i];
+
+    if (!bounds.overlaps(m_bounds)) {
+      // can neither reach nor surround the window
+      if (m_outward) {
+        m_kept_rings.emplace_back(i);
+      }
+    } else if (in_closed(bounds.left_top) && in_closed(bounds.right_bottom) &&
+               in_closed(Point(bounds.left_top.x, bounds.right_bottom.y)) &&
+               in_closed(Point(bounds.right_bottom.x, bounds.left_top.y))) {
+      // the window is convex, so it holds the whole ring
+      if (!m_outward) {
+        m_kept_rings.emplace_back(i);
+      }
+    } else {
+      clip_ring(subject, i);
+    }
+  }
+
+  if (!m_crossings.empty()) {
+    connect(keep_inside, sink);
+  } else {
+    // no ring crosses the boundary, the window is inside the subject or not
+    uint32_t side;
+    auto q = perimeter_point(m_corner_pos[1] / 2, side);
+
+    if (inside_near(q, side, m_outward) == keep_inside) {
+      if (region == Region::kSubjectOnly) {
+        // a hole in the subject
+        m_walk.assign(m_corners.rbegin(), m_corners.rend());
+        sink.add_ring(m_walk);
+      } else {
+        sink.add_ring(m_corners);
+      }
+    }
+  }
+
+  // rings no boundary touches are kept where they are, those of the subject
+  // inside the window bound holes of the window outside the subject
+  for (auto ring : m_kept_rings) {
+    sink.add_ring(subject, ring, region == Region::kWindowOnly);
+  }
+}
+
+template <typename T>
+int ConvexClipper<T>::side_orientation(uint32_t side, const Point &p) const {
+  const auto &c = m_corners[side];
+  auto direction = m_directions[side];
+
+  if (direction.dy == 0) {
+    return direction.dx * ((p.y > c.y) - (p.y < c.y));
+  }
+  if (direction.dx == 0) {
+    return direction.dy * ((p.x < c.x) - (p.x > c.x));
+  }
+
+  const auto &d = m_corners[side + 1 < side_count() ? side + 1 : 0];
+
+  return Math::orientation(c, d, p, 0);
+}
+
+template <typename T> uint32_t ConvexClipper<T>::locate(const Point &p) const {
+  if (p.x < m_bounds.left_top.x || p.x > m_bounds.right_bottom.x ||
+      p.y < m_bounds.left_top.y || p.y > m_bounds.right_bottom.y) {
+    return kOuter;
+  }
+
+  uint32_t location = kInner;
+
+  for (uint32_t side = 0; side < side_count(); side++) {
+    int o = side_orientation(side, p);
+
+    if (o < 0) {
+      return kOuter;
+    }
+    if (o == 0 && location == kInner) {
+      location = side;
+    }
+  }
+
+  return location;
+}
+
+template <typename T>
+bool ConvexClipper<T>::clip_edge(const Point &a, const Point &b,
+                                 SideHit &enter, SideHit &leave) const {
+  enter = SideHit{0, 0};
+  leave = SideHit{1, 0};
+
+  if ((a.x < m_bounds.left_top.x && b.x < m_bounds.left_top.x) ||
+      (a.x > m_bounds.right_bottom.x && b.x > m_bounds.right_bottom.x) ||
+      (a.y < m_bounds.left_top.y && b.y < m_bounds.left_top.y) ||
+      (a.y > m_bounds.right_bottom.y && b.y > m_bounds.right_bottom.y)) {
+    return false;
+  }
+
+  for (uint32_t side = 0; side < side_count(); side++) {
+    int oa = side_orientation(side, a);
+    int ob = side_orientation(side, b);
+
+    if (oa >= 0 && ob >= 0) {
+      continue;
+    }
+    if (oa <= 0 && ob <= 0) {
+      // outside of the side or touching it at an end point
+      return false;
+    }
+
+    // the signs are exact, only the parameter between them is rounded
+    const auto &c = m_corners[side];
+    const auto &d = m_corners[side + 1 < side_count() ? side + 1 : 0];
+    double ex = static_cast<double>(d.x) - c.x;
+    double ey = static_cast<double>(d.y) - c.y;
+    double da = ex * (static_cast<double>(a.y) - c.y) -
+                ey * (static_cast<double>(a.x) - c.x);
+    double db = ex * (static_cast<double>(b.y) - c.y) -
+                ey * (static_cast<double>(b.x) - c.x);
+
+    double t = oa == 0   ? 0.0
+               : ob == 0 ? 1.0
+                         : std::clamp(da / (da - db), 0.0, 1.0);
+
+    if (oa < 0) {
+      if (t > enter.t) {
+        enter = SideHit{t, side};
+      }
+    } else if (t < leave.t) {
+      leave = SideHit{t, side};
+    }
+  }
+
+  return enter.t < leave.t;
+}
+
+template <typename T>
+bool ConvexClipper<T>::along_side(const Point &a, const Point &b) const {
+  for (uint32_t side = 0; side < side_count(); side++) {
+    if (side_orientation(side, a) == 0 && side_orientation(side, b) == 0) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+template <typename T>
+typename ConvexClipper<T>::BoundaryPoint
+ConvexClipper<T>::boundary_point(const Point &p, uint32_t side) const {
+  const auto &c = m_corners[side];
+  const auto &d = m_corners[side + 1 < side_count() ? side + 1 : 0];
+  double ex = static_cast<double>(d.x) - c.x;
+  double ey = static_cast<double>(d.y) - c.y;
+
+  double s = std::abs(ex) >= std::abs(ey)
+                 ? (static_cast<double>(p.x) - c.x) / ex
+                 : (static_cast<double>(p.y) - c.y) / ey;
+
+  return BoundaryPoint{p, perimeter_pos(side, std::clamp(s, 0.0, 1.0))};
+}
+
+template <typename T>
+typename ConvexClipper<T>::BoundaryPoint
+ConvexClipper<T>::side_point(const Point &a, const Point &b,
+                             uint32_t side) const {
+  // an end point on the line is taken as it is
+  if (side_orientation(side, a) == 0) {
+    return boundary_point(a, side);
+  }
+  if (side_orientation(side, b) == 0) {
+    return boundary_point(b, side);
+  }
+
+  const auto &c = m_corners[side];
+  const auto &d = m_corners[side + 1 < side_count() ? side + 1 : 0];
+  double ex = static_cast<double>(d.x) - c.x;
+  double ey = static_cast<double>(d.y) - c.y;
+  double fx = static_cast<double>(b.x) - a.x;
+  double fy = static_cast<double>(b.y) - a.y;
+  double acx = static_cast<double>(a.x) - c.x;
+  double acy = static_cast<double>(a.y) - c.y;
+
+  // a + t * f = c + s * e
+  double s = std::clamp((acx * fy - acy * fx) / (ex * fy - ey * fx), 0.0, 1.0);
+
+  // measured from the nearer corner, a coordinate shared by both corners is
+  // kept exactly
+  double x = s < 0.5 ? c.x + s * ex : d.x - (1 - s) * ex;
+  double y = s < 0.5 ? c.y + s * ey : d.y - (1 - s) * ey;
+
+  auto snap = [](double v) {
+    if constexpr (ScalarTraits<T>::kExact) {
+      return static_cast<T>(std::llround(v));
+    } else {
+      return static_cast<T>(v);
+    }
+  };
+
+  // the position is taken before rounding, crossings rounded to the same
+  // point keep their order along the side
+  return BoundaryPoint{Point(snap(x), snap(y)), perimeter_pos(side, s)};
+}
+
+template <typename T>
+double ConvexClipper<T>::perimeter_pos(uint32_t side, double s) const {
+  // a corner is at the same position seen from both of its sides, the first
+  // one at 0 and not at the full perimeter
+  if (s >= 1) {
+    return side + 1 < side_count() ? m_corner_pos[side + 1] : 0;
+  }
+
+  double pos = m_corner_pos[side] +
+               s * (m_corner_pos[side + 1] - m_corner_pos[side]);
+
+  return pos < m_corner_pos.back() ? pos : 0;
+}
+
+template <typename T>
+BasicPoint<double> ConvexClipper<T>::perimeter_point(double pos,
+                                                     uint32_t &side) const {
+  side = static_cast<uint32_t>(
+      std::upper_bound(m_corner_pos.begin(), m_corner_pos.end() - 1, pos) -
+      m_corner_pos.begin() - 1);
+
+  const auto &c = m_corners[side];
+  const auto &d = m_corners[side + 1 < side_count() ? side + 1 : 0];
+  double s = (pos - m_corner_pos[side]) /
+             (m_corner_pos[side + 1] - m_corner_pos[side]);
+
+  double ex = static_cast<double>(d.x) - c.x;
+  double ey = static_cast<double>(d.y) - c.y;
+
+  return BasicPoint<double>(s < 0.5 ? c.x + s * ex : d.x - (1 - s) * ex,
+                            s < 0.5 ? c.y + s * ey : d.y - (1 - s) * ey);
+}
+
+template <typename T>
+void ConvexClipper<T>::clip_ring(const Polygon &subject, uint32_t ring) {
+  auto head = subject.m_sub_polygons[ring];
+
+  m_ring.clear();
+  m_locations.clear();
+
+  uint32_t first_outer = kOuter;
+  uint32_t first_closed = kOuter;
+
+  auto v = head;
+  do {
+    auto location = locate(v->point);
+    auto index = static_cast<uint32_t>(m_ring.size());
+
+    if (location == kOuter) {
+      first_outer = std::min(first_outer, index);
+    } else {
+      first_closed = std::min(first_closed, index);
+    }
+
+    m_ring.emplace_back(v->point);
+    m_locations.emplace_back(location);
+    v = v->next;
+  } while (v != head);
+
+  if (first_outer == kOuter) {
+    // the window holds the whole ring
+    if (!m_outward) {
+      m_kept_rings.emplace_back(ring);
+    }
+    return;
+  }
+
+  m_open_rings.emplace_back(head);
+
+  auto n = static_cast<uint32_t>(m_ring.size());
+  auto next = [n](uint32_t i) { return i + 1 < n ? i + 1 : 0; };
+
+  SideHit enter;
+  SideHit leave;
+
+  // start off the side the runs are on, so no run wraps around the start
+  uint32_t start = m_outward ? first_closed : first_outer;
+  bool split = false;
+  SideHit split_enter;
+
+  if (start == kOuter) {
+    // every vertex is outside, start within an edge through the window
+    for (uint32_t i = 0; i < n && !split; i++) {
+      if (clip_edge(m_ring[i], m_ring[next(i)], split_enter, leave)) {
+        start = i;
+        split = true;
+      }
+    }
+
+    if (!split) {
+      m_kept_rings.emplace_back(ring);
+      return;
+    }
+  }
+
+  // a run starts and ends where the ring enters or leaves the open inside of
+  // the window, or the open outside, vertices on the boundary count as off
+  // the run, so runs along a side or touching it are left to the boundary
+  // stretches
+  bool inside = false;
+  uint32_t i = start;
+
+  if (split) {
+    open_fragment(side_point(m_ring[start], m_ring[next(start)], leave.side));
+    m_points.emplace_back(m_ring[next(start)]);
+
+    inside = true;
+    i = next(start);
+  }
+
+  do {
+    uint32_t j = next(i);
+    const auto &p1 = m_ring[i];
+    const auto &p2 = m_ring[j];
+    auto location1 = m_locations[i];
+    auto location2 = m_locations[j];
+    bool p2_inside = location2 == (m_outward ? kOuter : kInner);
+
+    if (inside && p2_inside) {
+      if (m_outward && clip_edge(p1, p2, enter, leave)) {
+        // through the window between two points outside
+        close_fragment(side_point(p1, p2, enter.side));
+        open_fragment(side_point(p1, p2, leave.side));
+      }
+      m_points.emplace_back(p2);
+    } else if (inside) {
+      if (m_outward) {
+        bool overlap = clip_edge(p1, p2, enter, leave);
+        close_fragment(overlap || location2 == kInner
+                           ? side_point(p1, p2, enter.side)
+                           : boundary_point(p2, location2));
+      } else if (location2 != kOuter) {
+        close_fragment(boundary_point(p2, location2));
+      } else {
+        clip_edge(p1, p2, enter, leave);
+        close_fragment(side_point(p1, p2, leave.side));
+      }
+    } else if (p2_inside) {
+      if (m_outward) {
+        bool overlap = clip_edge(p1, p2, enter, leave);
+        open_fragment(overlap || location1 == kInner
+                          ? side_point(p1, p2, leave.side)
+                          : boundary_point(p1, location1));
+      } else if (location1 != kOuter) {
+        open_fragment(boundary_point(p1, location1));
+      } else {
+        clip_edge(p1, p2, enter, leave);
+        open_fragment(side_point(p1, p2, enter.side));
+      }
+      m_points.emplace_back(p2);
+    } else if (!m_outward && clip_edge(p1, p2, enter, leave) &&
+               !along_side(p1, p2)) {
+      // both ends off the inside, only a run through the inside counts, not
+      // one along a side or through a corner
+      open_fragment(location1 != kOuter ? boundary_point(p1, location1)
+                                        : side_point(p1, p2, enter.side));
+      close_fragment(location2 != kOuter ? boundary_point(p2, location2)
+                                         : side_point(p1, p2, leave.side));
+    }
+
+    inside = p2_inside;
+    i = j;
+  } while (i != start);
+
+  if (split) {
+    close_fragment(
+        side_point(m_ring[start], m_ring[next(start)], split_enter.side));
+  }
+}
+
+template <typename T>
+void ConvexClipper<T>::open_fragment(const BoundaryPoint &p) {
+  auto fragment = static_cast<uint32_t>(m_fragments.size());
+  auto begin = static_cast<uint32_t>(m_points.size());
+  auto entry = static_cast<uint32_t>(m_crossings.size());
+
+  m_fragments.emplace_back(Fragment{begin, begin, entry, entry, false});
+  m_crossings.emplace_back(Crossing{p.pos, fragment, true});
+  m_points.emplace_back(p.point);
+}
+
+template <typename T>
+void ConvexClipper<T>::close_fragment(const BoundaryPoint &p) {
+  auto &fragment = m_fragments.back();
+
+  m_points.emplace_back(p.point);
+
+  bool single_point =
+      std::all_of(m_points.begin() + fragment.begin, m_points.end(),
+                  [&p](const Point &q) {
+                    return q.x == p.point.x && q.y == p.point.y;
+                  });
+
+  if (single_point) {
+    // a run through a corner of the inside too small for the coordinates
+    m_points.resize(fragment.begin);
+    m_crossings.pop_back();
+    m_fragments.pop_back();
+    return;
+  }
+
+  fragment.end = static_cast<uint32_t>(m_points.size());
+  fragment.exit = static_cast<uint32_t>(m_crossings.size());
+  m_crossings.emplace_back(
+      Crossing{p.pos, m_crossings[fragment.entry].fragment, false});
+}
+
+template <typename T>
+bool ConvexClipper<T>::inside_near(const BasicPoint<double> &q, uint32_t side,
+                                   bool outward) const {
+  // strictly on the side of the line q is moved to
+  int toward = outward ? -1 : 1;
+  auto beyond = [this, side, toward](const Point &p) {
+    return side_orientation(side, p) == toward;
+  };
+
+  const auto &c = m_corners[side];
+  const auto &d = m_corners[side + 1 < side_count() ? side + 1 : 0];
+  double ex = static_cast<double>(d.x) - c.x;
+  double ey = static_cast<double>(d.y) - c.y;
+
+  // cast a ray from q along side, counter-clockwise seen from inside, and
+  // count the edges crossing it once q is moved
+  bool inside = false;
+
+  for (auto head : m_open_rings) {
+    auto v = head;
+    bool in1 = beyond(v->point);
+
+    do {
+      const auto &p1 = v->point;
+      const auto &p2 = v->next->point;
+      v = v->next;
+
+      bool in2 = beyond(p2);
+      if (in1 == in2) {
+        continue;
+      }
+      in1 = in2;
+
+      int o = Math::orientation(BasicPoint<double>(p1.x, p1.y),
+                                BasicPoint<double>(p2.x, p2.y), q, 0);
+      bool ahead;
+      if (o != 0) {
+        ahead = (in2 ? o > 0 : o < 0) != outward;
+      } else {
+        // the edge runs through q, ahead of it once moved if it leans along
+        // the ray
+        double along = (static_cast<double>(p2.x) - p1.x) * ex +
+                       (static_cast<double>(p2.y) - p1.y) * ey;
+        ahead = along != 0 && (along > 0) == in2;
+      }
+
+      if (ahead) {
+        inside = !inside;
+      }
+    } while (v != head);
+  }
+
+  return inside;
+}
+
+template <typename T>
+void ConvexClipper<T>::connect(bool keep_inside, ResultSink<T> &sink) {
+  auto count = static_cast<uint32_t>(m_crossings.size());
+  auto corner_count = side_count();
+  double perimeter = m_corner_pos.back();
+
+  // crossings along the perimeter, rank maps a crossing to its position
+  m_order.resize(count);
+  for (uint32_t i = 0; i < count; i++) {
+    m_order[i] = i;
+  }
+  std::sort(m_order.begin(), m_order.end(), [this](uint32_t i1, uint32_t i2) {
+    return m_crossings[i1].pos < m_crossings[i2].pos ||
+           (m_crossings[i1].pos == m_crossings[i2].pos && i1 < i2);
+  });
+
+  m_rank.resize(count);
+  for (uint32_t k = 0; k < count; k++) {
+    m_rank[m_order[k]] = k;
+  }
+
+  // stretch k runs from crossing m_order[k] to m_order[k + 1], the last one
+  // wraps around, find the longest straight part of any stretch
+  auto corner_at = [&](uint32_t c) {
+    return c < corner_count ? m_corner_pos[c]
+                            : m_corner_pos[c - corner_count] + perimeter;
+  };
+
+  uint32_t best_stretch = 0;
+  double best_length = -1;
+  double best_pos = 0;
+  uint32_t c = 0;
+
+  for (uint32_t k = 0; k < count; k++) {
+    double from = m_crossings[m_order[k]].pos;
+    double to = k + 1 < count ? m_crossings[m_order[k + 1]].pos
+                              : m_crossings[m_order[0]].pos + perimeter;
+
+    while (c < 2 * corner_count && corner_at(c) <= from) {
+      c++;
+    }
+
+    double begin = from;
+    for (; c < 2 * corner_count && corner_at(c) < to; c++) {
+      if (corner_at(c) - begin > best_length) {
+        best_length = corner_at(c) - begin;
+        best_pos = (begin + corner_at(c)) / 2;
+        best_stretch = k;
+      }
+      begin = corner_at(c);
+    }
+
+    if (to - begin > best_length) {
+      best_length = to - begin;
+      best_pos = (begin + to) / 2;
+      best_stretch = k;
+    }
+  }
+
+  if (best_pos >= perimeter) {
+    best_pos -= perimeter;
+  }
+
+  uint32_t side;
+  auto q = perimeter_point(best_pos, side);
+
+  // every crossing flips whether the boundary is inside the subject
+  bool best_inside = inside_near(q, side, m_outward);
+  auto stretch_inside = [&](uint32_t k) {
+    return best_inside != ((k + count - best_stretch) % 2 == 1);
+  };
+
+  for (uint32_t first = 0; first < m_fragments.size(); first++) {
+    if (m_fragments[first].done) {
+      continue;
+    }
+
+    m_walk.clear();
+
+    uint32_t current = first;
+    bool forward = true;
+
+    while (!m_fragments[current].done) {
+      auto &fragment = m_fragments[current];
+      fragment.done = true;
+
+      if (forward) {
+        m_walk.insert(m_walk.end(), m_points.begin() + fragment.begin,
+                      m_points.begin() + fragment.end);
+      } else {
+        m_walk.insert(m_walk.end(),
+                      m_points.rbegin() + (m_points.size() - fragment.end),
+                      m_points.rbegin() + (m_points.size() - fragment.begin));
+      }
+
+      // leave along the stretch of boundary on the kept side of the subject
+      auto k = m_rank[forward ? fragment.exit : fragment.entry];
+      bool ccw = stretch_inside(k) == keep_inside;
+      auto next_k = ccw ? (k + 1) % count : (k + count - 1) % count;
+      bool wrap = ccw ? next_k == 0 : k == 0;
+
+      const auto &from = m_crossings[m_order[k]];
+      const auto &to = m_crossings[m_order[next_k]];
+      append_corners(from.pos, to.pos, ccw, wrap, m_walk);
+
+      current = to.fragment;
+      forward = to.entry;
+    }
+
+    emit_ring(m_walk, sink);
+  }
+}
+
+template <typename T>
+void ConvexClipper<T>::append_corners(double from_pos, double to_pos,
+                                      bool ccw, bool wrap,
+                                      std::vector<Point> &ring) const {
+  auto n = static_cast<int64_t>(side_count());
+  double perimeter = m_corner_pos.back();
+  auto corners_begin = m_corner_pos.begin();
+  auto corners_end = m_corner_pos.end() - 1;
+
+  if (ccw) {
+    if (wrap) {
+      to_pos += perimeter;
+    }
+
+    // from the first corner after from_pos
+    auto c = std::upper_bound(corners_begin, corners_end, from_pos) -
+             corners_begin;
+    for (; c < 2 * n; c++) {
+      double pos = c < n ? m_corner_pos[c] : m_corner_pos[c - n] + perimeter;
+      if (pos >= to_pos) {
+        break;
+      }
+      ring.emplace_back(m_corners[c % n]);
+    }
+  } else {
+    if (wrap) {
+      to_pos -= perimeter;
+    }
+
+    // from the last corner before from_pos
+    auto c = std::lower_bound(corners_begin, corners_end, from_pos) -
+             corners_begin - 1;
+    for (; c >= -n; c--) {
+      double pos = c >= 0 ? m_corner_pos[c] : m_corner_pos[c + n] - perimeter;
+      if (pos <= to_pos) {
+        break;
+      }
+      ring.emplace_back(m_corners[(c + n) % n]);
+    }
+  }
+}
+
+template <typename T>
+void ConvexClipper<T>::emit_ring(std::vector<Point> &ring,
+                                 ResultSink<T> &sink) const {
+  auto same = [](const Point &p1, const Point &p2) {
+    return p1.x == p2.x && p1.y == p2.y;
+  };
+
+  ring.erase(std::unique(ring.begin(), ring.end(), same), ring.end());
+  while (ring.size() > 1 && same(ring.front(), ring.back())) {
+    ring.pop_back();
+  }
+
+  // a run can only collapse if its crossings round to the same point
+  if (ring.size() >= 3) {
+    sink.add_ring(ring);
+  }
+}
+
+template class ConvexClipper<float>;
+template class ConvexClipper<double>;
+template class ConvexClipper<int32_t>;
+
+} // namespace pc
@@ -0,0 +1,237 @@
+#pragma once
+
+#include "polygon_clip.hpp"
+#include "polygon_clip_sink.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace pc {
+
+/**
+ * Boolean operations between a polygon and a convex window.
+ *
+ * Every ring is streamed once and each edge is clipped against the sides of
+ * the window with Cyrus-Beck. The runs of a ring through the open inside of
+ * the window, or through the open outside, become fragments starting and
+ * ending on the boundary, and no intersection vertex is ever spliced into a
+ * list. The fragments are then joined along the boundary: crossings are
+ * sorted by their position along the perimeter, and the stretches of boundary
+ * between neighbouring crossings are alternately inside and outside the
+ * subject next to the runs. A single point in polygon test next to the longest
+ * stretch decides which ones, edges along the boundary are thereby taken over
+ * by the stretches.
+ *
+ * Runs inside joined by the stretches inside the subject give the
+ * intersection, runs outside joined by them the subject outside the window.
+ * Taking the stretches outside the subject instead gives the window outside
+ * the subject and the union. Rings which never cross the boundary are kept or
+ * dropped as a whole. The region is the same as that of ClipAlgorithm under
+ * the even-odd rule, rings must not cross themselves.
+ */
+template <typename T> class ConvexClipper {
+public:
+  using Point = BasicPoint<T>;
+  using Rect = BasicRect<T>;
+  using Vertex = BasicVertex<T>;
+  using Polygon = BasicPolygon<T>;
+
+  /**
+   * Part of the plane an operation keeps
+   */
+  enum class Region {
+    // inside both
+    kIntersection,
+    // inside the subject but not the window
+    kSubjectOnly,
+    // inside the window but not the subject
+    kWindowOnly,
+    // inside either
+    kUnion,
+  };
+
+  ConvexClipper() = default;
+  ~ConvexClipper() = default;
+
+  /**
+   * Take the ring through corners as window, it must be convex and may run
+   * either way
+   */
+  void set_window(const std::vector<Point> &corners);
+
+  void set_window(const Vertex *head);
+
+  /**
+   * Write region of subject and the window to sink
+   */
+  void clip(const Polygon &subject, Region region, ResultSink<T> &sink);
+
+  /**
+   * Number of points where the last subject crossed the window boundary
+   */
+  size_t crossing_count() const { return m_crossings.size(); }
+
+private:
+  // location of a point strictly inside or outside the window, points on the
+  // boundary are located on their side
+  static constexpr uint32_t kInner = UINT32_MAX - 1;
+  static constexpr uint32_t kOuter = UINT32_MAX;
+
+  // where a fragment starts or ends on the boundary
+  struct Crossing {
+    // position along the perimeter, counter-clockwise from the first corner
+    double pos;
+    uint32_t fragment;
+    bool entry;
+  };
+
+  // run of a ring on one side of the boundary, m_points[begin, end)
+  struct Fragment {
+    uint32_t begin;
+    uint32_t end;
+    uint32_t entry;
+    uint32_t exit;
+    bool done;
+  };
+
+  // parameter along an edge where it meets side, side i runs from corner i to
+  // corner i + 1
+  struct SideHit {
+    double t;
+    uint32_t side;
+  };
+
+  // signs of the steps along x and y from the start to the end of a side
+  struct SideDirection {
+    int8_t dx;
+    int8_t dy;
+  };
+
+  // point where a ring meets the boundary
+  struct BoundaryPoint {
+    Point point;
+    // position along the perimeter, taken before rounding to T
+    double pos;
+  };
+
+  /**
+   * Drop repeated and collinear corners, orient the rest counter-clockwise
+   * and measure the perimeter
+   */
+  void build_window();
+
+  uint32_t side_count() const {
+    return static_cast<uint32_t>(m_corners.size());
+  }
+
+  /**
+   * Exact side of p relative to the line of side, positive towards the inside
+   */
+  int side_orientation(uint32_t side, const Point &p) const;
+
+  /**
+   * kInner, kOuter or the side p lies on
+   */
+  uint32_t locate(const Point &p) const;
+
+  bool in_closed(const Point &p) const { return locate(p) != kOuter; }
+
+  /**
+   * Clip a -> b against the closed window
+   *
+   * @return false if the part inside has no length
+   */
+  bool clip_edge(const Point &a, const Point &b, SideHit &enter,
+                 SideHit &leave) const;
+
+  /**
+   * Whether a -> b lies on the line of a side
+   */
+  bool along_side(const Point &a, const Point &b) const;
+
+  BoundaryPoint boundary_point(const Point &p, uint32_t side) const;
+
+  /**
+   * Point where a -> b meets the line of side, clamped to the side
+   */
+  BoundaryPoint side_point(const Point &a, const Point &b,
+                           uint32_t side) const;
+
+  /**
+   * Position along the perimeter of the point at s in [0, 1] along side
+   */
+  double perimeter_pos(uint32_t side, double s) const;
+
+  void clip_ring(const Polygon &subject, uint32_t ring);
+
+  void open_fragment(const BoundaryPoint &p);
+
+  void close_fragment(const BoundaryPoint &p);
+
+  /**
+   * Whether a point moved an infinitely small step from q across side, into
+   * the window unless outward is set, is inside the rings in m_open_rings
+   */
+  bool inside_near(const BasicPoint<double> &q, uint32_t side,
+                   bool outward) const;
+
+  /**
+   * Point at pos along the perimeter and the side it lies on
+   */
+  BasicPoint<double> perimeter_point(double pos, uint32_t &side) const;
+
+  /**
+   * Join fragments and the boundary stretches inside the subject, or outside
+   * it if keep_inside is false, into rings
+   */
+  void connect(bool keep_inside, ResultSink<T> &sink);
+
+  /**
+   * Append the corners passed when moving along the boundary from from_pos
+   * to to_pos, counter-clockwise if ccw is set. wrap is set if the move
+   * passes the first corner, which also tells a move around the whole
+   * boundary from one of no length.
+   */
+  void append_corners(double from_pos, double to_pos, bool ccw, bool wrap,
+                      std::vector<Point> &ring) const;
+
+  /**
+   * Write ring to sink unless it collapsed to fewer than three points
+   */
+  void emit_ring(std::vector<Point> &ring, ResultSink<T> &sink) const;
+
+private:
+  // counter-clockwise, corner_pos[i] is the position of corner i along the
+  // perimeter and corner_pos[side_count()] the whole perimeter
+  std::vector<Point> m_corners = {};
+  std::vector<double> m_corner_pos = {};
+  // axis-aligned sides are tested by comparison
+  std::vector<SideDirection> m_directions = {};
+  Rect m_bounds = {};
+
+  // runs outside the window instead of inside
+  bool m_outward = false;
+
+  // points and locations of the ring being clipped
+  std::vector<Point> m_ring = {};
+  std::vector<uint32_t> m_locations = {};
+
+  std::vector<Point> m_points = {};
+  std::vector<Fragment> m_fragments = {};
+  std::vector<Crossing> m_crossings = {};
+  // rings with a vertex outside, they decide which stretches are inside
+  std::vector<const Vertex *> m_open_rings = {};
+  // rings of the subject no run starts in which are part of the region
+  std::vector<uint32_t> m_kept_rings = {};
+  // crossings along the perimeter and the position of each in that order
+  std::vector<uint32_t> m_order = {};
+  std::vector<uint32_t> m_rank = {};
+  // points of the output ring being walked
+  std::vector<Point> m_walk = {};
+};
+
+extern template class ConvexClipper<float>;
+extern template class ConvexClipper<double>;
+extern template class ConvexClipper<int32_t>;
+
+} // namespace pc
@@ -0,0 +1,61 @@
+#include "polygon_clip.hpp"
+#include "polygon_clip_priv.hpp"
+#include "polygon_clip_thread_pool.hpp"
+
+#include <thread>
+
+namespace pc {
+
+// jobs are stolen in ranges of this size
+constexpr size_t kJobGrain = 16;
+
+BatchExecutor::BatchExecutor(uint32_t thread_count) {
+  if (thread_count == 0) {
+    thread_count = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  m_pool = std::make_unique<ThreadPool>(thread_count);
+
+  for (uint32_t i = 0; i < m_pool->size(); i++) {
+    m_workspaces.emplace_back(std::make_unique<ClipWorkspace<float>>());
+  }
+}
+
+BatchExecutor::~BatchExecutor() = default;
+
+uint32_t BatchExecutor::thread_count() const { return m_pool->size(); }
+
+std::vector<Polygon> BatchExecutor::run(const std::vector<BoolJob> &jobs) {
+  std::vector<Polygon> result(jobs.size());
+
+  m_pool->parallel_for(
+      jobs.size(), kJobGrain, [&](size_t begin, size_t end, uint32_t worker) {
+        auto &workspace = *m_workspaces[worker];
+
+        for (size_t i = begin; i < end; i++) {
+          const auto &job = jobs[i];
+
+          workspace.degeneracy = job.degeneracy;
+          workspace.stats = job.stats;
+          result[i] = ClipAlgorithm<float>::do_op(job.op, *job.subject,
+                                                  *job.clipping, workspace);
+        }
+      });
+
+  return result;
+}
+
+Polygon BatchExecutor::run(const BoolJob &job) {
+  auto &workspace = *m_workspaces.front();
+
+  workspace.pool = m_pool.get();
+  workspace.degeneracy = job.degeneracy;
+  workspace.stats = job.stats;
+  auto result = ClipAlgorithm<float>::do_op(job.op, *job.subject,
+                                            *job.clipping, workspace);
+  workspace.pool = nullptr;
+
+  return result;
+}
+
+} // namespace pc
@@ -0,0 +1,634 @@
+#include "polygon_clip.hpp"
+#include "polygon_clip_index.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+#if defined(_WIN32)
+#define PC_FILE_NO_MMAP
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace pc {
+
+constexpr char kFileMagic[4] = {'P', 'C', 'P', 'F'};
+constexpr uint16_t kFileVersion = 1;
+// reads back as another value on a machine of the other byte order
+constexpr uint32_t kFileByteOrder = 0x01020304;
+// every polygon record is followed by its edge index
+constexpr uint8_t kFileIndexed = 1;
+
+/**
+ * Start of the file. Sections are placed at offsets from the start of the
+ * file which are multiples of 8, so a mapping can be read in place.
+ */
+struct FileHeader {
+  char magic[4];
+  uint16_t version;
+  // 1 for float, 2 for double, 3 for int32_t coordinates
+  uint8_t scalar;
+  uint8_t flags;
+  uint32_t byte_order;
+  uint32_t reserved;
+  uint64_t polygon_count;
+  uint64_t ring_count;
+  // one FileEntry per polygon
+  uint64_t entries;
+  // for every polygon 0 followed by the end of each of its rings
+  uint64_t ring_offsets;
+  // one rect per polygon and one per ring
+  uint64_t bounds;
+  uint64_t sub_bounds;
+};
+
+static_assert(sizeof(FileHeader) == 64, "FileHeader is read in place");
+
+/**
+ * Where the record of a polygon lies and which part of the tables it owns
+ */
+struct FileEntry {
+  uint64_t coords;
+  // 0 if the file has no edge index
+  uint64_t index;
+  // the ring offsets of polygon i start at first_ring + i, as every polygon
+  // has one offset more than rings
+  uint64_t first_ring;
+  uint32_t ring_count;
+  uint32_t vertex_count;
+};
+
+static_assert(sizeof(FileEntry) == 32, "FileEntry is read in place");
+
+/**
+ * Start of an edge index, followed by level_end, from and to of every leaf
+ * edge and the boxes of all levels, each starting at a multiple of 8
+ */
+struct IndexHeader {
+  uint32_t edge_count;
+  uint32_t level_count;
+};
+
+template <typename T> static uint8_t scalar_code() {
+  if constexpr (std::is_same_v<T, float>) {
+    return 1;
+  } else if constexpr (std::is_same_v<T, double>) {
+    return 2;
+  } else {
+    return 3;
+  }
+}
+
+static uint64_t align_up(uint64_t offset) { return (offset + 7) & ~7ull; }
+
+static FileEntry read_entry(const unsigned char *entries, size_t i) {
+  FileEntry entry;
+  std::memcpy(&entry, entries + i * sizeof(FileEntry), sizeof(entry));
+
+  return entry;
+}
+
+/**
+ * Whether box holds inner, false if either has a NaN
+ */
+template <typename T>
+static bool covers(const BasicRect<T> &box, const BasicRect<T> &inner) {
+  return box.left_top.x <= inner.left_top.x &&
+         box.left_top.y <= inner.left_top.y &&
+         inner.right_bottom.x <= box.right_bottom.x &&
+         inner.right_bottom.y <= box.right_bottom.y;
+}
+
+/**
+ * Whether count items of item_size bytes starting at offset lie inside a
+ * file of size bytes
+ */
+static bool fits(size_t size, uint64_t offset, uint64_t count,
+                 size_t item_size) {
+  return offset % 8 == 0 && offset <= size &&
+         count <= (size - offset) / item_size;
+}
+
+template <typename T> BasicPolygonFile<T>::~BasicPolygonFile() { close(); }
+
+template <typename T> bool BasicPolygonFile<T>::open(const std::string &path) {
+  static_assert(std::is_trivially_copyable_v<Rect> &&
+                    sizeof(Rect) == 4 * sizeof(T),
+                "boxes are read in place");
+
+  close();
+
+#if defined(PC_FILE_NO_MMAP)
+  auto file = std::fopen(path.c_str(), "rb");
+  if (!file) {
+    return false;
+  }
+
+  unsigned char chunk[1 << 16];
+  size_t n;
+  while ((n = std::fread(chunk, 1, sizeof(chunk), file)) > 0) {
+    m_copy.insert(m_copy.end(), chunk, chunk + n);
+  }
+  std::fclose(file);
+
+  m_data = m_copy.data();
+  m_size = m_copy.size();
+#else
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      static_cast<uint64_t>(st.st_size) < sizeof(FileHeader)) {
+    ::close(fd);
+    return false;
+  }
+
+  auto size = static_cast<size_t>(st.st_size);
+  void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+
+  if (data == MAP_FAILED) {
+    return false;
+  }
+
+  m_data = static_cast<const unsigned char *>(data);
+  m_size = size;
+#endif
+
+  FileHeader header;
+  if (m_size < sizeof(header)) {
+    close();
+    return false;
+  }
+  std::memcpy(&header, m_data, sizeof(header));
+
+  if (std::memcmp(header.magic, kFileMagic, sizeof(kFileMagic)) != 0 ||
+      header.version != kFileVersion || header.scalar != scalar_code<T>() ||
+      header.byte_order != kFileByteOrder) {
+    close();
+    return false;
+  }
+
+  uint64_t polygon_count = header.polygon_count;
+  uint64_t ring_count = header.ring_count;
+
+  // the counts are checked against the size first, so the sum cannot wrap
+  if (!fits(m_size, header.entries, polygon_count, sizeof(FileEntry)) ||
+      !fits(m_size, header.sub_bounds, ring_count, sizeof(Rect)) ||
+      !fits(m_size, header.ring_offsets, ring_count + polygon_count,
+            sizeof(uint32_t)) ||
+      !fits(m_size, header.bounds, polygon_count, sizeof(Rect))) {
+    close();
+    return false;
+  }
+
+  m_indexed = (header.flags & kFileIndexed) != 0;
+  m_polygon_count = static_cast<size_t>(polygon_count);
+  m_entries = m_data + header.entries;
+  m_ring_offsets = reinterpret_cast<const uint32_t *>(m_data +
+                                                      header.ring_offsets);
+  m_bounds = reinterpret_cast<const Rect *>(m_data + header.bounds);
+  m_sub_bounds = reinterpret_cast<const Rect *>(m_data + header.sub_bounds);
+
+  // the tables are small next to the coordinates, checking them up front
+  // lets view() trust them
+  uint64_t first_ring = 0;
+  for (size_t i = 0; i < m_polygon_count; i++) {
+    auto entry = read_entry(m_entries, i);
+
+    bool valid = entry.first_ring == first_ring &&
+                 entry.ring_count <= ring_count - first_ring &&
+                 fits(m_size, entry.coords, entry.vertex_count,
+                      2 * sizeof(T)) &&
+                 (!m_indexed || entry.index != 0);
+
+    const auto *offsets = m_ring_offsets + first_ring + i;
+    for (size_t r = 0; valid && r < entry.ring_count; r++) {
+      valid = offsets[r + 1] >= offsets[r] &&
+              offsets[r + 1] - offsets[r] >= 3;
+    }
+    valid = valid && offsets[0] == 0 &&
+            offsets[entry.ring_count] == entry.vertex_count;
+
+    if (!valid) {
+      close();
+      return false;
+    }
+
+    first_ring += entry.ring_count;
+  }
+
+  if (first_ring != ring_count) {
+    close();
+    return false;
+  }
+
+  return true;
+}
+
+template <typename T> void BasicPolygonFile<T>::close() {
+#if !defined(PC_FILE_NO_MMAP)
+  if (m_data) {
+    munmap(const_cast<unsigned char *>(m_data), m_size);
+  }
+#endif
+
+  m_data = nullptr;
+  m_size = 0;
+  m_copy.clear();
+  m_indexed = false;
+  m_polygon_count = 0;
+  m_entries = nullptr;
+  m_ring_offsets = nullptr;
+  m_bounds = nullptr;
+  m_sub_bounds = nullptr;
+}
+
+template <typename T>
+BasicPolygonView<T> BasicPolygonFile<T>::view(size_t i) const {
+  auto entry = read_entry(m_entries, i);
+
+  return View(reinterpret_cast<const T *>(m_data + entry.coords),
+              m_ring_offsets + entry.first_ring + i, entry.ring_count);
+}
+
+template <typename T>
+BasicPolygonView<T> BasicPolygonFile<T>::indexed_view(size_t i) const {
+  auto result = view(i);
+
+  if (m_indexed) {
+    result.index = load_index(i, result);
+  }
+
+  return result;
+}
+
+template <typename T>
+std::optional<BasicRect<T>> BasicPolygonFile<T>::get_bounds(size_t i) const {
+  auto entry = read_entry(m_entries, i);
+
+  if (entry.ring_count == 0) {
+    return std::nullopt;
+  }
+
+  return m_bounds[i];
+}
+
+template <typename T>
+const BasicRect<T> *BasicPolygonFile<T>::get_sub_bounds(size_t i) const {
+  auto entry = read_entry(m_entries, i);
+
+  return m_sub_bounds + entry.first_ring;
+}
+
+template <typename T>
+std::shared_ptr<const EdgeIndex<T>>
+BasicPolygonFile<T>::load_index(size_t i, const View &view) const {
+  auto entry = read_entry(m_entries, i);
+
+  uint64_t at = entry.index;
+  if (!fits(m_size, at, 1, sizeof(IndexHeader))) {
+    return nullptr;
+  }
+
+  IndexHeader header;
+  std::memcpy(&header, m_data + at, sizeof(header));
+  at += sizeof(header);
+
+  if (!fits(m_size, at, header.level_count, sizeof(uint32_t))) {
+    return nullptr;
+  }
+  const auto *level_end = reinterpret_cast<const uint32_t *>(m_data + at);
+  at = align_up(at + header.level_count * sizeof(uint32_t));
+
+  // the levels must have the shape the queries walk, every level holding
+  // one node per kIndexNodeSize nodes below it up to a single root
+  size_t level_count = header.level_count;
+  uint64_t leaf_count = header.edge_count;
+
+  bool valid = level_count > 0 ? level_end[0] == leaf_count : leaf_count == 0;
+  for (size_t l = 1; valid && l < level_count; l++) {
+    uint64_t below = level_end[l - 1] - (l > 1 ? level_end[l - 2] : 0);
+    valid = level_end[l] > level_end[l - 1] &&
+            level_end[l] - level_end[l - 1] ==
+                (below + kIndexNodeSize - 1) / kIndexNodeSize;
+  }
+  if (level_count > 0) {
+    uint64_t top = level_end[level_count - 1] -
+                   (level_count > 1 ? level_end[level_count - 2] : 0);
+    valid = valid && top == 1;
+  }
+
+  if (!valid || !fits(m_size, at, 2 * leaf_count, sizeof(uint32_t))) {
+    return nullptr;
+  }
+  const auto *leaves = reinterpret_cast<const uint32_t *>(m_data + at);
+  at = align_up(at + 2 * leaf_count * sizeof(uint32_t));
+
+  uint64_t box_count = level_count == 0 ? 0 : level_end[level_count - 1];
+  if (leaf_count != entry.vertex_count ||
+      !fits(m_size, at, box_count, sizeof(Rect))) {
+    return nullptr;
+  }
+  const auto *boxes = reinterpret_cast<const Rect *>(m_data + at);
+
+  // a query skips whatever lies below a box missing the query box, so every
+  // edge must be a leaf exactly once and every box must cover its edge or
+  // its children, otherwise intersections would be lost
+  const auto *ring_end = view.ring_offsets + view.ring_count + 1;
+  std::vector<bool> seen(leaf_count, false);
+
+  for (uint64_t k = 0; k < leaf_count; k++) {
+    auto from = leaves[2 * k];
+    auto to = leaves[2 * k + 1];
+    if (from >= leaf_count || seen[from]) {
+      return nullptr;
+    }
+    seen[from] = true;
+
+    auto ring = std::upper_bound(view.ring_offsets, ring_end, from) - 1;
+    auto next = from + 1 == ring[1] ? ring[0] : from + 1;
+    // to is only a vertex of the view once it is known to follow from
+    if (to != next) {
+      return nullptr;
+    }
+
+    auto p1 = view.point(from);
+    auto p2 = view.point(to);
+    if (!covers(boxes[k], Rect(p1, p1)) || !covers(boxes[k], Rect(p2, p2))) {
+      return nullptr;
+    }
+  }
+
+  for (size_t l = 1; l < level_count; l++) {
+    uint32_t below = l > 1 ? level_end[l - 2] : 0;
+
+    for (uint32_t node = level_end[l - 1]; node < level_end[l]; node++) {
+      uint32_t first = below + (node - level_end[l - 1]) * kIndexNodeSize;
+      uint32_t last = std::min(first + kIndexNodeSize, level_end[l - 1]);
+
+      for (uint32_t child = first; child < last; child++) {
+        if (!covers(boxes[node], boxes[child])) {
+          return nullptr;
+        }
+      }
+    }
+  }
+
+  return std::make_shared<const EdgeIndex<T>>(view, leaves, boxes, level_end,
+                                              level_count);
+}
+
+template <typename T> BasicPolygonFileWriter<T>::~BasicPolygonFileWriter() {
+  if (m_file) {
+    close();
+  }
+}
+
+template <typename T>
+bool BasicPolygonFileWriter<T>::open(const std::string &path,
+                                     bool build_index) {
+  if (m_file) {
+    close();
+  }
+
+  m_file = std::fopen(path.c_str(), "wb");
+  if (!m_file) {
+    return false;
+  }
+
+  m_index = build_index;
+  m_failed = false;
+  m_offset = 0;
+  m_records.clear();
+  m_ring_offsets.clear();
+  m_bounds.clear();
+  m_sub_bounds.clear();
+
+  // written again by close, until then the file is not recognized
+  FileHeader header = {};
+
+  return write_bytes(&header, sizeof(header));
+}
+
+template <typename T>
+bool BasicPolygonFileWriter<T>::write(const Polygon &polygon) {
+  // rings of a polygon always have three vertices or more
+  m_stage.clear();
+  m_stage.append(polygon);
+
+  return write_record(m_stage.view());
+}
+
+template <typename T> bool BasicPolygonFileWriter<T>::write(const View &view) {
+  bool flat = view.stride == 2;
+  for (size_t r = 0; flat && r < view.ring_count; r++) {
+    flat = view.ring_size(r) >= 3;
+  }
+
+  if (flat) {
+    return write_record(view);
+  }
+
+  m_stage.clear();
+  for (size_t r = 0; r < view.ring_count; r++) {
+    if (view.ring_size(r) < 3) {
+      continue;
+    }
+
+    for (size_t i = view.ring_offsets[r]; i < view.ring_offsets[r + 1]; i++) {
+      auto p = view.point(i);
+      m_stage.coords.emplace_back(p.x);
+      m_stage.coords.emplace_back(p.y);
+    }
+    m_stage.ring_offsets.emplace_back(
+        static_cast<uint32_t>(m_stage.coords.size() / 2));
+  }
+
+  return write_record(m_stage.view());
+}
+
+template <typename T>
+bool BasicPolygonFileWriter<T>::write(const Buffer &buffer) {
+  return write(buffer.view());
+}
+
+template <typename T>
+bool BasicPolygonFileWriter<T>::write_record(const View &view) {
+  if (!m_file || m_failed) {
+    return false;
+  }
+
+  size_t first = view.ring_count == 0 ? 0 : view.ring_offsets[0];
+  size_t count = view.vertex_count() - first;
+
+  if (view.ring_count > UINT32_MAX || count > UINT32_MAX) {
+    m_failed = true;
+    return false;
+  }
+
+  Record record{m_offset, 0, static_cast<uint32_t>(view.ring_count),
+                static_cast<uint32_t>(count)};
+
+  if (!write_bytes(view.coords + 2 * first, 2 * count * sizeof(T)) ||
+      !align()) {
+    return false;
+  }
+
+  std::optional<Rect> bounds;
+
+  m_ring_offsets.emplace_back(0);
+  for (size_t r = 0; r < view.ring_count; r++) {
+    m_ring_offsets.emplace_back(
+        static_cast<uint32_t>(view.ring_offsets[r + 1] - first));
+
+    auto p = view.point(view.ring_offsets[r]);
+    Rect box(p, p);
+    for (size_t i = view.ring_offsets[r]; i < view.ring_offsets[r + 1]; i++) {
+      p = view.point(i);
+      box.left_top.x = std::min(box.left_top.x, p.x);
+      box.left_top.y = std::min(box.left_top.y, p.y);
+      box.right_bottom.x = std::max(box.right_bottom.x, p.x);
+      box.right_bottom.y = std::max(box.right_bottom.y, p.y);
+    }
+    m_sub_bounds.emplace_back(box);
+
+    if (!bounds) {
+      bounds = box;
+    } else {
+      bounds->left_top.x = std::min(bounds->left_top.x, box.left_top.x);
+      bounds->left_top.y = std::min(bounds->left_top.y, box.left_top.y);
+      bounds->right_bottom.x =
+          std::max(bounds->right_bottom.x, box.right_bottom.x);
+      bounds->right_bottom.y =
+          std::max(bounds->right_bottom.y, box.right_bottom.y);
+    }
+  }
+  m_bounds.emplace_back(bounds.value_or(Rect()));
+
+  if (m_index) {
+    record.index = m_offset;
+
+    EdgeIndex<T> index(view);
+
+    const auto &level_end = index.get_level_end();
+    IndexHeader header{static_cast<uint32_t>(index.edge_count()),
+                       static_cast<uint32_t>(level_end.size())};
+
+    std::vector<uint32_t> leaves;
+    leaves.reserve(2 * index.edge_count());
+    for (const auto &edge : index.get_edges()) {
+      leaves.emplace_back(edge.from);
+      leaves.emplace_back(edge.to);
+    }
+
+    const auto &boxes = index.get_boxes();
+
+    if (!write_bytes(&header, sizeof(header)) ||
+        !write_bytes(level_end.data(), level_end.size() * sizeof(uint32_t)) ||
+        !align() ||
+        !write_bytes(leaves.data(), leaves.size() * sizeof(uint32_t)) ||
+        !align() || !write_bytes(boxes.data(), boxes.size() * sizeof(Rect))) {
+      return false;
+    }
+  }
+
+  m_records.emplace_back(record);
+
+  return true;
+}
+
+template <typename T> bool BasicPolygonFileWriter<T>::close() {
+  if (!m_file) {
+    return false;
+  }
+
+  FileHeader header = {};
+  std::memcpy(header.magic, kFileMagic, sizeof(kFileMagic));
+  header.version = kFileVersion;
+  header.scalar = scalar_code<T>();
+  header.flags = m_index ? kFileIndexed : 0;
+  header.byte_order = kFileByteOrder;
+  header.polygon_count = m_records.size();
+  header.ring_count = m_sub_bounds.size();
+
+  std::vector<FileEntry> entries;
+  entries.reserve(m_records.size());
+
+  uint64_t first_ring = 0;
+  for (const auto &record : m_records) {
+    entries.emplace_back(FileEntry{record.coords, record.index, first_ring,
+                                   record.ring_count, record.vertex_count});
+    first_ring += record.ring_count;
+  }
+
+  bool ok = align();
+
+  header.entries = m_offset;
+  ok = ok && write_bytes(entries.data(), entries.size() * sizeof(FileEntry));
+
+  header.ring_offsets = m_offset;
+  ok = ok &&
+       write_bytes(m_ring_offsets.data(),
+                   m_ring_offsets.size() * sizeof(uint32_t)) &&
+       align();
+
+  header.bounds = m_offset;
+  ok = ok && write_bytes(m_bounds.data(), m_bounds.size() * sizeof(Rect));
+
+  header.sub_bounds = m_offset;
+  ok = ok &&
+       write_bytes(m_sub_bounds.data(), m_sub_bounds.size() * sizeof(Rect));
+
+  // the header goes in last, a file cut short is never taken as complete
+  ok = ok && std::fseek(m_file, 0, SEEK_SET) == 0 &&
+       std::fwrite(&header, sizeof(header), 1, m_file) == 1;
+
+  ok = std::fclose(m_file) == 0 && ok;
+  m_file = nullptr;
+
+  m_records.clear();
+  m_ring_offsets.clear();
+  m_bounds.clear();
+  m_sub_bounds.clear();
+
+  return ok;
+}
+
+template <typename T>
+bool BasicPolygonFileWriter<T>::write_bytes(const void *data, size_t size) {
+  if (m_failed) {
+    return false;
+  }
+
+  if (size > 0 && std::fwrite(data, 1, size, m_file) != size) {
+    m_failed = true;
+    return false;
+  }
+
+  m_offset += size;
+
+  return true;
+}
+
+template <typename T> bool BasicPolygonFileWriter<T>::align() {
+  static const char zeros[8] = {};
+
+  return write_bytes(zeros, align_up(m_offset) - m_offset);
+}
+
+template class BasicPolygonFile<float>;
+template class BasicPolygonFile<double>;
+template class BasicPolygonFile<int32_t>;
+template class BasicPolygonFileWriter<float>;
+template class BasicPolygonFileWriter<double>;
+template class BasicPolygonFileWriter<int32_t>;
+
+} // namespace pc
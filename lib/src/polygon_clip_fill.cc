@@ -0,0 +1,591 @@
+#include "polygon_clip_fill.hpp"
+#include "polygon_clip_math.hpp"
+#include "polygon_clip_scalar.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace pc {
+
+// splitting at rounded crossing points may create new crossings, the pieces
+// are split again at most this many times
+constexpr uint32_t kFillSplitRounds = 4;
+
+template <typename T> struct FillEdge {
+  BasicPoint<T> p1;
+  BasicPoint<T> p2;
+};
+
+/**
+ * Point where an edge is split, t orders the splits along the edge
+ */
+template <typename T> struct EdgeSplit {
+  uint32_t edge;
+  double t;
+  BasicPoint<T> point;
+};
+
+template <typename T>
+static bool point_less(const BasicPoint<T> &a, const BasicPoint<T> &b) {
+  return a.x < b.x || (a.x == b.x && a.y < b.y);
+}
+
+template <typename T>
+static bool point_equal(const BasicPoint<T> &a, const BasicPoint<T> &b) {
+  return a.x == b.x && a.y == b.y;
+}
+
+/**
+ * Whether p, which lies on the line through a and b, is strictly between them
+ */
+template <typename T>
+static bool strictly_between(const BasicPoint<T> &a, const BasicPoint<T> &b,
+                             const BasicPoint<T> &p) {
+  if (a.x != b.x) {
+    return std::min(a.x, b.x) < p.x && p.x < std::max(a.x, b.x);
+  }
+
+  return std::min(a.y, b.y) < p.y && p.y < std::max(a.y, b.y);
+}
+
+/**
+ * Parameter of the projection of p onto a -> b
+ */
+template <typename T>
+static double project(const BasicPoint<T> &a, const BasicPoint<T> &b,
+                      const BasicPoint<T> &p) {
+  double abx = static_cast<double>(b.x) - a.x;
+  double aby = static_cast<double>(b.y) - a.y;
+  double apx = static_cast<double>(p.x) - a.x;
+  double apy = static_cast<double>(p.y) - a.y;
+
+  return (abx * apx + aby * apy) / (abx * abx + aby * aby);
+}
+
+/**
+ * Point at t along a -> b, rounded like FlatPolygon::allocate_vertex
+ */
+template <typename T>
+static BasicPoint<T> point_at(const BasicPoint<T> &a, const BasicPoint<T> &b,
+                              double t) {
+  if constexpr (ScalarTraits<T>::kExact) {
+    auto snap = [t](T u, T v) {
+      return static_cast<T>(
+          std::llround(u + t * (static_cast<double>(v) - u)));
+    };
+
+    return BasicPoint<T>(snap(a.x, b.x), snap(a.y, b.y));
+  } else {
+    auto s = static_cast<T>(t);
+
+    return BasicPoint<T>(a.x * (1 - s) + b.x * s, a.y * (1 - s) + b.y * s);
+  }
+}
+
+/**
+ * Whether a -> b passes through the unit square centred on grid point p
+ * without running through p itself
+ */
+template <typename T>
+static bool passes_pixel(const BasicPoint<T> &a, const BasicPoint<T> &b,
+                         const BasicPoint<T> &p) {
+  if (std::min(a.x, b.x) > p.x || std::max(a.x, b.x) < p.x ||
+      std::min(a.y, b.y) > p.y || std::max(a.y, b.y) < p.y) {
+    return false;
+  }
+
+  int64_t dx = static_cast<int64_t>(b.x) - a.x;
+  int64_t dy = static_cast<int64_t>(b.y) - a.y;
+  int64_t cross = dx * (static_cast<int64_t>(p.y) - a.y) -
+                  dy * (static_cast<int64_t>(p.x) - a.x);
+
+  // the line misses the square by more than half its width along the normal
+  // once |cross| exceeds (|dx| + |dy|) / 2
+  return cross != 0 && std::abs(cross) <= (std::abs(dx) + std::abs(dy)) / 2;
+}
+
+/**
+ * Record where edges i (p1 -> p2) and j (q1 -> q2) split each other
+ *
+ * @return true if they cross or touch
+ */
+template <typename T>
+static bool split_pair(uint32_t i, const BasicPoint<T> &p1,
+                       const BasicPoint<T> &p2, uint32_t j,
+                       const BasicPoint<T> &q1, const BasicPoint<T> &q2,
+                       std::vector<EdgeSplit<T>> &splits) {
+  int side_q1 = Math::orientation(p1, p2, q1, 0);
+  int side_q2 = Math::orientation(p1, p2, q2, 0);
+  int side_p1 = Math::orientation(q1, q2, p1, 0);
+  int side_p2 = Math::orientation(q1, q2, p2, 0);
+
+  if (side_q1 * side_q2 < 0 && side_p1 * side_p2 < 0) {
+    double ex = static_cast<double>(p2.x) - p1.x;
+    double ey = static_cast<double>(p2.y) - p1.y;
+    double dx = static_cast<double>(q2.x) - q1.x;
+    double dy = static_cast<double>(q2.y) - q1.y;
+    double wx = static_cast<double>(q1.x) - p1.x;
+    double wy = static_cast<double>(q1.y) - p1.y;
+
+    // p1 + t1 * e = q1 + t2 * d
+    double c = ex * dy - ey * dx;
+    double t1 = std::clamp((wx * dy - wy * dx) / c, 0.0, 1.0);
+    double t2 = std::clamp((wx * ey - wy * ex) / c, 0.0, 1.0);
+
+    auto point = point_at(p1, p2, t1);
+
+    splits.emplace_back(EdgeSplit<T>{i, t1, point});
+    splits.emplace_back(EdgeSplit<T>{j, t2, point});
+
+    return true;
+  }
+
+  // an end point resting inside the other edge splits it there, this also
+  // covers collinear overlaps
+  bool touch = false;
+
+  if (side_q1 == 0 && strictly_between(p1, p2, q1)) {
+    splits.emplace_back(EdgeSplit<T>{i, project(p1, p2, q1), q1});
+    touch = true;
+  }
+  if (side_q2 == 0 && strictly_between(p1, p2, q2)) {
+    splits.emplace_back(EdgeSplit<T>{i, project(p1, p2, q2), q2});
+    touch = true;
+  }
+  if (side_p1 == 0 && strictly_between(q1, q2, p1)) {
+    splits.emplace_back(EdgeSplit<T>{j, project(q1, q2, p1), p1});
+    touch = true;
+  }
+  if (side_p2 == 0 && strictly_between(q1, q2, p2)) {
+    splits.emplace_back(EdgeSplit<T>{j, project(q1, q2, p2), p2});
+    touch = true;
+  }
+
+  // snapped crossing points may jump over an edge passing close by, so with
+  // integer coordinates an edge is also split at every end point inside the
+  // grid square it runs through
+  if constexpr (ScalarTraits<T>::kExact) {
+    for (const auto *q : {&q1, &q2}) {
+      if (passes_pixel(p1, p2, *q)) {
+        splits.emplace_back(EdgeSplit<T>{i, project(p1, p2, *q), *q});
+        touch = true;
+      }
+    }
+    for (const auto *p : {&p1, &p2}) {
+      if (passes_pixel(q1, q2, *p)) {
+        splits.emplace_back(EdgeSplit<T>{j, project(q1, q2, *p), *p});
+        touch = true;
+      }
+    }
+  }
+
+  return touch;
+}
+
+/**
+ * Split edges at every point where another one crosses or touches them
+ *
+ * @return number of edge pairs crossing or touching, 0 if edges is unchanged
+ */
+template <typename T>
+static uint64_t split_edges(std::vector<FillEdge<T>> &edges) {
+  // sweep upwards, testing each edge against the earlier ones still reaching
+  // its lowest y
+  std::vector<uint32_t> order(edges.size());
+  for (uint32_t i = 0; i < order.size(); i++) {
+    order[i] = i;
+  }
+
+  auto y_min = [&edges](uint32_t i) {
+    return std::min(edges[i].p1.y, edges[i].p2.y);
+  };
+
+  std::sort(order.begin(), order.end(), [&y_min](uint32_t i1, uint32_t i2) {
+    return y_min(i1) < y_min(i2);
+  });
+
+  std::vector<EdgeSplit<T>> splits;
+  std::vector<uint32_t> active;
+  uint64_t found = 0;
+
+  for (auto i : order) {
+    const auto &e = edges[i];
+
+    T y = y_min(i);
+    T x_min = std::min(e.p1.x, e.p2.x);
+    T x_max = std::max(e.p1.x, e.p2.x);
+
+    active.erase(std::remove_if(active.begin(), active.end(),
+                                [&edges, y](uint32_t k) {
+                                  return std::max(edges[k].p1.y,
+                                                  edges[k].p2.y) < y;
+                                }),
+                 active.end());
+
+    for (auto k : active) {
+      const auto &other = edges[k];
+
+      if (std::max(other.p1.x, other.p2.x) < x_min ||
+          std::min(other.p1.x, other.p2.x) > x_max) {
+        continue;
+      }
+
+      if (split_pair(i, e.p1, e.p2, k, other.p1, other.p2, splits)) {
+        found++;
+      }
+    }
+
+    active.emplace_back(i);
+  }
+
+  if (splits.empty()) {
+    return found;
+  }
+
+  std::sort(splits.begin(), splits.end(),
+            [](const EdgeSplit<T> &s1, const EdgeSplit<T> &s2) {
+              return s1.edge < s2.edge ||
+                     (s1.edge == s2.edge && s1.t < s2.t);
+            });
+
+  std::vector<FillEdge<T>> pieces;
+  pieces.reserve(edges.size() + splits.size());
+
+  size_t s = 0;
+  for (uint32_t i = 0; i < edges.size(); i++) {
+    auto prev = edges[i].p1;
+
+    for (; s < splits.size() && splits[s].edge == i; s++) {
+      if (!point_equal(prev, splits[s].point)) {
+        pieces.emplace_back(FillEdge<T>{prev, splits[s].point});
+        prev = splits[s].point;
+      }
+    }
+
+    if (!point_equal(prev, edges[i].p2)) {
+      pieces.emplace_back(FillEdge<T>{prev, edges[i].p2});
+    }
+  }
+
+  edges = std::move(pieces);
+
+  return found;
+}
+
+template <typename T>
+FillResolver<T>::FillResolver(const Polygon &polygon, FillRule rule)
+    : m_rule(rule) {
+  build_fragments(polygon);
+  sweep_windings();
+}
+
+template <typename T>
+void FillResolver<T>::build_fragments(const Polygon &polygon) {
+  std::vector<FillEdge<T>> pieces;
+  for (auto head : polygon.get_vertices()) {
+    auto v = head;
+    do {
+      if (!point_equal(v->point, v->next->point)) {
+        pieces.emplace_back(FillEdge<T>{v->point, v->next->point});
+      }
+
+      v = v->next;
+    } while (v != head);
+  }
+
+  for (uint32_t round = 0; round < kFillSplitRounds; round++) {
+    auto found = split_edges(pieces);
+    if (found == 0) {
+      break;
+    }
+
+    m_split_count += found;
+  }
+
+  m_nodes.reserve(2 * pieces.size());
+  for (const auto &piece : pieces) {
+    m_nodes.emplace_back(piece.p1);
+    m_nodes.emplace_back(piece.p2);
+  }
+
+  std::sort(m_nodes.begin(), m_nodes.end(), point_less<T>);
+  m_nodes.erase(std::unique(m_nodes.begin(), m_nodes.end(), point_equal<T>),
+                m_nodes.end());
+
+  auto node_of = [this](const Point &p) {
+    return static_cast<uint32_t>(
+        std::lower_bound(m_nodes.begin(), m_nodes.end(), p, point_less<T>) -
+        m_nodes.begin());
+  };
+
+  std::vector<Fragment> raw;
+  raw.reserve(pieces.size());
+
+  for (const auto &piece : pieces) {
+    auto from = node_of(piece.p1);
+    auto to = node_of(piece.p2);
+
+    raw.emplace_back(from < to ? Fragment{from, to, 1, 0}
+                               : Fragment{to, from, -1, 0});
+  }
+
+  std::sort(raw.begin(), raw.end(), [](const Fragment &f1, const Fragment &f2) {
+    return f1.from < f2.from || (f1.from == f2.from && f1.to < f2.to);
+  });
+
+  // coincident pieces become one fragment, those cancelling out vanish
+  for (size_t i = 0; i < raw.size();) {
+    auto fragment = raw[i];
+
+    for (i++; i < raw.size() && raw[i].from == fragment.from &&
+              raw[i].to == fragment.to;
+         i++) {
+      fragment.count += raw[i].count;
+    }
+
+    if (fragment.count != 0) {
+      m_fragments.emplace_back(fragment);
+    }
+  }
+}
+
+template <typename T>
+const BasicPoint<T> &FillResolver<T>::lower(const Fragment &f) const {
+  return m_nodes[f.from].y < m_nodes[f.to].y ? m_nodes[f.from] : m_nodes[f.to];
+}
+
+template <typename T>
+const BasicPoint<T> &FillResolver<T>::upper(const Fragment &f) const {
+  return m_nodes[f.from].y < m_nodes[f.to].y ? m_nodes[f.to] : m_nodes[f.from];
+}
+
+template <typename T>
+bool FillResolver<T>::left_of(const Fragment &a, const Fragment &b) const {
+  const auto &a_low = lower(a);
+  const auto &a_up = upper(a);
+  const auto &b_low = lower(b);
+  const auto &b_up = upper(b);
+
+  // fragments never cross, so the side of the end of the later one decides,
+  // or of its other end if both start at the same node
+  if (b_low.y <= a_low.y) {
+    int side = Math::orientation(b_low, b_up, a_low, 0);
+    if (side == 0) {
+      side = Math::orientation(b_low, b_up, a_up, 0);
+    }
+
+    return side > 0;
+  }
+
+  int side = Math::orientation(a_low, a_up, b_low, 0);
+  if (side == 0) {
+    side = Math::orientation(a_low, a_up, b_up, 0);
+  }
+
+  return side < 0;
+}
+
+template <typename T> void FillResolver<T>::sweep_windings() {
+  // fragments crossing a horizontal line, sorted by their lower end, and
+  // horizontal ones sorted by their height
+  std::vector<uint32_t> rising;
+  std::vector<uint32_t> level;
+
+  for (uint32_t k = 0; k < m_fragments.size(); k++) {
+    const auto &f = m_fragments[k];
+    (m_nodes[f.from].y == m_nodes[f.to].y ? level : rising).emplace_back(k);
+  }
+
+  std::sort(rising.begin(), rising.end(), [this](uint32_t k1, uint32_t k2) {
+    return lower(m_fragments[k1]).y < lower(m_fragments[k2]).y;
+  });
+  std::sort(level.begin(), level.end(), [this](uint32_t k1, uint32_t k2) {
+    return m_nodes[m_fragments[k1].from].y < m_nodes[m_fragments[k2].from].y;
+  });
+
+  // contribution of a fragment to the winding number left of it
+  auto direction = [this](const Fragment &f) {
+    return m_nodes[f.to].y > m_nodes[f.from].y ? f.count : -f.count;
+  };
+
+  // fragments crossing the strip above the current height, left to right
+  std::vector<uint32_t> active;
+  // suffix[i] sums the directions of active[i] and all right of it
+  std::vector<int32_t> suffix;
+
+  size_t r = 0;
+  size_t l = 0;
+
+  while (r < rising.size() || l < level.size()) {
+    T y = std::numeric_limits<T>::max();
+    if (r < rising.size()) {
+      y = lower(m_fragments[rising[r]]).y;
+    }
+    if (l < level.size()) {
+      y = std::min(y, m_nodes[m_fragments[level[l]].from].y);
+    }
+
+    active.erase(std::remove_if(active.begin(), active.end(),
+                                [this, y](uint32_t k) {
+                                  return upper(m_fragments[k]).y <= y;
+                                }),
+                 active.end());
+
+    for (; r < rising.size() && lower(m_fragments[rising[r]]).y == y; r++) {
+      const auto &f = m_fragments[rising[r]];
+
+      auto pos = std::partition_point(
+          active.begin(), active.end(),
+          [this, &f](uint32_t k) { return left_of(m_fragments[k], f); });
+
+      active.insert(pos, rising[r]);
+    }
+
+    suffix.assign(active.size() + 1, 0);
+    for (size_t i = active.size(); i > 0; i--) {
+      suffix[i - 1] = suffix[i] + direction(m_fragments[active[i - 1]]);
+    }
+
+    // a ray just right of a new fragment crosses everything right of it, that
+    // is the winding number on its right side if it runs upwards
+    for (size_t i = 0; i < active.size(); i++) {
+      auto &f = m_fragments[active[i]];
+
+      if (lower(f).y == y) {
+        bool up = m_nodes[f.to].y > m_nodes[f.from].y;
+        f.winding = up ? suffix[i + 1] : suffix[i + 1] - f.count;
+      }
+    }
+
+    // a ray just above a horizontal fragment crosses the fragments of the
+    // strip right of its ends, which are never inside it
+    for (; l < level.size() && m_nodes[m_fragments[level[l]].from].y == y;
+         l++) {
+      auto &f = m_fragments[level[l]];
+      const auto &left_end = m_nodes[f.from];
+
+      auto pos = std::partition_point(
+          active.begin(), active.end(), [this, &left_end, y](uint32_t k) {
+            const auto &g = m_fragments[k];
+            if (lower(g).y == y) {
+              return lower(g).x <= left_end.x;
+            }
+
+            return Math::orientation(lower(g), upper(g), left_end, 0) < 0;
+          });
+
+      // from is the left end, so the strip above is on the left of f
+      f.winding = suffix[pos - active.begin()] - f.count;
+    }
+  }
+}
+
+template <typename T> bool FillResolver<T>::filled(int32_t winding) const {
+  return m_rule == FillRule::kNonZero ? winding != 0 : (winding & 1) != 0;
+}
+
+template <typename T> BasicPolygon<T> FillResolver<T>::resolve() const {
+  struct Half {
+    uint32_t from;
+    uint32_t to;
+  };
+
+  // the boundary of the filled area, with the area on the left
+  std::vector<Half> halves;
+  for (const auto &f : m_fragments) {
+    bool right = filled(f.winding);
+    bool left = filled(f.winding + f.count);
+
+    if (left != right) {
+      halves.emplace_back(left ? Half{f.from, f.to} : Half{f.to, f.from});
+    }
+  }
+
+  std::sort(halves.begin(), halves.end(), [](const Half &h1, const Half &h2) {
+    return h1.from < h2.from;
+  });
+
+  // halves leaving node v are [first[v], first[v + 1])
+  std::vector<uint32_t> first(m_nodes.size() + 1, 0);
+  for (const auto &h : halves) {
+    first[h.from + 1]++;
+  }
+  for (size_t v = 0; v < m_nodes.size(); v++) {
+    first[v + 1] += first[v];
+  }
+
+  auto sign = [](double d) { return (d > 0) - (d < 0); };
+
+  // where d lies turning clockwise from r around v: 0 within half a turn,
+  // 1 opposite, 2 beyond half a turn, 3 along r
+  auto sector = [&sign](const Point &v, const Point &r, const Point &d) {
+    int side = Math::orientation(v, r, d, 0);
+    if (side != 0) {
+      return side < 0 ? 0 : 2;
+    }
+
+    bool along = sign(static_cast<double>(d.x) - v.x) ==
+                     sign(static_cast<double>(r.x) - v.x) &&
+                 sign(static_cast<double>(d.y) - v.y) ==
+                     sign(static_cast<double>(r.y) - v.y);
+
+    return along ? 3 : 1;
+  };
+
+  // leaving a node, take the first boundary edge clockwise from the one just
+  // walked, so rings touching at the node are not merged into one
+  auto next_half = [&](uint32_t current) {
+    const auto &v = m_nodes[halves[current].to];
+    const auto &back = m_nodes[halves[current].from];
+
+    uint32_t best = std::numeric_limits<uint32_t>::max();
+    int best_sector = 4;
+
+    for (auto k = first[halves[current].to];
+         k < first[halves[current].to + 1]; k++) {
+      const auto &d = m_nodes[halves[k].to];
+      int s = sector(v, back, d);
+
+      if (s < best_sector ||
+          (s == best_sector && (s == 0 || s == 2) &&
+           Math::orientation(v, m_nodes[halves[best].to], d, 0) > 0)) {
+        best = k;
+        best_sector = s;
+      }
+    }
+
+    return best;
+  };
+
+  Polygon result;
+
+  std::vector<bool> used(halves.size(), false);
+  std::vector<Point> pts;
+
+  for (uint32_t start = 0; start < halves.size(); start++) {
+    if (used[start]) {
+      continue;
+    }
+
+    pts.clear();
+
+    auto current = start;
+    do {
+      used[current] = true;
+      pts.emplace_back(m_nodes[halves[current].from]);
+
+      current = next_half(current);
+    } while (current < halves.size() && !used[current]);
+
+    result.append_vertices(pts);
+  }
+
+  return result;
+}
+
+template class FillResolver<float>;
+template class FillResolver<double>;
+template class FillResolver<int32_t>;
+
+} // namespace pc
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "polygon_clip.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace pc {
+
+/**
+ * Rebuild a polygon whose rings may cross themselves or each other into rings
+ * which at most touch at vertices and bound the same area under a fill rule.
+ *
+ * Every edge is split where another edge crosses or touches it, leaving
+ * fragments that only meet at their ends. Coincident fragments are merged
+ * into one carrying the net number of edges running along it. A sweep over
+ * the horizontal strips between fragment ends then counts the winding number
+ * beside every fragment. Fragments with the filled area on exactly one side
+ * are kept, turned so that area lies on their left and linked into rings, so
+ * outer rings come out counter-clockwise and holes clockwise when y points up.
+ *
+ * All side tests are exact. Crossing points of float coordinates are rounded
+ * like the intersection points of a Boolean operation, and those of integer
+ * coordinates are snapped to the grid.
+ */
+template <typename T> class FillResolver {
+public:
+  using Point = BasicPoint<T>;
+  using Polygon = BasicPolygon<T>;
+
+  FillResolver(const Polygon &polygon, FillRule rule);
+  ~FillResolver() = default;
+
+  FillResolver(const FillResolver &) = delete;
+  FillResolver &operator=(const FillResolver &) = delete;
+
+  Polygon resolve() const;
+
+  /**
+   * Pairs of edges found crossing or touching each other
+   */
+  uint64_t split_count() const { return m_split_count; }
+
+private:
+  struct Fragment {
+    // nodes at both ends, from < to
+    uint32_t from;
+    uint32_t to;
+    // input edges running from -> to minus those running to -> from
+    int32_t count;
+    // winding number right of from -> to
+    int32_t winding;
+  };
+
+  /**
+   * Split every edge of polygon at the points where other edges cross or
+   * touch it and merge the pieces into m_nodes and m_fragments
+   */
+  void build_fragments(const Polygon &polygon);
+
+  /**
+   * Fill in Fragment::winding
+   */
+  void sweep_windings();
+
+  const Point &lower(const Fragment &f) const;
+
+  const Point &upper(const Fragment &f) const;
+
+  /**
+   * Whether fragment a runs left of fragment b just above the start of the
+   * later one, both must be active there
+   */
+  bool left_of(const Fragment &a, const Fragment &b) const;
+
+  bool filled(int32_t winding) const;
+
+private:
+  FillRule m_rule;
+  // distinct fragment ends, sorted by x then y
+  std::vector<Point> m_nodes = {};
+  std::vector<Fragment> m_fragments = {};
+  uint64_t m_split_count = 0;
+};
+
+extern template class FillResolver<float>;
+extern template class FillResolver<double>;
+extern template class FillResolver<int32_t>;
+
+} // namespace pc
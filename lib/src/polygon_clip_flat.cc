@@ -0,0 +1,319 @@
+#include "polygon_clip_flat.hpp"
+#include "polygon_clip_index.hpp"
+#include "polygon_clip_math.hpp"
+#include "polygon_clip_priv.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace pc {
+
+template <typename T> FlatPolygon<T>::FlatPolygon(const Polygon &polygon) {
+  assign(polygon);
+}
+
+template <typename T> void FlatPolygon<T>::assign(const Polygon &polygon) {
+  clear();
+
+  const auto &sub_polygons = polygon.get_vertices();
+
+  size_t count = 0;
+  for (auto v : sub_polygons) {
+    auto p = v;
+    do {
+      count++;
+      p = p->next;
+    } while (p != v);
+  }
+
+  reserve(count);
+
+  for (auto v : sub_polygons) {
+    append_ring(v);
+  }
+}
+
+template <typename T>
+void FlatPolygon<T>::assign(const BasicPolygonView<T> &view) {
+  clear();
+
+  reserve(view.vertex_count());
+
+  for (size_t r = 0; r < view.ring_count; r++) {
+    // skipped as by BasicPolygon::append_vertices
+    if (view.ring_size(r) >= 3) {
+      append_ring(view, r);
+    }
+  }
+}
+
+template <typename T> void FlatPolygon<T>::clear() {
+  x.clear();
+  y.clear();
+  prev.clear();
+  next.clear();
+  neighbour.clear();
+  flags.clear();
+  ring_offsets.assign(1, 0);
+  ring_bounds.clear();
+  bounds.reset();
+  perturbations = 0;
+}
+
+template <typename T> void FlatPolygon<T>::reserve(size_t count) {
+  x.reserve(count);
+  y.reserve(count);
+  prev.reserve(count);
+  next.reserve(count);
+  neighbour.reserve(count);
+  flags.reserve(count);
+}
+
+template <typename T> size_t FlatPolygon<T>::memory_size() const {
+  return (x.capacity() + y.capacity()) * sizeof(T) +
+         (prev.capacity() + next.capacity() + neighbour.capacity() +
+          ring_offsets.capacity()) *
+             sizeof(uint32_t) +
+         flags.capacity() * sizeof(uint8_t) +
+         ring_bounds.capacity() * sizeof(Rect);
+}
+
+template <typename T> void FlatPolygon<T>::append_ring(const Vertex *head) {
+  // intersection vertices must stay behind all input vertices
+  assert(vertex_count() == input_count());
+
+  uint32_t begin = vertex_count();
+
+  auto p = head;
+  do {
+    push_vertex(p->point.x, p->point.y);
+    p = p->next;
+  } while (p != head);
+
+  close_ring(begin);
+}
+
+template <typename T>
+void FlatPolygon<T>::append_ring(const BasicPolygonView<T> &view,
+                                 size_t ring) {
+  assert(vertex_count() == input_count());
+
+  uint32_t begin = vertex_count();
+
+  for (size_t i = view.ring_offsets[ring]; i < view.ring_offsets[ring + 1];
+       i++) {
+    push_vertex(view.coords[i * view.stride],
+                view.coords[i * view.stride + 1]);
+  }
+
+  close_ring(begin);
+}
+
+template <typename T> void FlatPolygon<T>::close_ring(uint32_t begin) {
+  uint32_t end = vertex_count();
+
+  Rect ring{point(begin), point(begin)};
+
+  for (uint32_t i = begin; i < end; i++) {
+    ring.left_top.x = std::min(ring.left_top.x, x[i]);
+    ring.left_top.y = std::min(ring.left_top.y, y[i]);
+    ring.right_bottom.x = std::max(ring.right_bottom.x, x[i]);
+    ring.right_bottom.y = std::max(ring.right_bottom.y, y[i]);
+
+    prev[i] = i == begin ? end - 1 : i - 1;
+    next[i] = i + 1 == end ? begin : i + 1;
+  }
+
+  ring_offsets.emplace_back(end);
+  ring_bounds.emplace_back(ring);
+
+  if (!bounds) {
+    bounds = ring;
+  } else {
+    bounds->left_top.x = std::min(bounds->left_top.x, ring.left_top.x);
+    bounds->left_top.y = std::min(bounds->left_top.y, ring.left_top.y);
+    bounds->right_bottom.x =
+        std::max(bounds->right_bottom.x, ring.right_bottom.x);
+    bounds->right_bottom.y =
+        std::max(bounds->right_bottom.y, ring.right_bottom.y);
+  }
+}
+
+template <typename T>
+uint32_t FlatPolygon<T>::allocate_vertex(uint32_t p1, uint32_t p2,
+                                         EdgeParam<T> t) {
+  if constexpr (ScalarTraits<T>::kExact) {
+    // snap to the grid, t = 0 and t = 1 give back the endpoints
+    auto snap = [t](T a, T b) {
+      return static_cast<T>(
+          std::llround(a + t * (static_cast<double>(b) - a)));
+    };
+
+    return push_vertex(snap(x[p1], x[p2]), snap(y[p1], y[p2]));
+  } else {
+    // point between p1 and p2
+    auto p = point(p1) * (1 - t) + point(p2) * t;
+    return push_vertex(p.x, p.y);
+  }
+}
+
+template <typename T>
+uint32_t FlatPolygon<T>::allocate_vertex(const Point &p) {
+  return push_vertex(p.x, p.y);
+}
+
+template <typename T>
+void FlatPolygon<T>::insert_intersections(
+    uint32_t current, std::vector<VertexDist<T>> &intersect_list) {
+  std::sort(intersect_list.begin(), intersect_list.end(), VertDistCompiler{});
+
+  for (size_t i = 1; i < intersect_list.size(); i++) {
+    auto prev_vert = intersect_list[i - 1].vert;
+    auto next_vert = intersect_list[i].vert;
+
+    next[prev_vert] = next_vert;
+    prev[next_vert] = prev_vert;
+  }
+
+  auto head = intersect_list.front().vert;
+  auto tail = intersect_list.back().vert;
+  auto current_next = next[current];
+
+  next[tail] = current_next;
+  prev[current_next] = tail;
+
+  next[current] = head;
+  prev[head] = current;
+}
+
+template <typename T>
+bool FlatPolygon<T>::ray_crosses(uint32_t curr, uint32_t next,
+                                 const Point &p) const {
+  if ((y[next] > p.y) == (y[curr] > p.y)) {
+    return false;
+  }
+
+  if constexpr (ScalarTraits<T>::kExact) {
+    // p.x is left of the crossing exactly when p is left of an upward edge or
+    // right of a downward one
+    int side = Math::orientation(point(curr), point(next), p, 0);
+    return y[next] > y[curr] ? side > 0 : side < 0;
+  } else {
+    return p.x <
+           (x[curr] - x[next]) * (p.y - y[next]) / (y[curr] - y[next]) +
+               x[next];
+  }
+}
+
+template <typename T>
+bool FlatPolygon<T>::ray_crosses(uint32_t curr, uint32_t next, const Point &p,
+                                 int shift) const {
+  // the offset moves p by shift * e^2 in y, so a vertex at the height of p is
+  // above it exactly when p moves down
+  auto above = [&](T vy) { return shift > 0 ? vy > p.y : vy >= p.y; };
+
+  if (above(y[curr]) == above(y[next])) {
+    return false;
+  }
+
+  int side = Math::orientation(point(curr), point(next), p, shift);
+
+  // left of an upward edge or right of a downward one
+  return (side > 0) == (y[next] > y[curr]);
+}
+
+template <typename T> bool FlatPolygon<T>::contains(const Point &p) const {
+  bool contains = false;
+
+  for (size_t r = 0; r < ring_count(); r++) {
+    uint32_t begin = ring_offsets[r];
+    uint32_t end = ring_offsets[r + 1];
+
+    for (uint32_t curr = begin; curr < end; curr++) {
+      uint32_t next = curr + 1 == end ? begin : curr + 1;
+
+      if (ray_crosses(curr, next, p)) {
+        contains = !contains;
+      }
+    }
+  }
+
+  return contains;
+}
+
+template <typename T>
+bool FlatPolygon<T>::contains(const Point &p, int shift) const {
+  bool contains = false;
+
+  for (size_t r = 0; r < ring_count(); r++) {
+    uint32_t begin = ring_offsets[r];
+    uint32_t end = ring_offsets[r + 1];
+
+    for (uint32_t curr = begin; curr < end; curr++) {
+      uint32_t next = curr + 1 == end ? begin : curr + 1;
+
+      if (ray_crosses(curr, next, p, shift)) {
+        contains = !contains;
+      }
+    }
+  }
+
+  return contains;
+}
+
+/**
+ * Box around the ray from p towards +x, an edge crossing the ray or
+ * touching its start overlaps it
+ */
+template <typename T> static BasicRect<T> ray_box(const BasicPoint<T> &p) {
+  return BasicRect<T>(p, BasicPoint<T>(std::numeric_limits<T>::max(), p.y));
+}
+
+template <typename T>
+bool FlatPolygon<T>::contains(const Point &p,
+                              const EdgeIndex<T> &index) const {
+  bool contains = false;
+
+  index.query(ray_box(p), [&](const typename EdgeIndex<T>::Edge &edge) {
+    if (ray_crosses(edge.from, edge.to, p)) {
+      contains = !contains;
+    }
+  });
+
+  return contains;
+}
+
+template <typename T>
+bool FlatPolygon<T>::contains(const Point &p, int shift,
+                              const EdgeIndex<T> &index) const {
+  bool contains = false;
+
+  index.query(ray_box(p), [&](const typename EdgeIndex<T>::Edge &edge) {
+    if (ray_crosses(edge.from, edge.to, p, shift)) {
+      contains = !contains;
+    }
+  });
+
+  return contains;
+}
+
+template <typename T> uint32_t FlatPolygon<T>::push_vertex(T vx, T vy) {
+  uint32_t index = vertex_count();
+
+  x.emplace_back(vx);
+  y.emplace_back(vy);
+  prev.emplace_back(kInvalidIndex);
+  next.emplace_back(kInvalidIndex);
+  neighbour.emplace_back(kInvalidIndex);
+  flags.emplace_back(0);
+
+  return index;
+}
+
+template struct FlatPolygon<float>;
+template struct FlatPolygon<double>;
+template struct FlatPolygon<int32_t>;
+
+} // namespace pc
@@ -0,0 +1,200 @@
+#pragma once
+
+#include "polygon_clip.hpp"
+#include "polygon_clip_scalar.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace pc {
+
+constexpr uint32_t kInvalidIndex = UINT32_MAX;
+
+template <typename T> class EdgeIndex;
+
+enum VertexFlags : uint8_t {
+  kVertexIntersect = 1 << 0,
+  kVertexEntryExit = 1 << 1,
+  kVertexMarked = 1 << 2,
+};
+
+template <typename T> struct VertexDist {
+  using Param = EdgeParam<T>;
+
+  uint32_t vert;
+  Param t;
+  // compared when t is equal, see SegmentCrossing
+  Param order[2] = {};
+
+  VertexDist(uint32_t vert, Param t) : vert(vert), t(t) {}
+  VertexDist(uint32_t vert, Param t, const Param (&order)[2])
+      : vert(vert), t(t), order{order[0], order[1]} {}
+};
+
+struct VertDistCompiler {
+  template <typename T>
+  bool operator()(const VertexDist<T> &v1, const VertexDist<T> &v2) {
+    if (v1.t != v2.t) {
+      return v1.t < v2.t;
+    }
+
+    if (v1.order[0] != v2.order[0]) {
+      return v1.order[0] < v2.order[0];
+    }
+
+    return v1.order[1] < v2.order[1];
+  }
+};
+
+/**
+ * Structure-of-arrays layout of a polygon used during clipping.
+ *
+ * Coordinates, links and state of vertex i live in parallel arrays indexed by
+ * a 32-bit vertex index. The input vertices of ring r are stored in
+ * [ring_offsets[r], ring_offsets[r + 1]), so edge i always runs from vertex i
+ * to the following input vertex of its ring. Intersection vertices are
+ * appended after all input vertices and spliced into the rings through
+ * prev and next.
+ */
+template <typename T> struct FlatPolygon {
+  using Point = BasicPoint<T>;
+  using Rect = BasicRect<T>;
+  using Vertex = BasicVertex<T>;
+  using Polygon = BasicPolygon<T>;
+
+  std::vector<T> x = {};
+  std::vector<T> y = {};
+  // index linked list in each ring
+  std::vector<uint32_t> prev = {};
+  std::vector<uint32_t> next = {};
+  // index of the neighbour in the other polygon
+  std::vector<uint32_t> neighbour = {};
+  // packed VertexFlags
+  std::vector<uint8_t> flags = {};
+  // ring r owns input vertices [ring_offsets[r], ring_offsets[r + 1])
+  std::vector<uint32_t> ring_offsets = {0};
+  std::vector<Rect> ring_bounds = {};
+  std::optional<Rect> bounds = {};
+  // vertices moved by Math::segment_intersect
+  uint32_t perturbations = 0;
+
+  FlatPolygon() = default;
+  explicit FlatPolygon(const Polygon &polygon);
+
+  /**
+   * Replace the content with polygon, allocated memory is kept
+   */
+  void assign(const Polygon &polygon);
+
+  /**
+   * Same, reading the coordinates straight from view
+   */
+  void assign(const BasicPolygonView<T> &view);
+
+  /**
+   * Remove all vertices and rings, allocated memory is kept
+   */
+  void clear();
+
+  void reserve(size_t count);
+
+  /**
+   * Bytes reserved by all arrays
+   */
+  size_t memory_size() const;
+
+  /**
+   * Append a closed ring, starting from head and following next
+   */
+  void append_ring(const Vertex *head);
+
+  /**
+   * Append ring of view
+   */
+  void append_ring(const BasicPolygonView<T> &view, size_t ring);
+
+  /**
+   * Allocate an unlinked vertex between p1 and p2, integer coordinates are
+   * rounded to the nearest grid point
+   */
+  uint32_t allocate_vertex(uint32_t p1, uint32_t p2, EdgeParam<T> t);
+
+  /**
+   * Allocate an unlinked vertex at p
+   */
+  uint32_t allocate_vertex(const Point &p);
+
+  /**
+   * Link the intersection vertices in intersect_list between current and the
+   * next vertex of current, ordered by their distance to current.
+   */
+  void insert_intersections(uint32_t current,
+                            std::vector<VertexDist<T>> &intersect_list);
+
+  /**
+   * Even-odd point in polygon test over the input edges
+   */
+  bool contains(const Point &p) const;
+
+  /**
+   * Same test for p moved by shift times the symbolic offset of
+   * Math::orientation, shift is 1 or -1. Never undecided for points on the
+   * boundary.
+   */
+  bool contains(const Point &p, int shift) const;
+
+  /**
+   * Same tests as above, only over the edges of index which may cross the
+   * ray from p. index must be built from the polygon this was assigned from,
+   * with no vertex perturbed since.
+   */
+  bool contains(const Point &p, const EdgeIndex<T> &index) const;
+
+  bool contains(const Point &p, int shift, const EdgeIndex<T> &index) const;
+
+  /**
+   * Whether edge curr -> next crosses the horizontal ray from p towards +x
+   */
+  bool ray_crosses(uint32_t curr, uint32_t next, const Point &p) const;
+
+  /**
+   * Same for p moved by shift times the symbolic offset
+   */
+  bool ray_crosses(uint32_t curr, uint32_t next, const Point &p,
+                   int shift) const;
+
+  uint32_t input_count() const { return ring_offsets.back(); }
+
+  uint32_t vertex_count() const { return static_cast<uint32_t>(x.size()); }
+
+  size_t ring_count() const { return ring_offsets.size() - 1; }
+
+  Point point(uint32_t i) const { return Point(x[i], y[i]); }
+
+  bool has_flag(uint32_t i, VertexFlags flag) const {
+    return (flags[i] & flag) != 0;
+  }
+
+  void set_flag(uint32_t i, VertexFlags flag, bool value) {
+    if (value) {
+      flags[i] |= flag;
+    } else {
+      flags[i] &= ~flag;
+    }
+  }
+
+private:
+  uint32_t push_vertex(T vx, T vy);
+
+  /**
+   * Link the vertices pushed since begin into a ring and record its bounds
+   */
+  void close_ring(uint32_t begin);
+};
+
+extern template struct FlatPolygon<float>;
+extern template struct FlatPolygon<double>;
+extern template struct FlatPolygon<int32_t>;
+
+} // namespace pc
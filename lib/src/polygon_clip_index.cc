@@ -0,0 +1,226 @@
+#include "polygon_clip_index.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+namespace pc {
+
+// resolution of the Hilbert curve in each axis
+constexpr uint32_t kHilbertBits = 16;
+
+/**
+ * Position of cell (x, y) along a Hilbert curve filling a square of
+ * 2^kHilbertBits cells per side
+ */
+static uint32_t hilbert_index(uint32_t x, uint32_t y) {
+  constexpr uint32_t kSide = 1u << kHilbertBits;
+
+  uint32_t d = 0;
+
+  for (uint32_t s = 1u << (kHilbertBits - 1); s > 0; s >>= 1) {
+    uint32_t rx = (x & s) ? 1 : 0;
+    uint32_t ry = (y & s) ? 1 : 0;
+
+    d += s * s * ((3 * rx) ^ ry);
+
+    // rotate the quadrant so the curve stays continuous
+    if (ry == 0) {
+      if (rx == 1) {
+        x = kSide - 1 - x;
+        y = kSide - 1 - y;
+      }
+
+      std::swap(x, y);
+    }
+  }
+
+  return d;
+}
+
+template <typename T>
+std::vector<uint32_t> hilbert_order(const std::vector<BasicRect<T>> &boxes,
+                                    const BasicRect<T> &bounds) {
+  // map box centers onto the Hilbert grid spanned by bounds
+  double min_x = bounds.left_top.x;
+  double min_y = bounds.left_top.y;
+  double width = static_cast<double>(bounds.right_bottom.x) - min_x;
+  double height = static_cast<double>(bounds.right_bottom.y) - min_y;
+
+  constexpr double kCells = (1u << kHilbertBits) - 1;
+  double scale_x = width > 0 ? kCells / width : 0;
+  double scale_y = height > 0 ? kCells / height : 0;
+
+  std::vector<uint32_t> keys(boxes.size());
+  for (size_t i = 0; i < boxes.size(); i++) {
+    const auto &box = boxes[i];
+
+    double cx =
+        (static_cast<double>(box.left_top.x) + box.right_bottom.x) / 2 - min_x;
+    double cy =
+        (static_cast<double>(box.left_top.y) + box.right_bottom.y) / 2 - min_y;
+
+    keys[i] = hilbert_index(static_cast<uint32_t>(cx * scale_x),
+                            static_cast<uint32_t>(cy * scale_y));
+  }
+
+  std::vector<uint32_t> order(boxes.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&keys](uint32_t i1, uint32_t i2) {
+    return keys[i1] < keys[i2] || (keys[i1] == keys[i2] && i1 < i2);
+  });
+
+  return order;
+}
+
+template <typename T>
+static BasicRect<T> edge_box(const BasicPoint<T> &p1,
+                             const BasicPoint<T> &p2) {
+  return BasicRect<T>(
+      BasicPoint<T>(std::min(p1.x, p2.x), std::min(p1.y, p2.y)),
+      BasicPoint<T>(std::max(p1.x, p2.x), std::max(p1.y, p2.y)));
+}
+
+template <typename T>
+EdgeIndex<T>::EdgeIndex(const BasicPolygon<T> &polygon) {
+  auto bounds = polygon.get_bounds();
+  if (!bounds) {
+    return;
+  }
+
+  std::vector<Edge> edges;
+
+  uint32_t offset = 0;
+  for (auto head : polygon.get_vertices()) {
+    uint32_t begin = offset;
+
+    auto v = head;
+    do {
+      uint32_t to = v->next == head ? begin : offset + 1;
+      edges.emplace_back(Edge{offset, to, v->point, v->next->point});
+
+      offset++;
+      v = v->next;
+    } while (v != head);
+  }
+
+  build(edges, *bounds);
+}
+
+template <typename T>
+EdgeIndex<T>::EdgeIndex(const BasicPolygonView<T> &view) {
+  auto bounds = view.get_bounds();
+  if (!bounds) {
+    return;
+  }
+
+  std::vector<Edge> edges;
+  edges.reserve(view.vertex_count());
+
+  uint32_t offset = 0;
+  for (size_t r = 0; r < view.ring_count; r++) {
+    size_t n = view.ring_size(r);
+    if (n < 3) {
+      continue;
+    }
+
+    size_t first = view.ring_offsets[r];
+    for (size_t k = 0; k < n; k++) {
+      size_t next = k + 1 == n ? 0 : k + 1;
+      edges.emplace_back(Edge{offset + static_cast<uint32_t>(k),
+                              offset + static_cast<uint32_t>(next),
+                              view.point(first + k),
+                              view.point(first + next)});
+    }
+
+    offset += static_cast<uint32_t>(n);
+  }
+
+  build(edges, *bounds);
+}
+
+template <typename T>
+EdgeIndex<T>::EdgeIndex(const BasicPolygonView<T> &view,
+                        const uint32_t *leaves, const Rect *boxes,
+                        const uint32_t *level_end, size_t level_count) {
+  if (level_count == 0) {
+    return;
+  }
+
+  m_level_end.assign(level_end, level_end + level_count);
+  m_boxes.assign(boxes, boxes + m_level_end.back());
+
+  m_edges.reserve(m_level_end.front());
+  for (size_t i = 0; i < m_level_end.front(); i++) {
+    auto from = leaves[2 * i];
+    auto to = leaves[2 * i + 1];
+
+    m_edges.emplace_back(Edge{from, to, view.point(from), view.point(to)});
+  }
+}
+
+template <typename T>
+void EdgeIndex<T>::build(const std::vector<Edge> &edges, const Rect &bounds) {
+  std::vector<Rect> boxes;
+  boxes.reserve(edges.size());
+  for (const auto &e : edges) {
+    boxes.emplace_back(edge_box(e.p1, e.p2));
+  }
+
+  auto order = hilbert_order(boxes, bounds);
+
+  // every level holds about 1 / kIndexNodeSize of the boxes below it
+  size_t box_count = edges.size();
+  for (size_t n = edges.size(); n > 1;) {
+    n = (n + kIndexNodeSize - 1) / kIndexNodeSize;
+    box_count += n;
+  }
+
+  m_edges.reserve(edges.size());
+  m_boxes.reserve(box_count);
+
+  for (auto i : order) {
+    m_edges.emplace_back(edges[i]);
+    m_boxes.emplace_back(boxes[i]);
+  }
+
+  m_level_end.emplace_back(static_cast<uint32_t>(m_boxes.size()));
+
+  uint32_t begin = 0;
+  while (m_level_end.back() - begin > 1) {
+    uint32_t end = m_level_end.back();
+
+    for (uint32_t first = begin; first < end; first += kIndexNodeSize) {
+      uint32_t last = std::min(first + kIndexNodeSize, end);
+
+      Rect node = m_boxes[first];
+      for (uint32_t child = first + 1; child < last; child++) {
+        const auto &box = m_boxes[child];
+
+        node.left_top.x = std::min(node.left_top.x, box.left_top.x);
+        node.left_top.y = std::min(node.left_top.y, box.left_top.y);
+        node.right_bottom.x =
+            std::max(node.right_bottom.x, box.right_bottom.x);
+        node.right_bottom.y =
+            std::max(node.right_bottom.y, box.right_bottom.y);
+      }
+
+      m_boxes.emplace_back(node);
+    }
+
+    begin = end;
+    m_level_end.emplace_back(static_cast<uint32_t>(m_boxes.size()));
+  }
+}
+
+template std::vector<uint32_t> hilbert_order(const std::vector<Rect> &boxes,
+                                             const Rect &bounds);
+template std::vector<uint32_t> hilbert_order(const std::vector<RectD> &boxes,
+                                             const RectD &bounds);
+template std::vector<uint32_t> hilbert_order(const std::vector<RectI> &boxes,
+                                             const RectI &bounds);
+
+template class EdgeIndex<float>;
+template class EdgeIndex<double>;
+template class EdgeIndex<int32_t>;
+
+} // namespace pc
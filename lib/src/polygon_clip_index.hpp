@@ -0,0 +1,147 @@
+#pragma once
+
+#include "polygon_clip.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace pc {
+
+// children of every inner node of EdgeIndex
+constexpr uint32_t kIndexNodeSize = 16;
+
+/**
+ * Order of boxes along a Hilbert curve through their centers, so boxes close
+ * to each other mostly end up close in the order. bounds must cover every
+ * box.
+ */
+template <typename T>
+std::vector<uint32_t> hilbert_order(const std::vector<BasicRect<T>> &boxes,
+                                    const BasicRect<T> &bounds);
+
+/**
+ * Packed static R-tree over the edges of a polygon.
+ *
+ * Edges are ordered along a Hilbert curve through the centers of their
+ * bounding boxes, then every kIndexNodeSize consecutive boxes of a level are
+ * merged into one node of the level above until a single root is left. All
+ * levels live in one array, leaves first and the root last.
+ *
+ * Edge i of ring r runs from its vertex to the following one, from and to are
+ * the positions of these vertices when the rings are laid out one after
+ * another, the same numbering FlatPolygon uses for its input vertices.
+ */
+template <typename T> class EdgeIndex {
+public:
+  using Point = BasicPoint<T>;
+  using Rect = BasicRect<T>;
+
+  struct Edge {
+    uint32_t from;
+    uint32_t to;
+    Point p1;
+    Point p2;
+  };
+
+  explicit EdgeIndex(const BasicPolygon<T> &polygon);
+
+  /**
+   * Index over the rings of view, rings skipped by the view are left out of
+   * the numbering as well
+   */
+  explicit EdgeIndex(const BasicPolygonView<T> &view);
+
+  /**
+   * Index restored from the arrays of get_edges, get_boxes and get_level_end
+   * of an index built over view earlier. leaves holds from and to of every
+   * edge and the end points are read as view.point(from), so view must start
+   * at vertex 0 and skip no ring. level_end holds level_count entries and
+   * boxes level_end[level_count - 1].
+   */
+  EdgeIndex(const BasicPolygonView<T> &view, const uint32_t *leaves,
+            const Rect *boxes, const uint32_t *level_end, size_t level_count);
+
+  ~EdgeIndex() = default;
+
+  EdgeIndex(const EdgeIndex &) = delete;
+  EdgeIndex &operator=(const EdgeIndex &) = delete;
+
+  size_t edge_count() const { return m_edges.size(); }
+
+  const std::vector<Edge> &get_edges() const { return m_edges; }
+
+  const std::vector<Rect> &get_boxes() const { return m_boxes; }
+
+  const std::vector<uint32_t> &get_level_end() const { return m_level_end; }
+
+  /**
+   * Call visit(edge) on every edge whose bounding box overlaps box
+   */
+  template <typename F> void query(const Rect &box, F &&visit) const {
+    if (m_boxes.empty()) {
+      return;
+    }
+
+    struct Entry {
+      uint32_t node;
+      uint32_t level;
+    };
+
+    // every level leaves at most kIndexNodeSize - 1 siblings on the stack,
+    // 32-bit edge counts need at most 9 levels
+    Entry stack[10 * kIndexNodeSize];
+    size_t size = 0;
+
+    stack[size++] = Entry{static_cast<uint32_t>(m_boxes.size() - 1),
+                          static_cast<uint32_t>(m_level_end.size() - 1)};
+
+    while (size > 0) {
+      auto entry = stack[--size];
+
+      if (!m_boxes[entry.node].overlaps(box)) {
+        continue;
+      }
+
+      if (entry.level == 0) {
+        visit(m_edges[entry.node]);
+        continue;
+      }
+
+      uint32_t first = level_begin(entry.level - 1) +
+                       (entry.node - level_begin(entry.level)) *
+                           kIndexNodeSize;
+      uint32_t last =
+          std::min(first + kIndexNodeSize, m_level_end[entry.level - 1]);
+
+      // pushed in reverse so children are visited in Hilbert order
+      for (uint32_t child = last; child > first; child--) {
+        stack[size++] = Entry{child - 1, entry.level - 1};
+      }
+    }
+  }
+
+private:
+  /**
+   * Order edges along the Hilbert curve through bounds and build the levels
+   * above them
+   */
+  void build(const std::vector<Edge> &edges, const Rect &bounds);
+
+  uint32_t level_begin(uint32_t level) const {
+    return level == 0 ? 0 : m_level_end[level - 1];
+  }
+
+private:
+  // leaves in Hilbert order, m_boxes[i] is the box of m_edges[i]
+  std::vector<Edge> m_edges = {};
+  std::vector<Rect> m_boxes = {};
+  // level l occupies m_boxes[m_level_end[l - 1], m_level_end[l])
+  std::vector<uint32_t> m_level_end = {};
+};
+
+extern template class EdgeIndex<float>;
+extern template class EdgeIndex<double>;
+extern template class EdgeIndex<int32_t>;
+
+} // namespace pc
@@ -1,28 +1,55 @@
 #include "polygon_clip_math.hpp"
 #include "polygon_clip.hpp"
+#include "polygon_clip_flat.hpp"
 #include "polygon_clip_priv.hpp"
+#include "polygon_clip_stats.hpp"
+
+#include <algorithm>
+#include <cmath>
 
 namespace pc {
 
-constexpr Scalar kPerturbation = static_cast<Scalar>(1.001);
+/**
+ * Move vertex v of polygon towards other by the perturbation factor
+ */
+template <typename T>
+static BasicPoint<T> perturb(FlatPolygon<T> &polygon, uint32_t v,
+                             const BasicPoint<T> &other) {
+  constexpr T kPerturbation = ScalarTraits<T>::kPerturbation;
+
+  auto p = polygon.point(v) * kPerturbation + other * (1 - kPerturbation);
+
+  polygon.x[v] = p.x;
+  polygon.y[v] = p.y;
+
+  polygon.perturbations++;
+
+  return p;
+}
 
-bool Math::segment_intersect(Vertex *p1, Vertex *p2, Vertex *q1, Vertex *q2,
-                             float &t1, float &t2) {
+template <typename T>
+bool Math::segment_intersect(FlatPolygon<T> &p, uint32_t p1, uint32_t p2,
+                             FlatPolygon<T> &q, uint32_t q1, uint32_t q2,
+                             T &t1, T &t2) {
+  auto p1_point = p.point(p1);
+  auto p2_point = p.point(p2);
+  auto q1_point = q.point(q1);
+  auto q2_point = q.point(q2);
 
-  auto p1_q1 = p1->point - q1->point;
-  auto p2_q1 = p2->point - q1->point;
-  auto q2_q1 = q2->point - q1->point;
+  auto p1_q1 = p1_point - q1_point;
+  auto p2_q1 = p2_point - q1_point;
+  auto q2_q1 = q2_point - q1_point;
 
-  Point q2_q1_normal{-q2_q1.y, q2_q1.x};
+  BasicPoint<T> q2_q1_normal{-q2_q1.y, q2_q1.x};
 
   auto WEC_P1 = p1_q1.x * q2_q1_normal.x + p1_q1.y * q2_q1_normal.y;
   auto WEC_P2 = p2_q1.x * q2_q1_normal.x + p2_q1.y * q2_q1_normal.y;
 
   if (scalar_is_zero(WEC_P1)) {
     // need perturbation
-    p1->point = p1->point * kPerturbation + p2->point * (1 - kPerturbation);
+    p1_point = perturb(p, p1, p2_point);
 
-    p1_q1 = p1->point - q1->point;
+    p1_q1 = p1_point - q1_point;
 
     WEC_P1 = p1_q1.x * q2_q1_normal.x + p1_q1.y * q2_q1_normal.y;
     WEC_P2 = p2_q1.x * q2_q1_normal.x + p2_q1.y * q2_q1_normal.y;
@@ -30,31 +57,31 @@ bool Math::segment_intersect(Vertex *p1, Vertex *p2, Vertex *q1, Vertex *q2,
 
   if (scalar_is_zero(WEC_P2)) {
     // need perturbation
-    p2->point = p2->point * kPerturbation + p1->point * (1 - kPerturbation);
+    p2_point = perturb(p, p2, p1_point);
 
-    p2_q1 = p2->point - q1->point;
+    p2_q1 = p2_point - q1_point;
 
     WEC_P1 = p1_q1.x * q2_q1_normal.x + p1_q1.y * q2_q1_normal.y;
     WEC_P2 = p2_q1.x * q2_q1_normal.x + p2_q1.y * q2_q1_normal.y;
   }
 
-  if (WEC_P1 * WEC_P2 >= 0.f) {
+  if (WEC_P1 * WEC_P2 >= 0) {
     return false;
   }
 
-  auto q1_p1 = q1->point - p1->point;
-  auto q2_p1 = q2->point - p1->point;
-  auto p2_p1 = p2->point - p1->point;
-  Point p2_p1_normal{-p2_p1.y, p2_p1.x};
+  auto q1_p1 = q1_point - p1_point;
+  auto q2_p1 = q2_point - p1_point;
+  auto p2_p1 = p2_point - p1_point;
+  BasicPoint<T> p2_p1_normal{-p2_p1.y, p2_p1.x};
 
   auto WEC_Q1 = q1_p1.x * p2_p1_normal.x + q1_p1.y * p2_p1_normal.y;
   auto WEC_Q2 = q2_p1.x * p2_p1_normal.x + q2_p1.y * p2_p1_normal.y;
 
   if (scalar_is_zero(WEC_Q1)) {
     // need perturbation
-    q1->point = q1->point * kPerturbation + q2->point * (1 - kPerturbation);
+    q1_point = perturb(q, q1, q2_point);
 
-    q1_p1 = q1->point - p1->point;
+    q1_p1 = q1_point - p1_point;
 
     WEC_Q1 = q1_p1.x * p2_p1_normal.x + q1_p1.y * p2_p1_normal.y;
     WEC_Q2 = q2_p1.x * p2_p1_normal.x + q2_p1.y * p2_p1_normal.y;
@@ -62,15 +89,15 @@ bool Math::segment_intersect(Vertex *p1, Vertex *p2, Vertex *q1, Vertex *q2,
 
   if (scalar_is_zero(WEC_Q2)) {
     // need perturbation
-    q2->point = q2->point * kPerturbation + q1->point * (1 - kPerturbation);
+    q2_point = perturb(q, q2, q1_point);
 
-    q2_p1 = q2->point - p1->point;
+    q2_p1 = q2_point - p1_point;
 
     WEC_Q1 = q1_p1.x * p2_p1_normal.x + q1_p1.y * p2_p1_normal.y;
     WEC_Q2 = q2_p1.x * p2_p1_normal.x + q2_p1.y * p2_p1_normal.y;
   }
 
-  if (WEC_Q1 * WEC_Q2 >= 0.f) {
+  if (WEC_Q1 * WEC_Q2 >= 0) {
     return false;
   }
 
@@ -80,4 +107,291 @@ bool Math::segment_intersect(Vertex *p1, Vertex *p2, Vertex *q1, Vertex *q2,
   return true;
 }
 
-} // namespace pc
\ No newline at end of file
+/**
+ * Exact sign of the cross product (b - a) x (p - a) for float coordinates
+ */
+static int cross_sign(const Point &a, const Point &b, const Point &p) {
+  // differences of float coordinates are exact in double unless their
+  // magnitudes are more than 2^28 apart
+  double abx = static_cast<double>(b.x) - a.x;
+  double aby = static_cast<double>(b.y) - a.y;
+  double apx = static_cast<double>(p.x) - a.x;
+  double apy = static_cast<double>(p.y) - a.y;
+
+  // rounding is monotonic, so different rounded products already decide the
+  // sign of the cross product, equal ones are decided by the exact remainders
+  double l = abx * apy;
+  double r = aby * apx;
+
+  if (l != r) {
+    return l > r ? 1 : -1;
+  }
+
+  double l_rest = std::fma(abx, apy, -l);
+  double r_rest = std::fma(aby, apx, -r);
+
+  if (l_rest != r_rest) {
+    return l_rest > r_rest ? 1 : -1;
+  }
+
+  return 0;
+}
+
+/**
+ * a + b = s + e exactly
+ */
+static void two_sum(double a, double b, double &s, double &e) {
+  s = a + b;
+  double bv = s - a;
+  double av = s - bv;
+  e = (a - av) + (b - bv);
+}
+
+/**
+ * Add b to the nonoverlapping expansion e[0, n), smallest component first
+ */
+static void grow_expansion(double *e, size_t &n, double b) {
+  for (size_t i = 0; i < n; i++) {
+    double s;
+    two_sum(b, e[i], s, e[i]);
+    b = s;
+  }
+
+  e[n++] = b;
+}
+
+/**
+ * Exact sign of the cross product (b - a) x (p - a) for double coordinates.
+ * The rounded product decides unless it is within the error bound of
+ * Shewchuk's orient2d, then the product is expanded exactly.
+ */
+static int cross_sign(const PointD &a, const PointD &b, const PointD &p) {
+  double abx = b.x - a.x;
+  double aby = b.y - a.y;
+  double apx = p.x - a.x;
+  double apy = p.y - a.y;
+
+  double l = abx * apy;
+  double r = aby * apx;
+  double det = l - r;
+
+  constexpr double kEpsilon = 1.0 / (1ll << 53);
+  constexpr double kErrorBound = (3.0 + 16.0 * kEpsilon) * kEpsilon;
+
+  double bound = kErrorBound * (std::abs(l) + std::abs(r));
+  if (det > bound) {
+    return 1;
+  }
+  if (-det > bound) {
+    return -1;
+  }
+
+  // every difference is split into a rounded value and its exact error, the
+  // cross product becomes a sum of 16 exact products
+  double d[4][2];
+  two_sum(b.x, -a.x, d[0][0], d[0][1]);
+  two_sum(p.y, -a.y, d[1][0], d[1][1]);
+  two_sum(b.y, -a.y, d[2][0], d[2][1]);
+  two_sum(p.x, -a.x, d[3][0], d[3][1]);
+
+  double e[16];
+  size_t n = 0;
+
+  for (int i = 0; i < 2; i++) {
+    for (int j = 0; j < 2; j++) {
+      double lp = d[0][i] * d[1][j];
+      double rp = d[2][i] * d[3][j];
+
+      grow_expansion(e, n, std::fma(d[0][i], d[1][j], -lp));
+      grow_expansion(e, n, lp);
+      grow_expansion(e, n, -std::fma(d[2][i], d[3][j], -rp));
+      grow_expansion(e, n, -rp);
+    }
+  }
+
+  // the largest nonzero component carries the sign
+  while (n > 0) {
+    n--;
+    if (e[n] != 0.0) {
+      return e[n] > 0.0 ? 1 : -1;
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * Exact sign of the cross product (b - a) x (p - a) for integer coordinates
+ * within ScalarTraits<int32_t>::kMaxCoordinate
+ */
+static int cross_sign(const BasicPoint<int32_t> &a,
+                      const BasicPoint<int32_t> &b,
+                      const BasicPoint<int32_t> &p) {
+  int64_t abx = static_cast<int64_t>(b.x) - a.x;
+  int64_t aby = static_cast<int64_t>(b.y) - a.y;
+  int64_t apx = static_cast<int64_t>(p.x) - a.x;
+  int64_t apy = static_cast<int64_t>(p.y) - a.y;
+
+  // both products stay below 2^62, comparing them cannot overflow
+  int64_t l = abx * apy;
+  int64_t r = aby * apx;
+
+  return (l > r) - (l < r);
+}
+
+template <typename T>
+int Math::orientation(const BasicPoint<T> &a, const BasicPoint<T> &b,
+                      const BasicPoint<T> &p, int shift) {
+  int sign = cross_sign(a, b, p);
+
+  if (sign != 0) {
+    return sign;
+  }
+
+  // p is on the line, the offset adds shift * (abx * e^2 - aby * e), only the
+  // signs of the differences matter and rounding keeps them
+  double abx = static_cast<double>(b.x) - a.x;
+  double aby = static_cast<double>(b.y) - a.y;
+
+  if (aby != 0.0) {
+    return aby > 0.0 ? -shift : shift;
+  }
+
+  if (abx != 0.0) {
+    return abx > 0.0 ? shift : -shift;
+  }
+
+  return 0;
+}
+
+/**
+ * Parameter of the projection of v onto a -> b, clamped to the edge
+ */
+template <typename T>
+static EdgeParam<T> project(const BasicPoint<T> &a, const BasicPoint<T> &b,
+                            const BasicPoint<T> &v) {
+  double abx = static_cast<double>(b.x) - a.x;
+  double aby = static_cast<double>(b.y) - a.y;
+  double avx = static_cast<double>(v.x) - a.x;
+  double avy = static_cast<double>(v.y) - a.y;
+
+  double t = (abx * avx + aby * avy) / (abx * abx + aby * aby);
+
+  return static_cast<EdgeParam<T>>(std::clamp(t, 0.0, 1.0));
+}
+
+template <typename T>
+bool Math::segment_cross(const FlatPolygon<T> &p, uint32_t p1, uint32_t p2,
+                         const FlatPolygon<T> &q, uint32_t q1, uint32_t q2,
+                         SegmentCrossing<T> &crossing) {
+  using Param = EdgeParam<T>;
+
+  auto p1_point = p.point(p1);
+  auto p2_point = p.point(p2);
+  auto q1_point = q.point(q1);
+  auto q2_point = q.point(q2);
+
+  // relative to q the subject is moved by minus the offset
+  int side_p1 = orientation(q1_point, q2_point, p1_point, -1);
+  int side_p2 = orientation(q1_point, q2_point, p2_point, -1);
+
+  if (side_p1 == 0 || side_p1 == side_p2) {
+    return false;
+  }
+
+  int side_q1 = orientation(p1_point, p2_point, q1_point, 1);
+  int side_q2 = orientation(p1_point, p2_point, q2_point, 1);
+
+  if (side_q1 == 0 || side_q1 == side_q2) {
+    return false;
+  }
+
+  // vertices exactly on the other line, found without the offset
+  bool on_p1 = orientation(q1_point, q2_point, p1_point, 0) == 0;
+  bool on_p2 = orientation(q1_point, q2_point, p2_point, 0) == 0;
+  bool on_q1 = orientation(p1_point, p2_point, q1_point, 0) == 0;
+  bool on_q2 = orientation(p1_point, p2_point, q2_point, 0) == 0;
+
+  double ex = static_cast<double>(p2_point.x) - p1_point.x;
+  double ey = static_cast<double>(p2_point.y) - p1_point.y;
+  double dx = static_cast<double>(q2_point.x) - q1_point.x;
+  double dy = static_cast<double>(q2_point.y) - q1_point.y;
+
+  // a vertex on the other edge gets the same t for both of its edges
+  if (on_p1) {
+    crossing.t1 = 0;
+  } else if (on_p2) {
+    crossing.t1 = 1;
+  } else if (on_q1) {
+    crossing.t1 = project(p1_point, p2_point, q1_point);
+  } else if (on_q2) {
+    crossing.t1 = project(p1_point, p2_point, q2_point);
+  } else {
+    double wec_p1 = dx * (static_cast<double>(p1_point.y) - q1_point.y) -
+                    dy * (static_cast<double>(p1_point.x) - q1_point.x);
+    double wec_p2 = dx * (static_cast<double>(p2_point.y) - q1_point.y) -
+                    dy * (static_cast<double>(p2_point.x) - q1_point.x);
+
+    crossing.t1 =
+        static_cast<Param>(std::clamp(wec_p1 / (wec_p1 - wec_p2), 0.0, 1.0));
+  }
+
+  if (on_q1) {
+    crossing.t2 = 0;
+  } else if (on_q2) {
+    crossing.t2 = 1;
+  } else if (on_p1) {
+    crossing.t2 = project(q1_point, q2_point, p1_point);
+  } else if (on_p2) {
+    crossing.t2 = project(q1_point, q2_point, p2_point);
+  } else {
+    double wec_q1 = ex * (static_cast<double>(q1_point.y) - p1_point.y) -
+                    ey * (static_cast<double>(q1_point.x) - p1_point.x);
+    double wec_q2 = ex * (static_cast<double>(q2_point.y) - p1_point.y) -
+                    ey * (static_cast<double>(q2_point.x) - p1_point.x);
+
+    crossing.t2 =
+        static_cast<Param>(std::clamp(wec_q1 / (wec_q1 - wec_q2), 0.0, 1.0));
+  }
+
+  // solving p1 + t1 * e = q1 + (e, e^2) + t2 * d for the terms of the offset
+  double c = ex * dy - ey * dx;
+
+  crossing.t1_order[0] = static_cast<Param>(dy / c);
+  crossing.t1_order[1] = static_cast<Param>(-dx / c);
+  crossing.t2_order[0] = static_cast<Param>(ey / c);
+  crossing.t2_order[1] = static_cast<Param>(-ex / c);
+
+  return true;
+}
+
+template bool Math::segment_intersect(FlatPolygon<float> &p, uint32_t p1,
+                                      uint32_t p2, FlatPolygon<float> &q,
+                                      uint32_t q1, uint32_t q2, float &t1,
+                                      float &t2);
+template bool Math::segment_intersect(FlatPolygon<double> &p, uint32_t p1,
+                                      uint32_t p2, FlatPolygon<double> &q,
+                                      uint32_t q1, uint32_t q2, double &t1,
+                                      double &t2);
+
+template int Math::orientation(const Point &a, const Point &b, const Point &p,
+                               int shift);
+template int Math::orientation(const PointD &a, const PointD &b,
+                               const PointD &p, int shift);
+template int Math::orientation(const PointI &a, const PointI &b,
+                               const PointI &p, int shift);
+
+template bool Math::segment_cross(const FlatPolygon<float> &p, uint32_t p1,
+                                  uint32_t p2, const FlatPolygon<float> &q,
+                                  uint32_t q1, uint32_t q2,
+                                  SegmentCrossing<float> &crossing);
+template bool Math::segment_cross(const FlatPolygon<double> &p, uint32_t p1,
+                                  uint32_t p2, const FlatPolygon<double> &q,
+                                  uint32_t q1, uint32_t q2,
+                                  SegmentCrossing<double> &crossing);
+template bool Math::segment_cross(const FlatPolygon<int32_t> &p, uint32_t p1,
+                                  uint32_t p2, const FlatPolygon<int32_t> &q,
+                                  uint32_t q1, uint32_t q2,
+                                  SegmentCrossing<int32_t> &crossing);
+
+} // namespace pc
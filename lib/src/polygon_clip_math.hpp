@@ -1,13 +1,106 @@
 #pragma once
 
 #include "polygon_clip.hpp"
+#include "polygon_clip_scalar.hpp"
+
+#include <cstdint>
 
 namespace pc {
 
+template <typename T> struct FlatPolygon;
+
+// edge pairs tested by one call of Math::segment_test_lanes
+constexpr uint32_t kSegmentLanes = 8;
+
+/**
+ * Coordinates of up to kSegmentLanes edge pairs, lane i holds the subject
+ * edge p1 -> p2 and the clipping edge q1 -> q2
+ */
+template <typename T> struct SegmentLanes {
+  alignas(32) T p1x[kSegmentLanes] = {};
+  alignas(32) T p1y[kSegmentLanes] = {};
+  alignas(32) T p2x[kSegmentLanes] = {};
+  alignas(32) T p2y[kSegmentLanes] = {};
+  alignas(32) T q1x[kSegmentLanes] = {};
+  alignas(32) T q1y[kSegmentLanes] = {};
+  alignas(32) T q2x[kSegmentLanes] = {};
+  alignas(32) T q2y[kSegmentLanes] = {};
+};
+
+/**
+ * Result of Math::segment_test_lanes, bit i of a mask belongs to lane i.
+ * t1 and t2 are only meaningful for lanes in hit_mask.
+ */
+template <typename T> struct SegmentLaneResult {
+  uint32_t hit_mask = 0;
+  uint32_t degenerate_mask = 0;
+  alignas(32) EdgeParam<T> t1[kSegmentLanes] = {};
+  alignas(32) EdgeParam<T> t2[kSegmentLanes] = {};
+};
+
+/**
+ * Crossing found by Math::segment_cross.
+ *
+ * Crossings through the same vertex share the same t, the order arrays hold
+ * the first and second order terms of t in the symbolic offset and sort such
+ * crossings along the edge.
+ */
+template <typename T> struct SegmentCrossing {
+  EdgeParam<T> t1 = 0;
+  EdgeParam<T> t2 = 0;
+  EdgeParam<T> t1_order[2] = {};
+  EdgeParam<T> t2_order[2] = {};
+};
+
 class Math {
 public:
-  static bool segment_intersect(Vertex *p1, Vertex *p2, Vertex *q1, Vertex *q2,
-                                float &t1, float &t2);
+  /**
+   * Test edge p1 -> p2 of polygon p against edge q1 -> q2 of polygon q.
+   *
+   * Endpoints lying on the other edge are perturbed in place along their own
+   * edge.
+   */
+  template <typename T>
+  static bool segment_intersect(FlatPolygon<T> &p, uint32_t p1, uint32_t p2,
+                                FlatPolygon<T> &q, uint32_t q1, uint32_t q2,
+                                T &t1, T &t2);
+
+  /**
+   * Test the first count lanes like segment_intersect, but without modifying
+   * anything: lanes which would need perturbation are only reported in
+   * degenerate_mask.
+   * Float lanes use AVX2 or SSE when the cpu supports it, the choice is made
+   * on the first call. Every variant rounds exactly like segment_intersect.
+   */
+  static void segment_test_lanes(const SegmentLanes<float> &lanes,
+                                 uint32_t count,
+                                 SegmentLaneResult<float> &result);
+
+  static void segment_test_lanes(const SegmentLanes<double> &lanes,
+                                 uint32_t count,
+                                 SegmentLaneResult<double> &result);
+
+  /**
+   * Exact side of p relative to the directed line a -> b, with p moved by
+   * shift times the symbolic offset (e, e^2) for an infinitely small e.
+   *
+   * @return 1 if p is on the left, -1 if on the right. 0 only if a == b, or
+   *         if shift is 0 and p is on the line.
+   */
+  template <typename T>
+  static int orientation(const BasicPoint<T> &a, const BasicPoint<T> &b,
+                         const BasicPoint<T> &p, int shift);
+
+  /**
+   * Whether edge p1 -> p2 of p crosses edge q1 -> q2 of q once q is moved by
+   * the symbolic offset of orientation.
+   * Vertices on the other edge are decided exactly and nothing is modified,
+   * collinear overlapping edges never cross.
+   */
+  template <typename T>
+  static bool segment_cross(const FlatPolygon<T> &p, uint32_t p1, uint32_t p2,
+                            const FlatPolygon<T> &q, uint32_t q1, uint32_t q2,
+                            SegmentCrossing<T> &crossing);
 };
 
 } // namespace pc
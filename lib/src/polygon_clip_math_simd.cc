@@ -0,0 +1,311 @@
+#include "polygon_clip_math.hpp"
+#include "polygon_clip_priv.hpp"
+
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) ||            \
+    defined(_M_IX86)
+#define PC_SIMD_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(PC_SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+#define PC_TARGET_AVX2 __attribute__((target("avx2")))
+#define PC_TARGET_SSE2 __attribute__((target("sse2")))
+#else
+#define PC_TARGET_AVX2
+#define PC_TARGET_SSE2
+#endif
+
+namespace pc {
+
+// same bound as scalar_is_zero
+constexpr float kLaneNearZero = ScalarTraits<float>::kNearZero;
+
+using LaneKernel = void (*)(const SegmentLanes<float> &,
+                            SegmentLaneResult<float> &);
+
+/**
+ * Write the masks of one lane, the conditions follow segment_intersect
+ */
+template <typename T>
+static void finish_lane(uint32_t lane, T wec_p1, T wec_p2, T wec_q1, T wec_q2,
+                        SegmentLaneResult<T> &result) {
+  constexpr T kNearZero = ScalarTraits<T>::kNearZero;
+
+  bool degenerate_p =
+      std::abs(wec_p1) <= kNearZero || std::abs(wec_p2) <= kNearZero;
+  bool cross_p = !(wec_p1 * wec_p2 >= 0);
+
+  if (degenerate_p) {
+    result.degenerate_mask |= 1u << lane;
+    return;
+  }
+
+  if (!cross_p) {
+    return;
+  }
+
+  if (std::abs(wec_q1) <= kNearZero || std::abs(wec_q2) <= kNearZero) {
+    result.degenerate_mask |= 1u << lane;
+    return;
+  }
+
+  if (!(wec_q1 * wec_q2 >= 0)) {
+    result.hit_mask |= 1u << lane;
+  }
+}
+
+template <typename T>
+static void segment_lanes_plain(const SegmentLanes<T> &l,
+                                SegmentLaneResult<T> &result) {
+  result.hit_mask = 0;
+  result.degenerate_mask = 0;
+
+  for (uint32_t i = 0; i < kSegmentLanes; i++) {
+    T q21x = l.q2x[i] - l.q1x[i];
+    T q21y = l.q2y[i] - l.q1y[i];
+    T p21x = l.p2x[i] - l.p1x[i];
+    T p21y = l.p2y[i] - l.p1y[i];
+
+    T wec_p1 = (l.p1x[i] - l.q1x[i]) * -q21y + (l.p1y[i] - l.q1y[i]) * q21x;
+    T wec_p2 = (l.p2x[i] - l.q1x[i]) * -q21y + (l.p2y[i] - l.q1y[i]) * q21x;
+    T wec_q1 = (l.q1x[i] - l.p1x[i]) * -p21y + (l.q1y[i] - l.p1y[i]) * p21x;
+    T wec_q2 = (l.q2x[i] - l.p1x[i]) * -p21y + (l.q2y[i] - l.p1y[i]) * p21x;
+
+    result.t1[i] = wec_p1 / (wec_p1 - wec_p2);
+    result.t2[i] = wec_q1 / (wec_q1 - wec_q2);
+
+    finish_lane(i, wec_p1, wec_p2, wec_q1, wec_q2, result);
+  }
+}
+
+#ifdef PC_SIMD_X86
+
+/**
+ * Masks from the window edge coordinates of 4 lanes, the vector form of
+ * finish_lane
+ */
+PC_TARGET_SSE2 static void sse_masks(__m128 wec_p1, __m128 wec_p2,
+                                     __m128 wec_q1, __m128 wec_q2,
+                                     uint32_t &hit, uint32_t &degenerate) {
+  const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+  const __m128 near_zero = _mm_set1_ps(kLaneNearZero);
+  const __m128 zero = _mm_setzero_ps();
+
+  __m128 degenerate_p =
+      _mm_or_ps(_mm_cmple_ps(_mm_and_ps(wec_p1, abs_mask), near_zero),
+                _mm_cmple_ps(_mm_and_ps(wec_p2, abs_mask), near_zero));
+  __m128 degenerate_q =
+      _mm_or_ps(_mm_cmple_ps(_mm_and_ps(wec_q1, abs_mask), near_zero),
+                _mm_cmple_ps(_mm_and_ps(wec_q2, abs_mask), near_zero));
+  __m128 cross_p = _mm_cmpnge_ps(_mm_mul_ps(wec_p1, wec_p2), zero);
+  __m128 cross_q = _mm_cmpnge_ps(_mm_mul_ps(wec_q1, wec_q2), zero);
+
+  // only reach the clipping side test when the subject side crosses
+  __m128 check_q = _mm_andnot_ps(degenerate_p, cross_p);
+
+  degenerate = static_cast<uint32_t>(_mm_movemask_ps(
+      _mm_or_ps(degenerate_p, _mm_and_ps(check_q, degenerate_q))));
+  hit = static_cast<uint32_t>(_mm_movemask_ps(
+      _mm_and_ps(_mm_andnot_ps(degenerate_q, check_q), cross_q)));
+}
+
+PC_TARGET_SSE2 static void
+segment_lanes_sse(const SegmentLanes<float> &l,
+                  SegmentLaneResult<float> &result) {
+  const __m128 sign_mask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+
+  result.hit_mask = 0;
+  result.degenerate_mask = 0;
+
+  for (uint32_t i = 0; i < kSegmentLanes; i += 4) {
+    __m128 p1x = _mm_load_ps(l.p1x + i);
+    __m128 p1y = _mm_load_ps(l.p1y + i);
+    __m128 p2x = _mm_load_ps(l.p2x + i);
+    __m128 p2y = _mm_load_ps(l.p2y + i);
+    __m128 q1x = _mm_load_ps(l.q1x + i);
+    __m128 q1y = _mm_load_ps(l.q1y + i);
+    __m128 q2x = _mm_load_ps(l.q2x + i);
+    __m128 q2y = _mm_load_ps(l.q2y + i);
+
+    __m128 q21x = _mm_sub_ps(q2x, q1x);
+    __m128 q21y_neg = _mm_xor_ps(_mm_sub_ps(q2y, q1y), sign_mask);
+    __m128 p21x = _mm_sub_ps(p2x, p1x);
+    __m128 p21y_neg = _mm_xor_ps(_mm_sub_ps(p2y, p1y), sign_mask);
+
+    __m128 wec_p1 =
+        _mm_add_ps(_mm_mul_ps(_mm_sub_ps(p1x, q1x), q21y_neg),
+                   _mm_mul_ps(_mm_sub_ps(p1y, q1y), q21x));
+    __m128 wec_p2 =
+        _mm_add_ps(_mm_mul_ps(_mm_sub_ps(p2x, q1x), q21y_neg),
+                   _mm_mul_ps(_mm_sub_ps(p2y, q1y), q21x));
+    __m128 wec_q1 =
+        _mm_add_ps(_mm_mul_ps(_mm_sub_ps(q1x, p1x), p21y_neg),
+                   _mm_mul_ps(_mm_sub_ps(q1y, p1y), p21x));
+    __m128 wec_q2 =
+        _mm_add_ps(_mm_mul_ps(_mm_sub_ps(q2x, p1x), p21y_neg),
+                   _mm_mul_ps(_mm_sub_ps(q2y, p1y), p21x));
+
+    _mm_store_ps(result.t1 + i,
+                 _mm_div_ps(wec_p1, _mm_sub_ps(wec_p1, wec_p2)));
+    _mm_store_ps(result.t2 + i,
+                 _mm_div_ps(wec_q1, _mm_sub_ps(wec_q1, wec_q2)));
+
+    uint32_t hit = 0;
+    uint32_t degenerate = 0;
+    sse_masks(wec_p1, wec_p2, wec_q1, wec_q2, hit, degenerate);
+
+    result.hit_mask |= hit << i;
+    result.degenerate_mask |= degenerate << i;
+  }
+}
+
+PC_TARGET_AVX2 static void
+segment_lanes_avx2(const SegmentLanes<float> &l,
+                   SegmentLaneResult<float> &result) {
+  const __m256 sign_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x80000000));
+  const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+  const __m256 near_zero = _mm256_set1_ps(kLaneNearZero);
+  const __m256 zero = _mm256_setzero_ps();
+
+  __m256 p1x = _mm256_load_ps(l.p1x);
+  __m256 p1y = _mm256_load_ps(l.p1y);
+  __m256 p2x = _mm256_load_ps(l.p2x);
+  __m256 p2y = _mm256_load_ps(l.p2y);
+  __m256 q1x = _mm256_load_ps(l.q1x);
+  __m256 q1y = _mm256_load_ps(l.q1y);
+  __m256 q2x = _mm256_load_ps(l.q2x);
+  __m256 q2y = _mm256_load_ps(l.q2y);
+
+  __m256 q21x = _mm256_sub_ps(q2x, q1x);
+  __m256 q21y_neg = _mm256_xor_ps(_mm256_sub_ps(q2y, q1y), sign_mask);
+  __m256 p21x = _mm256_sub_ps(p2x, p1x);
+  __m256 p21y_neg = _mm256_xor_ps(_mm256_sub_ps(p2y, p1y), sign_mask);
+
+  // no fma here, the products must round like the scalar code
+  __m256 wec_p1 =
+      _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(p1x, q1x), q21y_neg),
+                    _mm256_mul_ps(_mm256_sub_ps(p1y, q1y), q21x));
+  __m256 wec_p2 =
+      _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(p2x, q1x), q21y_neg),
+                    _mm256_mul_ps(_mm256_sub_ps(p2y, q1y), q21x));
+  __m256 wec_q1 =
+      _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(q1x, p1x), p21y_neg),
+                    _mm256_mul_ps(_mm256_sub_ps(q1y, p1y), p21x));
+  __m256 wec_q2 =
+      _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(q2x, p1x), p21y_neg),
+                    _mm256_mul_ps(_mm256_sub_ps(q2y, p1y), p21x));
+
+  _mm256_store_ps(result.t1,
+                  _mm256_div_ps(wec_p1, _mm256_sub_ps(wec_p1, wec_p2)));
+  _mm256_store_ps(result.t2,
+                  _mm256_div_ps(wec_q1, _mm256_sub_ps(wec_q1, wec_q2)));
+
+  __m256 degenerate_p = _mm256_or_ps(
+      _mm256_cmp_ps(_mm256_and_ps(wec_p1, abs_mask), near_zero, _CMP_LE_OQ),
+      _mm256_cmp_ps(_mm256_and_ps(wec_p2, abs_mask), near_zero, _CMP_LE_OQ));
+  __m256 degenerate_q = _mm256_or_ps(
+      _mm256_cmp_ps(_mm256_and_ps(wec_q1, abs_mask), near_zero, _CMP_LE_OQ),
+      _mm256_cmp_ps(_mm256_and_ps(wec_q2, abs_mask), near_zero, _CMP_LE_OQ));
+  __m256 cross_p =
+      _mm256_cmp_ps(_mm256_mul_ps(wec_p1, wec_p2), zero, _CMP_NGE_UQ);
+  __m256 cross_q =
+      _mm256_cmp_ps(_mm256_mul_ps(wec_q1, wec_q2), zero, _CMP_NGE_UQ);
+
+  __m256 check_q = _mm256_andnot_ps(degenerate_p, cross_p);
+
+  result.degenerate_mask = static_cast<uint32_t>(_mm256_movemask_ps(
+      _mm256_or_ps(degenerate_p, _mm256_and_ps(check_q, degenerate_q))));
+  result.hit_mask = static_cast<uint32_t>(_mm256_movemask_ps(
+      _mm256_and_ps(_mm256_andnot_ps(degenerate_q, check_q), cross_q)));
+}
+
+static bool cpu_has_avx2() {
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER)
+  int info[4] = {};
+  __cpuid(info, 0);
+  if (info[0] < 7) {
+    return false;
+  }
+
+  __cpuid(info, 1);
+  bool os_saves_ymm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) &&
+                      (_xgetbv(0) & 0x6) == 0x6;
+
+  __cpuidex(info, 7, 0);
+  return os_saves_ymm && (info[1] & (1 << 5));
+#else
+  return false;
+#endif
+}
+
+static bool cpu_has_sse2() {
+#if defined(__x86_64__) || defined(_M_X64)
+  return true;
+#elif defined(__GNUC__) || defined(__clang__)
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("sse2");
+#elif defined(_MSC_VER)
+  int info[4] = {};
+  __cpuid(info, 1);
+  return info[3] & (1 << 26);
+#else
+  return false;
+#endif
+}
+
+#endif // PC_SIMD_X86
+
+static LaneKernel select_kernel() {
+#ifdef PC_SIMD_X86
+  if (cpu_has_avx2()) {
+    return segment_lanes_avx2;
+  }
+
+  if (cpu_has_sse2()) {
+    return segment_lanes_sse;
+  }
+#endif
+
+  return segment_lanes_plain<float>;
+}
+
+/**
+ * Drop the lanes at and after count from the masks
+ */
+template <typename T>
+static void mask_lanes(uint32_t count, SegmentLaneResult<T> &result) {
+  uint32_t used = count >= kSegmentLanes ? ~0u : (1u << count) - 1;
+
+  result.hit_mask &= used;
+  result.degenerate_mask &= used;
+}
+
+void Math::segment_test_lanes(const SegmentLanes<float> &lanes,
+                              uint32_t count,
+                              SegmentLaneResult<float> &result) {
+  static const LaneKernel kernel = select_kernel();
+
+  kernel(lanes, result);
+
+  mask_lanes(count, result);
+}
+
+void Math::segment_test_lanes(const SegmentLanes<double> &lanes,
+                              uint32_t count,
+                              SegmentLaneResult<double> &result) {
+  // double lanes are only used where float loses precision, the compiler is
+  // left to vectorize the plain loop
+  segment_lanes_plain(lanes, result);
+
+  mask_lanes(count, result);
+}
+
+} // namespace pc
@@ -0,0 +1,244 @@
+#include "polygon_clip.hpp"
+#include "polygon_clip_math.hpp"
+#include "polygon_clip_scalar.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace pc {
+
+// bands are cut so each holds about this many edge end points
+constexpr uint32_t kPreparedEndsPerBand = 32;
+
+template <typename T>
+BasicPreparedPolygon<T>::BasicPreparedPolygon(const Polygon &polygon) {
+  auto bounds = polygon.get_bounds();
+  if (!bounds) {
+    return;
+  }
+
+  struct Edge {
+    Point p1;
+    Point p2;
+  };
+
+  // horizontal edges never cross a horizontal ray
+  std::vector<Edge> edges;
+  std::vector<T> ends;
+  for (auto head : polygon.get_vertices()) {
+    auto v = head;
+    do {
+      if (v->point.y != v->next->point.y) {
+        edges.emplace_back(Edge{v->point, v->next->point});
+        ends.emplace_back(v->point.y);
+        ends.emplace_back(v->next->point.y);
+      }
+
+      v = v->next;
+    } while (v != head);
+  }
+
+  if (edges.empty()) {
+    return;
+  }
+
+  // cut the bands at end points, so crowded parts of the polygon get thin
+  // bands and no band holds many partial edges
+  std::sort(ends.begin(), ends.end());
+  for (size_t i = 0; i < ends.size(); i += kPreparedEndsPerBand) {
+    if (m_band_start.empty() || ends[i] != m_band_start.back()) {
+      m_band_start.emplace_back(ends[i]);
+    }
+  }
+
+  m_bottom = ends.back();
+  m_right = bounds->right_bottom.x;
+
+  auto band_count = static_cast<uint32_t>(m_band_start.size());
+
+  m_leaf_base = 1;
+  while (m_leaf_base < band_count) {
+    m_leaf_base *= 2;
+  }
+
+  std::vector<std::vector<uint32_t>> partial(band_count);
+  std::vector<std::vector<uint32_t>> full(2 * m_leaf_base);
+
+  for (uint32_t i = 0; i < edges.size(); i++) {
+    const auto &e = edges[i];
+
+    T y_min = std::min(e.p1.y, e.p2.y);
+    T y_max = std::max(e.p1.y, e.p2.y);
+
+    auto b0 = band_of(y_min);
+    auto b1 = band_of(y_max);
+
+    // the edge crosses bands [f0, f1) whole, the last band also holds points
+    // at its bottom, so it never ends inside another band
+    auto f0 = y_min == m_band_start[b0] ? b0 : b0 + 1;
+    auto f1 = b1;
+
+    if (b0 < f0) {
+      partial[b0].emplace_back(i);
+    }
+    // an edge ending at the start of band b1 does not reach its points
+    if (y_max > m_band_start[b1] && (b1 != b0 || b0 == f0)) {
+      partial[b1].emplace_back(i);
+    }
+
+    // store it at the fewest nodes covering exactly [f0, f1)
+    for (auto l = f0 + m_leaf_base, r = f1 + m_leaf_base; l < r;
+         l /= 2, r /= 2) {
+      if (l & 1) {
+        full[l++].emplace_back(i);
+      }
+      if (r & 1) {
+        full[--r].emplace_back(i);
+      }
+    }
+  }
+
+  auto push_edge = [this, &edges](uint32_t i) {
+    const auto &e = edges[i];
+
+    m_x1.emplace_back(e.p1.x);
+    m_y1.emplace_back(e.p1.y);
+    m_x2.emplace_back(e.p2.x);
+    m_y2.emplace_back(e.p2.y);
+    m_x_min.emplace_back(std::min(e.p1.x, e.p2.x));
+    m_suffix.emplace_back(0);
+  };
+
+  for (uint32_t b = 0; b < band_count; b++) {
+    m_partial.emplace_back(static_cast<uint32_t>(m_x1.size()));
+    for (auto i : partial[b]) {
+      push_edge(i);
+    }
+  }
+  m_partial.emplace_back(static_cast<uint32_t>(m_x1.size()));
+
+  m_nodes.resize(2 * m_leaf_base);
+
+  for (size_t n = 1; n < m_nodes.size(); n++) {
+    auto &node = m_nodes[n];
+    auto &crossing = full[n];
+
+    std::sort(crossing.begin(), crossing.end(),
+              [&edges](uint32_t i1, uint32_t i2) {
+                return std::min(edges[i1].p1.x, edges[i1].p2.x) <
+                       std::min(edges[i2].p1.x, edges[i2].p2.x);
+              });
+
+    node.full_begin = static_cast<uint32_t>(m_x1.size());
+    for (auto i : crossing) {
+      const auto &e = edges[i];
+
+      push_edge(i);
+      node.full_width =
+          std::max(node.full_width, std::abs(static_cast<double>(e.p2.x) -
+                                             static_cast<double>(e.p1.x)));
+    }
+    node.full_end = static_cast<uint32_t>(m_x1.size());
+
+    int32_t sum = 0;
+    for (auto k = node.full_end; k > node.full_begin; k--) {
+      sum += m_y2[k - 1] > m_y1[k - 1] ? 1 : -1;
+      m_suffix[k - 1] = sum;
+    }
+  }
+}
+
+template <typename T> uint32_t BasicPreparedPolygon<T>::band_of(T y) const {
+  auto it = std::upper_bound(m_band_start.begin(), m_band_start.end(), y);
+
+  return it == m_band_start.begin()
+             ? 0
+             : static_cast<uint32_t>(it - m_band_start.begin() - 1);
+}
+
+template <typename T>
+int32_t BasicPreparedPolygon<T>::crossing(uint32_t k, const Point &p) const {
+  T x1 = m_x1[k];
+  T y1 = m_y1[k];
+  T x2 = m_x2[k];
+  T y2 = m_y2[k];
+
+  if ((y2 > p.y) == (y1 > p.y)) {
+    return 0;
+  }
+
+  bool right;
+  if constexpr (ScalarTraits<T>::kExact) {
+    int side = Math::orientation(Point(x1, y1), Point(x2, y2), p, 0);
+    right = y2 > y1 ? side > 0 : side < 0;
+  } else {
+    // rounds exactly like Polygon::contains
+    right = p.x < (x1 - x2) * (p.y - y2) / (y1 - y2) + x2;
+  }
+
+  if (!right) {
+    return 0;
+  }
+
+  return y2 > y1 ? 1 : -1;
+}
+
+template <typename T>
+int32_t BasicPreparedPolygon<T>::winding(const Point &p) const {
+  if (m_nodes.empty() || p.y < m_band_start.front() || p.y > m_bottom ||
+      p.x > m_right) {
+    return 0;
+  }
+
+  auto band = band_of(p.y);
+
+  int32_t winding = 0;
+
+  for (auto k = m_partial[band]; k < m_partial[band + 1]; k++) {
+    winding += crossing(k, p);
+  }
+
+  for (auto n = m_leaf_base + band; n > 0; n /= 2) {
+    const auto &node = m_nodes[n];
+
+    // edges starting right of p all cross the ray
+    auto first = m_x_min.begin() + node.full_begin;
+    auto last = m_x_min.begin() + node.full_end;
+    auto right = std::upper_bound(first, last, p.x);
+
+    if (right != last) {
+      winding += m_suffix[right - m_x_min.begin()];
+    }
+
+    // edges starting left of p can only reach it within the node width
+    double reach = static_cast<double>(p.x) - node.full_width;
+
+    for (auto it = right; it != first && *(it - 1) >= reach; it--) {
+      winding +=
+          crossing(static_cast<uint32_t>(it - 1 - m_x_min.begin()), p);
+    }
+  }
+
+  return winding;
+}
+
+template <typename T>
+bool BasicPreparedPolygon<T>::contains(const Point &p, FillRule rule) const {
+  int32_t w = winding(p);
+
+  return rule == FillRule::kNonZero ? w != 0 : (w & 1) != 0;
+}
+
+template <typename T>
+void BasicPreparedPolygon<T>::contains(const Point *points, size_t count,
+                                       bool *inside, FillRule rule) const {
+  for (size_t i = 0; i < count; i++) {
+    inside[i] = contains(points[i], rule);
+  }
+}
+
+template class BasicPreparedPolygon<float>;
+template class BasicPreparedPolygon<double>;
+template class BasicPreparedPolygon<int32_t>;
+
+} // namespace pc
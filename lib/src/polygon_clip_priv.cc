@@ -1,40 +1,70 @@
 #include "polygon_clip_priv.hpp"
+#include "polygon_clip_fill.hpp"
+#include "polygon_clip_flat.hpp"
+#include "polygon_clip_index.hpp"
 #include "polygon_clip_math.hpp"
+#include "polygon_clip_stats.hpp"
+#include "polygon_clip_sweep.hpp"
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <type_traits>
 
 namespace pc {
 
-constexpr float kFloatNearZero = 1.f / (1 << 12);
+// ConvexClipper tests every edge of the other input against every side of
+// the window, beyond this many sides the intersection search is faster
+constexpr uint32_t kMaxConvexWindowSides = 32;
 
-bool scalar_equal(Scalar s1, Scalar s2) {
-  return std::abs(s1 - s2) <= kFloatNearZero;
+template <typename T> static bool scalar_equal(T s1, T s2) {
+  return std::abs(s1 - s2) <= ScalarTraits<T>::kNearZero;
 }
 
-bool scalar_less(Scalar s1, Scalar s2) { return s1 - s2 > -kFloatNearZero; }
+template <typename T> static bool scalar_less(T s1, T s2) {
+  return s1 - s2 > -ScalarTraits<T>::kNearZero;
+}
+
+template <typename T> bool scalar_is_zero(T t) {
+  return scalar_equal(t, T(0));
+}
 
-bool scalar_is_zero(float t) { return scalar_equal(t, 0.f); }
+template <typename T>
+void check_coordinates(const BasicPolygonView<T> &view) {
+  if constexpr (ScalarTraits<T>::kExact) {
+    for (size_t i = 0; i < view.vertex_count(); i++) {
+      auto p = view.point(i);
+      check_coordinate(p.x);
+      check_coordinate(p.y);
+    }
+  }
+}
 
-Point operator-(const Point &p1, const Point &p2) {
-  return Point(p1.x - p2.x, p1.y - p2.y);
+template <typename T>
+BasicPoint<T> operator-(const BasicPoint<T> &p1, const BasicPoint<T> &p2) {
+  return BasicPoint<T>(p1.x - p2.x, p1.y - p2.y);
 }
 
-Point operator+(const Point &p1, const Point &p2) {
-  return Point(p1.x + p2.x, p1.y + p2.y);
+template <typename T>
+BasicPoint<T> operator+(const BasicPoint<T> &p1, const BasicPoint<T> &p2) {
+  return BasicPoint<T>(p1.x + p2.x, p1.y + p2.y);
 }
 
-Point operator*(const Point &p1, Scalar f) { return Point(p1.x * f, p1.y * f); }
+template <typename T> BasicPoint<T> operator*(const BasicPoint<T> &p1, T f) {
+  return BasicPoint<T>(p1.x * f, p1.y * f);
+}
 
-bool operator<(const Point &p1, const Point &p2) {
+template <typename T>
+bool operator<(const BasicPoint<T> &p1, const BasicPoint<T> &p2) {
   return p1.y < p2.y || (scalar_equal(p1.y, p2.y) && scalar_less(p1.x, p2.x));
 }
 
-bool operator==(const Point &p1, const Point &p2) {
+template <typename T>
+bool operator==(const BasicPoint<T> &p1, const BasicPoint<T> &p2) {
   return scalar_equal(p1.x, p2.x) && scalar_equal(p1.y, p2.y);
 }
 
-PolygonIter::PolygonIter(const std::vector<Vertex *> &polygons)
+template <typename T>
+PolygonIter<T>::PolygonIter(const std::vector<Vertex *> &polygons)
     : m_polygon(polygons) {
   m_index = 0;
   if (m_polygon.empty()) {
@@ -46,415 +76,879 @@ PolygonIter::PolygonIter(const std::vector<Vertex *> &polygons)
   }
 }
 
-bool PolygonIter::has_next() {
-  if (m_loop_end && m_index == m_polygon.size() - 1) {
-    return false;
-  }
-
-  return true;
+template <typename T> bool PolygonIter<T>::has_next() {
+  return m_current != nullptr;
 }
 
-void PolygonIter::move_next() {
-  if (!m_loop_end) {
-    m_current = m_current->next;
-    if (m_current == m_curr_head) {
-      m_loop_end = true;
-    }
+template <typename T> void PolygonIter<T>::move_next() {
+  m_current = m_current->next;
+  if (m_current != m_curr_head) {
     return;
   }
 
-  if (m_index == m_polygon.size() - 1) {
+  // the ring is closed, continue with the head of the next one
+  m_index++;
+  if (m_index == m_polygon.size()) {
+    m_current = nullptr;
     return;
   }
 
-  m_index++;
   m_curr_head = m_polygon[m_index];
   m_current = m_curr_head;
-  m_loop_end = false;
 }
 
-Vertex *PolygonIter::current() { return m_current; }
+template <typename T> BasicVertex<T> *PolygonIter<T>::current() {
+  return m_current;
+}
 
-Polygon ClipAlgorithm::do_clip(Polygon subject, Polygon clipping) {
-  Polygon result;
+/**
+ * Quick reject by bounding box, polygons without any overlapping box can not
+ * intersect each other.
+ */
+template <typename P1, typename P2>
+static bool bounds_overlap(const P1 &p1, const P2 &p2) {
+  auto b1 = p1.get_bounds();
+  auto b2 = p2.get_bounds();
 
-  ClipAlgorithm algorithm(std::move(subject), std::move(clipping));
+  return b1 && b2 && b1->overlaps(*b2);
+}
 
-  algorithm.process_intersection();
+template <typename T>
+BasicPolygon<T> ClipAlgorithm<T>::take_result(Workspace &workspace) {
+  auto result = std::move(workspace.result);
+  result.clear();
 
-  bool no_intersection;
-  uint32_t inner_indicator;
+  return result;
+}
 
-  std::tie(no_intersection, inner_indicator) = algorithm.mark_vertices();
+template <typename T>
+template <typename P>
+void ClipAlgorithm<T>::forward_input(P &&input, Sink &sink) {
+  if constexpr (std::is_rvalue_reference_v<P &&>) {
+    if (sink.polygon()) {
+      sink.take(Polygon(std::move(input)));
+      return;
+    }
+  }
 
-  // there is no intersection points
-  if (no_intersection) {
-    if (inner_indicator == 0) {
-      // there is no intersection area between these two polygon
-      return result;
-    } else if (inner_indicator == 1) {
-      // clipping is inside subject
-      return algorithm.m_clipping;
-    } else if (inner_indicator == 2) {
-      // subject is inside clipping
-      return algorithm.m_subject;
+  append_input(sink, input, false);
+
+  // same rings in the same order, as for a copy
+  if (auto result = sink.polygon()) {
+    result->m_index = input_index(input);
+  }
+}
+
+template <typename T>
+template <typename S, typename C>
+void ClipAlgorithm<T>::forward_inputs(S &&subject, C &&clipping, bool reverse,
+                                      Sink &sink) {
+  if constexpr (std::is_rvalue_reference_v<S &&> &&
+                std::is_rvalue_reference_v<C &&>) {
+    if (sink.polygon()) {
+      sink.take(Polygon(std::move(subject), std::move(clipping), reverse));
+      return;
     }
+  }
+
+  append_input(sink, subject, false);
+  append_input(sink, clipping, reverse);
+}
 
-    return result;
+template <typename T>
+void ClipAlgorithm<T>::append_input(Sink &sink, const Polygon &input,
+                                    bool reverse) {
+  for (size_t r = 0; r < input.m_sub_polygons.size(); r++) {
+    sink.add_ring(input, r, reverse);
   }
+}
 
-  std::vector<Vertex *> intersection_points;
-  for (auto &vert : algorithm.m_subject.m_vertex) {
-    if (vert->intersect) {
-      intersection_points.emplace_back(vert.get());
+template <typename T>
+void ClipAlgorithm<T>::append_input(Sink &sink, const View &input,
+                                    bool reverse) {
+  for (size_t r = 0; r < input.ring_count; r++) {
+    if (input.ring_size(r) >= 3) {
+      sink.add_ring(input, r, reverse);
     }
   }
+}
 
-  for (auto vert : intersection_points) {
-    if (vert->marked) {
-      continue;
+template <typename T>
+template <typename S, typename C>
+void ClipAlgorithm<T>::clip_impl(S &&subject, C &&clipping, Sink &sink,
+                                 Workspace &workspace) {
+  if (!bounds_overlap(subject, clipping)) {
+    return;
+  }
+
+  ClipAlgorithm algorithm(subject, clipping, workspace);
+
+  algorithm.process_intersection();
+
+  const auto &subject_rings = algorithm.m_subject_rings;
+  const auto &clipping_rings = algorithm.m_clipping_rings;
+
+  if (algorithm.mark_vertices()) {
+    // there is no intersection point, a polygon lying inside the other as a
+    // whole is the result
+    auto subject_inside = count_untouched(subject_rings, true);
+    auto clipping_inside = count_untouched(clipping_rings, true);
+
+    if (subject_inside == subject_rings.size() && clipping_inside == 0) {
+      return forward_input(std::forward<S>(subject), sink);
+    } else if (clipping_inside == clipping_rings.size() &&
+               subject_inside == 0) {
+      return forward_input(std::forward<C>(clipping), sink);
     }
+  }
+
+  PC_STATS(PhaseTimer timer(algorithm.m_stats, &ClipStats::walk_ns));
+
+  FlatPolygon<T> *polygons[2] = {&algorithm.m_subject, &algorithm.m_clipping};
 
-    std::vector<Point> pts;
+  // intersection points are stored behind all input vertices
+  for (uint32_t vert = algorithm.m_subject.input_count();
+       vert < algorithm.m_subject.vertex_count(); vert++) {
+    if (algorithm.m_subject.has_flag(vert, kVertexMarked)) {
+      continue;
+    }
 
-    vert->marked = true;
+    algorithm.m_subject.set_flag(vert, kVertexMarked, true);
 
-    auto start = vert;
-    auto current = start;
+    uint32_t side = 0;
+    auto current = vert;
 
-    pts.emplace_back(current->point);
+    sink.add_point(polygons[side]->point(current));
 
     do {
-      if (current->entry_exit) {
+      auto polygon = polygons[side];
+
+      if (polygon->has_flag(current, kVertexEntryExit)) {
         do {
-          current = current->next;
+          current = polygon->next[current];
 
-          pts.emplace_back(current->point);
-        } while (!current->intersect);
+          sink.add_point(polygon->point(current));
+        } while (!polygon->has_flag(current, kVertexIntersect));
       } else {
         do {
-          current = current->prev;
+          current = polygon->prev[current];
 
-          pts.emplace_back(current->point);
-        } while (!current->intersect);
+          sink.add_point(polygon->point(current));
+        } while (!polygon->has_flag(current, kVertexIntersect));
       }
-      current->marked = true;
-      current = current->neighbour;
-      current->marked = true;
-    } while (current != start);
+      polygon->set_flag(current, kVertexMarked, true);
+      current = polygon->neighbour[current];
+      side ^= 1;
+      polygons[side]->set_flag(current, kVertexMarked, true);
+    } while (side != 0 || current != vert);
 
-    result.append_vertices(pts);
+    sink.close_ring();
   }
 
-  return result;
+  // rings no intersection touches are kept where they are inside the other
+  append_untouched(sink, subject, subject_rings, true, false);
+  append_untouched(sink, clipping, clipping_rings, true, false);
 }
 
-Polygon ClipAlgorithm::do_union(Polygon subject, Polygon clipping) {
-  Polygon result;
+template <typename T>
+template <typename S, typename C>
+void ClipAlgorithm<T>::union_impl(S &&subject, C &&clipping, Sink &sink,
+                                  Workspace &workspace) {
+  if (!bounds_overlap(subject, clipping)) {
+    return forward_inputs(std::forward<S>(subject), std::forward<C>(clipping),
+                          false, sink);
+  }
 
-  ClipAlgorithm algorithm(std::move(subject), std::move(clipping));
+  ClipAlgorithm algorithm(subject, clipping, workspace);
 
   algorithm.process_intersection();
 
-  bool no_intersection;
-  uint32_t inner_indicator;
-
-  std::tie(no_intersection, inner_indicator) = algorithm.mark_vertices();
-
-  // there is intersections just walk through and merge all outlines
-  if (!no_intersection) {
-    std::vector<Vertex *> intersection_points;
-    for (auto &vert : algorithm.m_subject.m_vertex) {
-      if (vert->intersect) {
-        intersection_points.emplace_back(vert.get());
-      }
+  const auto &subject_rings = algorithm.m_subject_rings;
+  const auto &clipping_rings = algorithm.m_clipping_rings;
+
+  if (algorithm.mark_vertices()) {
+    // there is no intersection point
+    auto subject_outside = count_untouched(subject_rings, false);
+    auto clipping_outside = count_untouched(clipping_rings, false);
+
+    if (subject_outside == subject_rings.size() &&
+        clipping_outside == clipping_rings.size()) {
+      // subject and clipping has no intersect area
+      return forward_inputs(std::forward<S>(subject),
+                            std::forward<C>(clipping), false, sink);
+    } else if (subject_outside == subject_rings.size() &&
+               clipping_outside == 0) {
+      // clipping is inside subject
+      return forward_input(std::forward<S>(subject), sink);
+    } else if (clipping_outside == clipping_rings.size() &&
+               subject_outside == 0) {
+      // subject is inside clipping
+      return forward_input(std::forward<C>(clipping), sink);
     }
+  }
 
-    for (auto vertex : intersection_points) {
-      if (vertex->marked) {
-        continue;
-      }
+  // walk through the intersections and merge all outlines
+  PC_STATS(PhaseTimer timer(algorithm.m_stats, &ClipStats::walk_ns));
 
-      vertex->marked = true;
+  FlatPolygon<T> *polygons[2] = {&algorithm.m_subject, &algorithm.m_clipping};
 
-      std::vector<Point> pts;
+  for (uint32_t vertex = algorithm.m_subject.input_count();
+       vertex < algorithm.m_subject.vertex_count(); vertex++) {
+    if (algorithm.m_subject.has_flag(vertex, kVertexMarked)) {
+      continue;
+    }
 
-      pts.emplace_back(vertex->point);
+    algorithm.m_subject.set_flag(vertex, kVertexMarked, true);
 
-      auto curr = vertex;
+    sink.add_point(algorithm.m_subject.point(vertex));
 
-      do {
-        if (curr->entry_exit) {
-          do {
-            curr = curr->prev;
+    uint32_t side = 0;
+    auto curr = vertex;
 
-            pts.emplace_back(curr->point);
-          } while (!curr->intersect);
-        } else {
-          do {
-            curr = curr->next;
+    do {
+      auto polygon = polygons[side];
 
-            pts.emplace_back(curr->point);
-          } while (!curr->intersect);
-        }
-        curr->marked = true;
-        curr = curr->neighbour;
-        curr->marked = true;
-      } while (curr != vertex);
+      if (polygon->has_flag(curr, kVertexEntryExit)) {
+        do {
+          curr = polygon->prev[curr];
 
-      result.append_vertices(pts);
-    }
+          sink.add_point(polygon->point(curr));
+        } while (!polygon->has_flag(curr, kVertexIntersect));
+      } else {
+        do {
+          curr = polygon->next[curr];
 
-    return result;
-  }
+          sink.add_point(polygon->point(curr));
+        } while (!polygon->has_flag(curr, kVertexIntersect));
+      }
+      polygon->set_flag(curr, kVertexMarked, true);
+      curr = polygon->neighbour[curr];
+      side ^= 1;
+      polygons[side]->set_flag(curr, kVertexMarked, true);
+    } while (side != 0 || curr != vertex);
 
-  // there is no intersections
-  if (inner_indicator == 0) {
-    // subject and clipping has no intersect area
-    return Polygon(algorithm.m_subject, algorithm.m_clipping);
-  } else if (inner_indicator == 1) {
-    // clipping is inside subject
-    return Polygon(algorithm.m_subject);
-  } else {
-    // subject is inside clipping
-    return Polygon(algorithm.m_clipping);
+    sink.close_ring();
   }
+
+  // rings no intersection touches are kept where they are outside the other
+  append_untouched(sink, subject, subject_rings, false, false);
+  append_untouched(sink, clipping, clipping_rings, false, false);
 }
 
-Polygon ClipAlgorithm::do_diff(Polygon subject, Polygon clipping) {
-  Polygon result;
+template <typename T>
+template <typename S, typename C>
+void ClipAlgorithm<T>::diff_impl(S &&subject, C &&clipping, Sink &sink,
+                                 Workspace &workspace) {
+  if (!bounds_overlap(subject, clipping)) {
+    return forward_input(std::forward<S>(subject), sink);
+  }
 
-  ClipAlgorithm algorithm(std::move(subject), std::move(clipping));
+  ClipAlgorithm algorithm(subject, clipping, workspace);
 
   algorithm.process_intersection();
 
-  bool no_intersection;
-  uint32_t inner_indicator;
+  const auto &subject_rings = algorithm.m_subject_rings;
+  const auto &clipping_rings = algorithm.m_clipping_rings;
+
+  if (algorithm.mark_vertices()) {
+    // there is no intersection point
+    auto subject_outside = count_untouched(subject_rings, false);
+    auto clipping_inside = count_untouched(clipping_rings, true);
+
+    if (subject_outside == subject_rings.size() && clipping_inside == 0) {
+      // there is no common area between two polygons
+      return forward_input(std::forward<S>(subject), sink);
+    } else if (subject_outside == subject_rings.size() &&
+               clipping_inside == clipping_rings.size()) {
+      // clipping is inside subject and becomes a hole
+      return forward_inputs(std::forward<S>(subject),
+                            std::forward<C>(clipping), true, sink);
+    }
+  }
+
+  PC_STATS(PhaseTimer timer(algorithm.m_stats, &ClipStats::walk_ns));
 
-  std::tie(no_intersection, inner_indicator) = algorithm.mark_vertices();
+  FlatPolygon<T> *polygons[2] = {&algorithm.m_subject, &algorithm.m_clipping};
 
-  if (!no_intersection) {
-    std::vector<Vertex *> intersection_points;
-    for (auto &vert : algorithm.m_subject.m_vertex) {
-      if (vert->intersect) {
-        intersection_points.emplace_back(vert.get());
-      }
+  for (uint32_t vertex = algorithm.m_subject.input_count();
+       vertex < algorithm.m_subject.vertex_count(); vertex++) {
+    if (algorithm.m_subject.has_flag(vertex, kVertexMarked)) {
+      continue;
     }
 
-    for (auto vertex : intersection_points) {
-      if (vertex->marked) {
-        continue;
+    algorithm.m_subject.set_flag(vertex, kVertexMarked, true);
+
+    // side 0 walks the subject itself, side 1 walks the clipping
+    uint32_t side = 0;
+
+    auto curr = vertex;
+
+    sink.add_point(algorithm.m_subject.point(curr));
+
+    do {
+      auto polygon = polygons[side];
+      bool self = side == 0;
+
+      if (polygon->has_flag(curr, kVertexEntryExit)) {
+        do {
+          if (self) {
+            curr = polygon->prev[curr];
+          } else {
+            curr = polygon->next[curr];
+          }
+
+          sink.add_point(polygon->point(curr));
+        } while (!polygon->has_flag(curr, kVertexIntersect));
+      } else {
+        do {
+          if (self) {
+            curr = polygon->next[curr];
+          } else {
+            curr = polygon->prev[curr];
+          }
+
+          sink.add_point(polygon->point(curr));
+        } while (!polygon->has_flag(curr, kVertexIntersect));
       }
 
-      vertex->marked = true;
-      bool self = true;
-
-      std::vector<Point> pts;
-
-      auto curr = vertex;
-
-      pts.emplace_back(curr->point);
-
-      do {
-        if (curr->entry_exit) {
-          do {
-            if (self) {
-              curr = curr->prev;
-            } else {
-              curr = curr->next;
-            }
-
-            pts.emplace_back(curr->point);
-          } while (!curr->intersect);
-        } else {
-          do {
-            if (self) {
-              curr = curr->next;
-            } else {
-              curr = curr->prev;
-            }
-
-            pts.emplace_back(curr->point);
-          } while (!curr->intersect);
-        }
-
-        self = !self;
-        curr->marked = true;
-        curr = curr->neighbour;
-        curr->marked = true;
-      } while (curr != vertex);
-
-      result.append_vertices(pts);
-    }
+      polygon->set_flag(curr, kVertexMarked, true);
+      curr = polygon->neighbour[curr];
+      side ^= 1;
+      polygons[side]->set_flag(curr, kVertexMarked, true);
+    } while (side != 0 || curr != vertex);
 
-    return result;
+    sink.close_ring();
   }
 
-  if (inner_indicator == 0) {
-    // there is no common area between two polygons
-    return Polygon(algorithm.m_subject);
-  } else if (inner_indicator == 2) {
-    // subject is inside clipping, no different part
-    return result;
+  // untouched subject rings are kept outside the clipping, untouched clipping
+  // rings inside the subject become holes
+  append_untouched(sink, subject, subject_rings, false, false);
+  append_untouched(sink, clipping, clipping_rings, true, true);
+}
+
+template <typename T>
+bool ClipAlgorithm<T>::is_convex_window(const Polygon &polygon) {
+  if (polygon.m_sub_shapes.size() != 1 || !polygon.m_sub_shapes[0].convex) {
+    return false;
   }
 
-  return Polygon(algorithm.m_subject, algorithm.m_clipping, true);
+  auto head = polygon.m_sub_polygons.front();
+  auto current = head;
+
+  for (uint32_t sides = 1; sides <= kMaxConvexWindowSides; sides++) {
+    current = current->next;
+    if (current == head) {
+      return true;
+    }
+  }
+
+  return false;
 }
 
-struct VertexDist {
-  Vertex *vert;
-  float t;
+template <typename T>
+void ClipAlgorithm<T>::convex_op(BoolOp op, const Polygon &polygon,
+                                 const Polygon &window, bool window_first,
+                                 Sink &sink, Workspace &workspace) {
+  PC_STATS(PhaseTimer timer(workspace.stats, &ClipStats::walk_ns));
+
+  using Region = typename ConvexClipper<T>::Region;
+
+  auto region = Region::kIntersection;
+  if (op == BoolOp::kUnion) {
+    region = Region::kUnion;
+  } else if (op == BoolOp::kDiff) {
+    region = window_first ? Region::kWindowOnly : Region::kSubjectOnly;
+  }
+
+  workspace.convex.set_window(window.m_sub_polygons.front());
+  workspace.convex.clip(polygon, region, sink);
 
-  VertexDist(Vertex *vert, float t) : vert(vert), t(t) {}
-};
+  PC_STATS(if (workspace.stats) {
+    workspace.stats->intersections += workspace.convex.crossing_count();
+  });
+}
 
-struct VertDistCompiler {
-  bool operator()(const VertexDist &v1, const VertexDist &v2) {
-    return v1.t < v2.t;
+template <typename T>
+template <typename S, typename C>
+void ClipAlgorithm<T>::run_op(BoolOp op, S &&subject, C &&clipping, Sink &sink,
+                              Workspace &workspace) {
+  // a convex ring is clipped against side by side, the other input is
+  // streamed through once instead of searching intersections. Inputs lying
+  // apart are left to the operations below, which may reuse their vertices.
+  if constexpr (std::is_same_v<std::decay_t<S>, Polygon> &&
+                std::is_same_v<std::decay_t<C>, Polygon>) {
+    if (bounds_overlap(subject, clipping)) {
+      if (is_convex_window(clipping)) {
+        return convex_op(op, subject, clipping, false, sink, workspace);
+      }
+      if (is_convex_window(subject)) {
+        return convex_op(op, clipping, subject, true, sink, workspace);
+      }
+    }
   }
-};
 
-void ClipAlgorithm::process_intersection() {
-  uint32_t intersection_count = 0;
+  switch (op) {
+  case BoolOp::kClip:
+    return clip_impl(std::forward<S>(subject), std::forward<C>(clipping), sink,
+                     workspace);
+  case BoolOp::kUnion:
+    return union_impl(std::forward<S>(subject), std::forward<C>(clipping),
+                      sink, workspace);
+  case BoolOp::kDiff:
+    return diff_impl(std::forward<S>(subject), std::forward<C>(clipping), sink,
+                     workspace);
+  }
+}
 
-  PolygonIter subj_iter(m_subject.get_vertices());
+template <typename T>
+BasicPolygon<T> ClipAlgorithm<T>::resolve_fill(const Polygon &polygon,
+                                               Workspace &workspace) {
+  PC_STATS(PhaseTimer timer(workspace.stats, &ClipStats::fill_ns));
 
-  while (subj_iter.has_next()) {
-    auto current = subj_iter.current();
+  FillResolver<T> resolver(polygon, *workspace.fill_rule);
 
-    PolygonIter clip_iter(m_clipping.get_vertices());
+  PC_STATS(if (workspace.stats) {
+    workspace.stats->self_intersections += resolver.split_count();
+  });
 
-    std::vector<VertexDist> intersect_list;
+  return resolver.resolve();
+}
 
-    while (clip_iter.has_next()) {
-      float t1 = 0.f;
-      float t2 = 0.f;
+template <typename T>
+BasicPolygon<T> ClipAlgorithm<T>::resolve_fill(const View &view,
+                                               Workspace &workspace) {
+  Polygon polygon;
+  polygon.append_vertices(view);
 
-      auto clip_curr = clip_iter.current();
+  return resolve_fill(polygon, workspace);
+}
 
-      if (Math::segment_intersect(current, current->next, clip_curr,
-                                  clip_curr->next, t1, t2)) {
-        intersection_count++;
+template <typename T>
+template <typename S, typename C>
+void ClipAlgorithm<T>::op_impl(BoolOp op, S &&subject, C &&clipping, Sink &sink,
+                               Workspace &workspace) {
+  PC_STATS(if (workspace.stats) { *workspace.stats = ClipStats(); });
 
-        auto i1 = m_subject.allocate_vertex(current, current->next, t1);
-        auto i2 = m_clipping.allocate_vertex(clip_curr, clip_curr->next, t2);
+  if (workspace.fill_rule) {
+    run_op(op, resolve_fill(subject, workspace),
+           resolve_fill(clipping, workspace), sink, workspace);
+  } else {
+    run_op(op, std::forward<S>(subject), std::forward<C>(clipping), sink,
+           workspace);
+  }
 
-        i1->intersect = true;
-        i2->intersect = true;
+  PC_STATS(collect_result(sink, workspace.stats));
+}
 
-        i1->neighbour = i2;
-        i2->neighbour = i1;
+template <typename T>
+template <typename S, typename C>
+BasicPolygon<T> ClipAlgorithm<T>::op_result(BoolOp op, S &&subject,
+                                            C &&clipping,
+                                            Workspace &workspace) {
+  auto result = take_result(workspace);
+  Sink sink(result, workspace.ring);
 
-        // insert i2 into cliping vertices list
-        i2->next = clip_curr->next;
-        clip_curr->next->prev = i2;
+  op_impl(op, std::forward<S>(subject), std::forward<C>(clipping), sink,
+          workspace);
 
-        clip_curr->next = i2;
-        i2->prev = clip_curr;
+  return result;
+}
 
-        // insert i1 into intersect list
-        intersect_list.emplace_back(VertexDist(i1, t1));
+template <typename T>
+BasicPolygon<T> ClipAlgorithm<T>::do_clip(const Polygon &subject,
+                                          const Polygon &clipping,
+                                          Degeneracy degeneracy,
+                                          ClipStats *stats) {
+  Workspace workspace;
+  workspace.degeneracy = degeneracy;
+  workspace.stats = stats;
 
-        clip_iter.move_next();
-      }
+  return op_result(BoolOp::kClip, subject, clipping, workspace);
+}
 
-      clip_iter.move_next();
-    }
+template <typename T>
+BasicPolygon<T> ClipAlgorithm<T>::do_clip(Polygon &&subject,
+                                          Polygon &&clipping,
+                                          Degeneracy degeneracy,
+                                          ClipStats *stats) {
+  Workspace workspace;
+  workspace.degeneracy = degeneracy;
+  workspace.stats = stats;
+
+  return op_result(BoolOp::kClip, std::move(subject), std::move(clipping),
+                   workspace);
+}
 
-    if (!intersect_list.empty()) {
+template <typename T>
+BasicPolygon<T> ClipAlgorithm<T>::do_union(const Polygon &subject,
+                                           const Polygon &clipping,
+                                           Degeneracy degeneracy,
+                                           ClipStats *stats) {
+  Workspace workspace;
+  workspace.degeneracy = degeneracy;
+  workspace.stats = stats;
 
-      std::sort(intersect_list.begin(), intersect_list.end(),
-                VertDistCompiler{});
+  return op_result(BoolOp::kUnion, subject, clipping, workspace);
+}
 
-      for (size_t i = 1; i < intersect_list.size(); i++) {
-        auto prev = intersect_list[i - 1];
-        auto next = intersect_list[i];
+template <typename T>
+BasicPolygon<T> ClipAlgorithm<T>::do_union(Polygon &&subject,
+                                           Polygon &&clipping,
+                                           Degeneracy degeneracy,
+                                           ClipStats *stats) {
+  Workspace workspace;
+  workspace.degeneracy = degeneracy;
+  workspace.stats = stats;
+
+  return op_result(BoolOp::kUnion, std::move(subject), std::move(clipping),
+                   workspace);
+}
 
-        prev.vert->next = next.vert;
-        next.vert->prev = prev.vert;
-      }
+template <typename T>
+BasicPolygon<T> ClipAlgorithm<T>::do_diff(const Polygon &subject,
+                                          const Polygon &clipping,
+                                          Degeneracy degeneracy,
+                                          ClipStats *stats) {
+  Workspace workspace;
+  workspace.degeneracy = degeneracy;
+  workspace.stats = stats;
+
+  return op_result(BoolOp::kDiff, subject, clipping, workspace);
+}
 
-      auto head = intersect_list.front().vert;
-      auto tail = intersect_list.back().vert;
+template <typename T>
+BasicPolygon<T> ClipAlgorithm<T>::do_diff(Polygon &&subject,
+                                          Polygon &&clipping,
+                                          Degeneracy degeneracy,
+                                          ClipStats *stats) {
+  Workspace workspace;
+  workspace.degeneracy = degeneracy;
+  workspace.stats = stats;
+
+  return op_result(BoolOp::kDiff, std::move(subject), std::move(clipping),
+                   workspace);
+}
 
-      tail->next = current->next;
-      current->next->prev = tail;
+template <typename T>
+BasicPolygon<T> ClipAlgorithm<T>::do_op(BoolOp op, const Polygon &subject,
+                                        const Polygon &clipping,
+                                        Workspace &workspace) {
+  return op_result(op, subject, clipping, workspace);
+}
 
-      current->next = head;
-      head->prev = current;
+template <typename T>
+BasicPolygon<T> ClipAlgorithm<T>::do_op(BoolOp op, const View &subject,
+                                        const View &clipping,
+                                        Workspace &workspace) {
+  check_coordinates(subject);
+  check_coordinates(clipping);
 
-      for (size_t i = 0; i < intersect_list.size(); i++) {
-        subj_iter.move_next();
-      }
-    }
+  return op_result(op, subject, clipping, workspace);
+}
 
-    subj_iter.move_next();
-  }
+template <typename T>
+void ClipAlgorithm<T>::do_op(BoolOp op, const Polygon &subject,
+                             const Polygon &clipping, Buffer &result,
+                             Workspace &workspace) {
+  result.clear();
+  Sink sink(result);
 
-  assert((intersection_count % 2) == 0);
+  op_impl(op, subject, clipping, sink, workspace);
 }
 
-std::tuple<bool, uint32_t> ClipAlgorithm::mark_vertices() {
-  bool no_intersection = true;
-  uint32_t inner_indicator = 0;
+template <typename T>
+void ClipAlgorithm<T>::do_op(BoolOp op, const View &subject,
+                             const View &clipping, Buffer &result,
+                             Workspace &workspace) {
+  check_coordinates(subject);
+  check_coordinates(clipping);
+
+  result.clear();
+  Sink sink(result);
 
-  // loop for polygon 1
+  op_impl(op, subject, clipping, sink, workspace);
+}
 
-  // false  : exit
-  // true   : entry
-  bool status = false;
+template <typename T> void ClipAlgorithm<T>::process_intersection() {
+  PC_STATS(PhaseTimer timer(m_stats, &ClipStats::intersection_ns));
 
-  PolygonIter clip_iter(m_clipping.get_vertices());
+  SweepLine<T> sweep_line(m_subject, m_clipping, m_degeneracy,
+                          m_subject_index.get(), m_clipping_index.get(),
+                          &m_workspace.sweep);
 
-  if (m_subject.contains(clip_iter.current()->point)) {
-    status = false;
-    inner_indicator = 1;
+  auto &intersections = m_workspace.intersections;
+  if (m_pool) {
+    intersections = sweep_line.find_intersections(*m_pool);
   } else {
-    status = true;
-    inner_indicator = 0;
+    sweep_line.find_intersections(intersections);
   }
 
-  while (clip_iter.has_next()) {
-    auto current = clip_iter.current();
+  PC_STATS(if (m_stats) {
+    m_stats->pair_tests += sweep_line.pair_tests();
+    m_stats->bytes_allocated +=
+        sweep_line.memory_size() +
+        intersections.capacity() * sizeof(EdgeIntersection<T>) +
+        2 * intersections.size() * sizeof(uint32_t);
+  });
 
-    if (current->intersect) {
-      current->entry_exit = status;
-      status = !status;
+  // keep the allocation order of a subject-major edge loop, the result walk
+  // starts from intersection points in this order
+  std::sort(
+      intersections.begin(), intersections.end(),
+      [](const EdgeIntersection<T> &e1, const EdgeIntersection<T> &e2) {
+        return e1.subject_edge < e2.subject_edge ||
+               (e1.subject_edge == e2.subject_edge &&
+                e1.clipping_edge < e2.clipping_edge);
+      });
 
-      if (no_intersection) {
-        no_intersection = false;
-      }
+  m_subject.reserve(m_subject.vertex_count() + intersections.size());
+  m_clipping.reserve(m_clipping.vertex_count() + intersections.size());
+
+  auto &clipping_points = m_workspace.clipping_points;
+  clipping_points.resize(intersections.size());
+
+  auto &intersect_list = m_workspace.intersect_list;
+  intersect_list.clear();
+
+  for (size_t i = 0; i < intersections.size(); i++) {
+    const auto &e = intersections[i];
+
+    // edges are not spliced yet, next is still the end of the input edge
+    auto current = e.subject_edge;
+    auto clip_curr = e.clipping_edge;
+
+    auto i1 =
+        m_subject.allocate_vertex(current, m_subject.next[current], e.t1);
+    auto i2 = m_clipping.allocate_vertex(clip_curr,
+                                         m_clipping.next[clip_curr], e.t2);
+
+    m_subject.set_flag(i1, kVertexIntersect, true);
+    m_clipping.set_flag(i2, kVertexIntersect, true);
+
+    m_subject.neighbour[i1] = i2;
+    m_clipping.neighbour[i2] = i1;
+
+    clipping_points[i] = i2;
+
+    intersect_list.emplace_back(VertexDist<T>(i1, e.t1, e.t1_order));
+
+    m_intersect_count++;
+
+    // insert i1 list into subject edge
+    if (i + 1 == intersections.size() ||
+        intersections[i + 1].subject_edge != e.subject_edge) {
+      m_subject.insert_intersections(current, intersect_list);
+      intersect_list.clear();
     }
+  }
 
-    clip_iter.move_next();
+  // insert i2 lists into clipping edges
+  auto &clipping_order = m_workspace.clipping_order;
+  clipping_order.resize(intersections.size());
+  for (size_t i = 0; i < clipping_order.size(); i++) {
+    clipping_order[i] = static_cast<uint32_t>(i);
   }
 
-  // loop for polygon 2
-  PolygonIter subj_iter(m_subject.get_vertices());
+  std::sort(clipping_order.begin(), clipping_order.end(),
+            [&intersections](uint32_t i1, uint32_t i2) {
+              return intersections[i1].clipping_edge <
+                     intersections[i2].clipping_edge;
+            });
 
-  if (m_clipping.contains(subj_iter.current()->point)) {
-    status = false;
-    inner_indicator = 2;
-  } else {
-    status = true;
+  for (size_t i = 0; i < clipping_order.size(); i++) {
+    const auto &e = intersections[clipping_order[i]];
+
+    intersect_list.emplace_back(
+        VertexDist<T>(clipping_points[clipping_order[i]], e.t2, e.t2_order));
+
+    if (i + 1 == clipping_order.size() ||
+        intersections[clipping_order[i + 1]].clipping_edge !=
+            e.clipping_edge) {
+      m_clipping.insert_intersections(e.clipping_edge, intersect_list);
+      intersect_list.clear();
+    }
   }
 
-  while (subj_iter.has_next()) {
-    auto current = subj_iter.current();
+  assert((m_intersect_count % 2) == 0);
+}
+
+/**
+ * Alternate entry and exit state along every ring of polygon, a ring starting
+ * inside the other polygon first leaves it
+ *
+ * @inside  whether a point is inside the other polygon
+ *
+ * @return true if any ring has an intersection
+ */
+template <typename T, typename F>
+static bool mark_polygon(FlatPolygon<T> &polygon, std::vector<RingMark> &rings,
+                         F &&inside) {
+  bool crossed = false;
+
+  rings.assign(polygon.ring_count(), RingMark());
 
-    if (current->intersect) {
-      current->entry_exit = status;
-      status = !status;
+  for (size_t r = 0; r < polygon.ring_count(); r++) {
+    auto head = polygon.ring_offsets[r];
+    auto current = head;
 
-      if (no_intersection) {
-        no_intersection = false;
+    rings[r].inside = inside(polygon.ring_bounds[r], polygon.point(head));
+
+    // false  : exit
+    // true   : entry
+    bool status = !rings[r].inside;
+
+    do {
+      if (polygon.has_flag(current, kVertexIntersect)) {
+        polygon.set_flag(current, kVertexEntryExit, status);
+        status = !status;
+
+        rings[r].crossed = true;
       }
+
+      current = polygon.next[current];
+    } while (current != head);
+
+    crossed = crossed || rings[r].crossed;
+  }
+
+  return crossed;
+}
+
+template <typename T> bool ClipAlgorithm<T>::mark_vertices() {
+  PC_STATS(PhaseTimer timer(m_stats, &ClipStats::mark_ns));
+
+  // with the symbolic offset the clipping polygon is moved by +(e, e^2), so
+  // boundary points are always decided the same way as the edge crossings
+  bool symbolic = m_degeneracy == Degeneracy::kSymbolic;
+
+  // an index only describes its polygon while no vertex was perturbed, rings
+  // outside the bounds of the polygon are never inside it
+  auto inside = [symbolic](const FlatPolygon<T> &polygon,
+                           const EdgeIndex<T> *index, const BasicRect<T> &ring,
+                           const Point &p, int shift) {
+    if (!polygon.bounds || !polygon.bounds->overlaps(ring)) {
+      return false;
+    }
+
+    if (index && polygon.perturbations == 0) {
+      return symbolic ? polygon.contains(p, shift, *index)
+                      : polygon.contains(p, *index);
+    }
+
+    return symbolic ? polygon.contains(p, shift) : polygon.contains(p);
+  };
+
+  bool crossed = mark_polygon(
+      m_clipping, m_clipping_rings,
+      [this, &inside](const BasicRect<T> &ring, const Point &p) {
+        return inside(m_subject, m_subject_index.get(), ring, p, 1);
+      });
+
+  crossed = mark_polygon(
+                m_subject, m_subject_rings,
+                [this, &inside](const BasicRect<T> &ring, const Point &p) {
+                  return inside(m_clipping, m_clipping_index.get(), ring, p,
+                                -1);
+                }) ||
+            crossed;
+
+  return !crossed;
+}
+
+template <typename T>
+size_t ClipAlgorithm<T>::count_untouched(const std::vector<RingMark> &rings,
+                                         bool inside) {
+  return static_cast<size_t>(
+      std::count_if(rings.begin(), rings.end(), [inside](const RingMark &r) {
+        return !r.crossed && r.inside == inside;
+      }));
+}
+
+template <typename T>
+void ClipAlgorithm<T>::append_untouched(Sink &sink, const Polygon &input,
+                                        const std::vector<RingMark> &rings,
+                                        bool inside, bool reverse) {
+  for (size_t r = 0; r < rings.size(); r++) {
+    if (!rings[r].crossed && rings[r].inside == inside) {
+      sink.add_ring(input, r, reverse);
     }
+  }
+}
 
-    subj_iter.move_next();
+template <typename T>
+void ClipAlgorithm<T>::append_untouched(Sink &sink, const View &input,
+                                        const std::vector<RingMark> &rings,
+                                        bool inside, bool reverse) {
+  // rings holds no entry for the skipped rings of input
+  size_t r = 0;
+  for (size_t i = 0; i < input.ring_count; i++) {
+    if (input.ring_size(i) < 3) {
+      continue;
+    }
+    if (!rings[r].crossed && rings[r].inside == inside) {
+      sink.add_ring(input, i, reverse);
+    }
+    r++;
   }
+}
 
-  return std::make_tuple(no_intersection, inner_indicator);
+template <typename T> void ClipAlgorithm<T>::collect_stats() const {
+  if (!m_stats) {
+    return;
+  }
+
+  m_stats->intersections += m_intersect_count;
+  m_stats->perturbations += m_subject.perturbations + m_clipping.perturbations;
+  m_stats->vertices_allocated +=
+      m_subject.vertex_count() + m_clipping.vertex_count();
+
+  // memory kept by the workspace from earlier operations is not new
+  size_t bytes = m_subject.memory_size() + m_clipping.memory_size();
+  if (bytes > m_start_bytes) {
+    m_stats->bytes_allocated += bytes - m_start_bytes;
+  }
 }
 
+template <typename T>
+void ClipAlgorithm<T>::collect_result(const Sink &sink, ClipStats *stats) {
+  if (!stats) {
+    return;
+  }
+
+  stats->vertices_allocated += sink.vertex_count();
+  stats->bytes_allocated += sink.memory_size();
+}
+
+template bool scalar_is_zero(float t);
+template bool scalar_is_zero(double t);
+template bool scalar_is_zero(int32_t t);
+
+template void check_coordinates(const PolygonView &view);
+template void check_coordinates(const PolygonViewD &view);
+template void check_coordinates(const PolygonViewI &view);
+
+template Point operator-(const Point &p1, const Point &p2);
+template PointD operator-(const PointD &p1, const PointD &p2);
+template PointI operator-(const PointI &p1, const PointI &p2);
+template Point operator+(const Point &p1, const Point &p2);
+template PointD operator+(const PointD &p1, const PointD &p2);
+template PointI operator+(const PointI &p1, const PointI &p2);
+template Point operator*(const Point &p, float f);
+template PointD operator*(const PointD &p, double f);
+template PointI operator*(const PointI &p, int32_t f);
+template bool operator<(const Point &p1, const Point &p2);
+template bool operator<(const PointD &p1, const PointD &p2);
+template bool operator<(const PointI &p1, const PointI &p2);
+template bool operator==(const Point &p1, const Point &p2);
+template bool operator==(const PointD &p1, const PointD &p2);
+template bool operator==(const PointI &p1, const PointI &p2);
+
+template class PolygonIter<float>;
+template class PolygonIter<double>;
+template class PolygonIter<int32_t>;
+
+template class ClipAlgorithm<float>;
+template class ClipAlgorithm<double>;
+template class ClipAlgorithm<int32_t>;
+
 } // namespace pc
@@ -1,25 +1,45 @@
 #pragma once
 
 #include "polygon_clip.hpp"
+#include "polygon_clip_convex.hpp"
+#include "polygon_clip_flat.hpp"
+#include "polygon_clip_scalar.hpp"
+#include "polygon_clip_sink.hpp"
+#include "polygon_clip_stats.hpp"
+#include "polygon_clip_sweep.hpp"
 
-#include <tuple>
+#include <vector>
 
 namespace pc {
 
-Point operator-(const Point &p1, const Point &p2);
+class ThreadPool;
 
-Point operator+(const Point &p1, const Point &p2);
+template <typename T>
+BasicPoint<T> operator-(const BasicPoint<T> &p1, const BasicPoint<T> &p2);
 
-Point operator*(const Point &p, Scalar f);
+template <typename T>
+BasicPoint<T> operator+(const BasicPoint<T> &p1, const BasicPoint<T> &p2);
 
-bool operator<(const Point &p1, const Point &p2);
+template <typename T> BasicPoint<T> operator*(const BasicPoint<T> &p, T f);
 
-bool operator==(const Point &p1, const Point &p2);
+template <typename T>
+bool operator<(const BasicPoint<T> &p1, const BasicPoint<T> &p2);
 
-bool scalar_is_zero(float t);
+template <typename T>
+bool operator==(const BasicPoint<T> &p1, const BasicPoint<T> &p2);
 
-class PolygonIter {
+template <typename T> bool scalar_is_zero(T t);
+
+/**
+ * check_coordinate on every vertex of view
+ */
+template <typename T>
+void check_coordinates(const BasicPolygonView<T> &view);
+
+template <typename T> class PolygonIter {
 public:
+  using Vertex = BasicVertex<T>;
+
   PolygonIter(const std::vector<Vertex *> &polygons);
   ~PolygonIter() = default;
 
@@ -33,11 +53,65 @@ private:
   size_t m_index;
   Vertex *m_curr_head;
   Vertex *m_current;
-  bool m_loop_end = false;
   const std::vector<Vertex *> &m_polygon;
 };
 
-class ClipAlgorithm {
+/**
+ * State of one input ring once the vertices are marked
+ */
+struct RingMark {
+  // the boundary of the other polygon crosses the ring
+  bool crossed = false;
+  // the first vertex of the ring is inside the other polygon
+  bool inside = false;
+};
+
+/**
+ * Working memory of ClipAlgorithm.
+ *
+ * Callers running many operations in a row keep one workspace, so the flat
+ * working copies, the scratch lists of the intersection search and the walk,
+ * and the vertices of result reuse the memory of earlier operations.
+ */
+template <typename T> struct ClipWorkspace {
+  FlatPolygon<T> subject = {};
+  FlatPolygon<T> clipping = {};
+  // if set, the intersection search of large inputs is split across its
+  // workers and degeneracies are resolved symbolically whatever degeneracy
+  // says, the bands can only be swept apart while no vertex moves
+  ThreadPool *pool = nullptr;
+  Degeneracy degeneracy = Degeneracy::kPerturb;
+  // if set, both inputs are rebuilt by FillResolver under this rule first
+  std::optional<FillRule> fill_rule = {};
+  // if set, reset and filled by every operation run with this workspace
+  ClipStats *stats = nullptr;
+
+  typename SweepLine<T>::Buffers sweep = {};
+  std::vector<EdgeIntersection<T>> intersections = {};
+  // intersection vertex on the clipping side of each intersection
+  std::vector<uint32_t> clipping_points = {};
+  std::vector<uint32_t> clipping_order = {};
+  std::vector<VertexDist<T>> intersect_list = {};
+  // one entry per ring of each input, same order
+  std::vector<RingMark> subject_rings = {};
+  std::vector<RingMark> clipping_rings = {};
+  // points of the output ring being walked
+  std::vector<BasicPoint<T>> ring = {};
+  // operations with a single convex ring on either side run here
+  ConvexClipper<T> convex = {};
+  // emptied and handed out as the storage of the next result, callers may
+  // put a result they no longer need back here
+  BasicPolygon<T> result = {};
+};
+
+template <typename T> class ClipAlgorithm {
+  using Point = BasicPoint<T>;
+  using Polygon = BasicPolygon<T>;
+  using View = BasicPolygonView<T>;
+  using Buffer = BasicPolygonBuffer<T>;
+  using Sink = ResultSink<T>;
+  using Workspace = ClipWorkspace<T>;
+
   enum class MarkType {
     kIntersection,
     kUnion,
@@ -47,60 +121,263 @@ class ClipAlgorithm {
 public:
   /**
    * Calculate the intersect area.
-   * The subject and clipping are copyied during claculation to make sure the
-   * origin data not changed
+   * The subject and clipping are converted into FlatPolygon working copies
+   * during calculation, the origin data is not changed
    *
-   * @subject  copy of the subject polygon
-   * @clipping copy of the clipping polygon
+   * @subject     the subject polygon
+   * @clipping    the clipping polygon
+   * @degeneracy  how vertices on the other boundary are handled
+   * @stats       if set, filled with the counters of this operation
    *
    * @return   intersect polygon
    */
-  static Polygon do_clip(Polygon subject, Polygon clipping);
+  static Polygon do_clip(const Polygon &subject, const Polygon &clipping,
+                         Degeneracy degeneracy = Degeneracy::kPerturb,
+                         ClipStats *stats = nullptr);
 
   /**
    * Calculate the union area between two polygons
    *
-   * @subject copy of the first polygon
-   * @clipping copy of the second polygon
+   * @subject the first polygon
+   * @clipping the second polygon
    *
    * @return union result
    */
-  static Polygon do_union(Polygon subject, Polygon clipping);
+  static Polygon do_union(const Polygon &subject, const Polygon &clipping,
+                          Degeneracy degeneracy = Degeneracy::kPerturb,
+                          ClipStats *stats = nullptr);
 
   /**
    * Calculate the different part which is inside subject but not in clipping
    *
-   * @subject   Copy of the subject polygon
-   * @clipping  Copy of the clipping polygon
+   * @subject   the subject polygon
+   * @clipping  the clipping polygon
    *
    * @return difference result
    */
-  static Polygon do_diff(Polygon subject, Polygon clipping);
+  static Polygon do_diff(const Polygon &subject, const Polygon &clipping,
+                         Degeneracy degeneracy = Degeneracy::kPerturb,
+                         ClipStats *stats = nullptr);
+
+  /**
+   * Same as above, but the inputs are consumed. When there is no intersection
+   * the result takes over the input vertices instead of copying them.
+   */
+  static Polygon do_clip(Polygon &&subject, Polygon &&clipping,
+                         Degeneracy degeneracy = Degeneracy::kPerturb,
+                         ClipStats *stats = nullptr);
+
+  static Polygon do_union(Polygon &&subject, Polygon &&clipping,
+                          Degeneracy degeneracy = Degeneracy::kPerturb,
+                          ClipStats *stats = nullptr);
+
+  static Polygon do_diff(Polygon &&subject, Polygon &&clipping,
+                         Degeneracy degeneracy = Degeneracy::kPerturb,
+                         ClipStats *stats = nullptr);
+
+  /**
+   * Run op with the working copies placed in workspace
+   */
+  static Polygon do_op(BoolOp op, const Polygon &subject,
+                       const Polygon &clipping, Workspace &workspace);
+
+  /**
+   * Same with the working copies filled straight from the views
+   */
+  static Polygon do_op(BoolOp op, const View &subject, const View &clipping,
+                       Workspace &workspace);
+
+  /**
+   * Run op and write the rings of the result straight into result, which is
+   * cleared first
+   */
+  static void do_op(BoolOp op, const Polygon &subject, const Polygon &clipping,
+                    Buffer &result, Workspace &workspace);
+
+  static void do_op(BoolOp op, const View &subject, const View &clipping,
+                    Buffer &result, Workspace &workspace);
 
 private:
-  ClipAlgorithm(Polygon subject, Polygon clipping)
-      : m_subject(std::move(subject)), m_clipping(std::move(clipping)) {}
-  ~ClipAlgorithm() = default;
+  /**
+   * Reset the stats of workspace, run op into sink and count the result
+   */
+  template <typename S, typename C>
+  static void op_impl(BoolOp op, S &&subject, C &&clipping, Sink &sink,
+                      Workspace &workspace);
+
+  /**
+   * Run op into a polygon holding the memory of workspace.result
+   */
+  template <typename S, typename C>
+  static Polygon op_result(BoolOp op, S &&subject, C &&clipping,
+                           Workspace &workspace);
+
+  /**
+   * Run op on inputs which are already simple
+   */
+  template <typename S, typename C>
+  static void run_op(BoolOp op, S &&subject, C &&clipping, Sink &sink,
+                     Workspace &workspace);
+
+  /**
+   * Rebuild polygon into simple rings under the fill rule of workspace
+   */
+  static Polygon resolve_fill(const Polygon &polygon, Workspace &workspace);
+
+  /**
+   * Same for a view, which is copied into a polygon first
+   */
+  static Polygon resolve_fill(const View &view, Workspace &workspace);
+
+  /**
+   * Empty polygon holding the memory of workspace.result
+   */
+  static Polygon take_result(Workspace &workspace);
+
+  /**
+   * Result made of input alone, taken over if input is an rvalue and sink
+   * writes into a polygon, copied otherwise
+   */
+  template <typename P> static void forward_input(P &&input, Sink &sink);
+
+  /**
+   * Result made of the rings of subject followed by those of clipping, which
+   * are reversed if reverse is set
+   */
+  template <typename S, typename C>
+  static void forward_inputs(S &&subject, C &&clipping, bool reverse,
+                             Sink &sink);
+
+  /**
+   * Copy all rings of input to sink, reversed if reverse is set
+   */
+  static void append_input(Sink &sink, const Polygon &input, bool reverse);
+
+  static void append_input(Sink &sink, const View &input, bool reverse);
+
+  /**
+   * Edge index cached by a polygon or carried by a view, may be null
+   */
+  static std::shared_ptr<const EdgeIndex<T>> input_index(const Polygon &input) {
+    return input.m_index;
+  }
+
+  static std::shared_ptr<const EdgeIndex<T>> input_index(const View &input) {
+    return input.index;
+  }
+
+  /**
+   * Whether polygon is a single convex ring with at most
+   * kMaxConvexWindowSides sides, which ConvexClipper takes as window
+   */
+  static bool is_convex_window(const Polygon &polygon);
+
+  /**
+   * Run op through ConvexClipper with the single ring of window
+   *
+   * @window_first  window is the subject of op and polygon the clipping
+   */
+  static void convex_op(BoolOp op, const Polygon &polygon,
+                        const Polygon &window, bool window_first, Sink &sink,
+                        Workspace &workspace);
+
+  template <typename S, typename C>
+  static void clip_impl(S &&subject, C &&clipping, Sink &sink,
+                        Workspace &workspace);
+
+  template <typename S, typename C>
+  static void union_impl(S &&subject, C &&clipping, Sink &sink,
+                         Workspace &workspace);
+
+  template <typename S, typename C>
+  static void diff_impl(S &&subject, C &&clipping, Sink &sink,
+                        Workspace &workspace);
+
+  template <typename S, typename C>
+  ClipAlgorithm(const S &subject, const C &clipping, Workspace &workspace)
+      : m_subject(workspace.subject), m_clipping(workspace.clipping),
+        m_pool(workspace.pool),
+        m_degeneracy(ScalarTraits<T>::kExact || workspace.pool
+                         ? Degeneracy::kSymbolic
+                         : workspace.degeneracy),
+        m_stats(workspace.stats), m_subject_index(input_index(subject)),
+        m_clipping_index(input_index(clipping)), m_workspace(workspace),
+        m_subject_rings(workspace.subject_rings),
+        m_clipping_rings(workspace.clipping_rings) {
+    PC_STATS(PhaseTimer timer(m_stats, &ClipStats::setup_ns));
+    PC_STATS(m_start_bytes = m_subject.memory_size() +
+                             m_clipping.memory_size());
+
+    m_subject.assign(subject);
+    m_clipping.assign(clipping);
+  }
+  ~ClipAlgorithm() { PC_STATS(collect_stats()); }
+
+  ClipAlgorithm(const ClipAlgorithm &) = delete;
+  ClipAlgorithm &operator=(const ClipAlgorithm &) = delete;
 
   void process_intersection();
 
   /**
-   * Mark polygon intersectons
+   * Mark the intersection vertices of every ring as entry or exit, starting
+   * from whether the first vertex of the ring is inside the other polygon,
+   * and fill m_subject_rings and m_clipping_rings
    *
-   * {
-   *   no_intersection: true if there is no intersection points
-   *   inner_indicator: 1 means clipping inside subject, 2 means subject
-   *                        inside clipping
-   * }
-   * @return std::tuple<bool, uint32_t> { no_intersection, inner_indicator }
+   * @return true if there is no intersection point
+   */
+  bool mark_vertices();
+
+  /**
+   * Number of rings no intersection touches whose first vertex is inside the
+   * other polygon if inside is set, outside otherwise
+   */
+  static size_t count_untouched(const std::vector<RingMark> &rings,
+                                bool inside);
+
+  /**
+   * Copy the rings of input counted by count_untouched into sink
+   */
+  static void append_untouched(Sink &sink, const Polygon &input,
+                               const std::vector<RingMark> &rings,
+                               bool inside, bool reverse);
+
+  static void append_untouched(Sink &sink, const View &input,
+                               const std::vector<RingMark> &rings,
+                               bool inside, bool reverse);
+
+  /**
+   * Add the counters of the working copies to m_stats
    */
-  std::tuple<bool, uint32_t> mark_vertices();
+  void collect_stats() const;
+
+  /**
+   * Add the vertices and memory held by the result of sink to stats
+   */
+  static void collect_result(const Sink &sink, ClipStats *stats);
 
 private:
-  Polygon m_subject;
-  Polygon m_clipping;
+  FlatPolygon<T> &m_subject;
+  FlatPolygon<T> &m_clipping;
+  ThreadPool *m_pool;
+  Degeneracy m_degeneracy;
+  ClipStats *m_stats;
+  // cached by the input polygons, may be null
+  std::shared_ptr<const EdgeIndex<T>> m_subject_index;
+  std::shared_ptr<const EdgeIndex<T>> m_clipping_index;
+
+  // scratch lists live in the workspace
+  Workspace &m_workspace;
+  // one entry per ring of each input, same order
+  std::vector<RingMark> &m_subject_rings;
+  std::vector<RingMark> &m_clipping_rings;
 
   uint32_t m_intersect_count = 0;
+  // memory the workspace already held before this operation
+  size_t m_start_bytes = 0;
 };
 
+extern template class ClipAlgorithm<float>;
+extern template class ClipAlgorithm<double>;
+extern template class ClipAlgorithm<int32_t>;
+
 } // namespace pc
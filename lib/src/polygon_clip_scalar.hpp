@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+
+namespace pc {
+
+/**
+ * Properties of each coordinate type.
+ *
+ * Floating point coordinates are compared with kNearZero and moved by
+ * kPerturbation under Degeneracy::kPerturb. Integer coordinates are exact:
+ * every predicate is decided with 64-bit cross products, degeneracies are
+ * always resolved symbolically and intersection points are rounded to the
+ * nearest grid point.
+ */
+template <typename T> struct ScalarTraits;
+
+template <> struct ScalarTraits<float> {
+  static constexpr bool kExact = false;
+  // parametric position along an edge
+  using Param = float;
+  // cross products and coordinate differences below are treated as zero
+  static constexpr float kNearZero = 1.f / (1 << 12);
+  // a vertex needing perturbation is moved along its edge by this factor
+  static constexpr float kPerturbation = 1.001f;
+};
+
+template <> struct ScalarTraits<double> {
+  static constexpr bool kExact = false;
+  using Param = double;
+  // the float bound scaled down by the 29 extra bits of mantissa
+  static constexpr double kNearZero = 1.0 / (1ll << 41);
+  static constexpr double kPerturbation = 1.0 + 1.0 / (1 << 20);
+};
+
+template <> struct ScalarTraits<int32_t> {
+  static constexpr bool kExact = true;
+  using Param = double;
+  static constexpr int32_t kNearZero = 0;
+  // coordinates within this magnitude keep every cross product in int64
+  static constexpr int32_t kMaxCoordinate = 1 << 30;
+};
+
+template <typename T> using EdgeParam = typename ScalarTraits<T>::Param;
+
+/**
+ * Throws std::out_of_range for an integer coordinate outside
+ * ±kMaxCoordinate, whose cross products would overflow. Floating point
+ * coordinates are not checked.
+ */
+template <typename T> void check_coordinate(T value) {
+  if constexpr (ScalarTraits<T>::kExact) {
+    if (value < -ScalarTraits<T>::kMaxCoordinate ||
+        value > ScalarTraits<T>::kMaxCoordinate) {
+      throw std::out_of_range("pc: integer coordinate outside [-2^30, 2^30]");
+    }
+  }
+}
+
+} // namespace pc
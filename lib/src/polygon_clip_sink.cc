@@ -0,0 +1,107 @@
+#include "polygon_clip_sink.hpp"
+
+#include <utility>
+
+namespace pc {
+
+template <typename T> void ResultSink<T>::close_ring() {
+  if (m_polygon) {
+    m_polygon->append_vertices(*m_ring);
+    m_ring->clear();
+    return;
+  }
+
+  auto begin = m_buffer->ring_offsets.back();
+  auto end = static_cast<uint32_t>(m_buffer->coords.size() / 2);
+
+  if (end - begin < 3) {
+    m_buffer->coords.resize(2 * static_cast<size_t>(begin));
+  } else {
+    m_buffer->ring_offsets.emplace_back(end);
+  }
+}
+
+template <typename T>
+void ResultSink<T>::add_ring(const std::vector<Point> &points) {
+  if (m_polygon) {
+    m_polygon->append_vertices(points);
+    return;
+  }
+
+  for (const auto &p : points) {
+    add_point(p);
+  }
+  close_ring();
+}
+
+template <typename T>
+void ResultSink<T>::add_ring(const Polygon &polygon, size_t ring,
+                             bool reverse) {
+  if (m_polygon) {
+    m_polygon->append_ring(polygon, ring, reverse);
+    return;
+  }
+
+  auto head = polygon.m_sub_polygons[ring];
+  auto v = head;
+  do {
+    add_point(v->point);
+    v = reverse ? v->prev : v->next;
+  } while (v != head);
+
+  close_ring();
+}
+
+template <typename T>
+void ResultSink<T>::add_ring(const View &view, size_t ring, bool reverse) {
+  if (m_polygon) {
+    m_polygon->append_ring(view, ring, reverse);
+    return;
+  }
+
+  size_t begin = view.ring_offsets[ring];
+  size_t n = view.ring_size(ring);
+
+  for (size_t k = 0; k < n; k++) {
+    add_point(view.point(begin + (reverse && k > 0 ? n - k : k)));
+  }
+
+  close_ring();
+}
+
+template <typename T> void ResultSink<T>::take(Polygon &&polygon) {
+  if (m_polygon) {
+    *m_polygon = std::move(polygon);
+    return;
+  }
+
+  for (size_t r = 0; r < polygon.m_sub_polygons.size(); r++) {
+    add_ring(polygon, r, false);
+  }
+}
+
+template <typename T> size_t ResultSink<T>::vertex_count() const {
+  if (m_polygon) {
+    return m_polygon->m_vertex.size();
+  }
+
+  return m_buffer->vertex_count();
+}
+
+template <typename T> size_t ResultSink<T>::memory_size() const {
+  if (m_polygon) {
+    return m_polygon->m_vertex.capacity() * sizeof(BasicVertex<T>) +
+           m_polygon->m_sub_polygons.capacity() * sizeof(BasicVertex<T> *) +
+           m_polygon->m_sub_bounds.capacity() * sizeof(BasicRect<T>) +
+           m_polygon->m_sub_shapes.capacity() * sizeof(RingShape);
+  }
+
+  return m_buffer->coords.capacity() * sizeof(T) +
+         m_buffer->ring_offsets.capacity() * sizeof(uint32_t);
+}
+
+template class ResultSink<float>;
+template class ResultSink<double>;
+template class ResultSink<int32_t>;
+
+} // namespace pc
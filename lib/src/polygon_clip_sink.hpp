@@ -0,0 +1,87 @@
+#pragma once
+
+#include "polygon_clip.hpp"
+
+#include <vector>
+
+namespace pc {
+
+/**
+ * Destination of the rings of a result, a polygon or a flat buffer.
+ *
+ * The result walks stream their points in with add_point and end each ring
+ * with close_ring. A buffer takes the points directly, a polygon collects the
+ * points of a ring first and then appends it, since its rings are lists.
+ */
+template <typename T> class ResultSink {
+public:
+  using Point = BasicPoint<T>;
+  using Polygon = BasicPolygon<T>;
+  using View = BasicPolygonView<T>;
+  using Buffer = BasicPolygonBuffer<T>;
+
+  /**
+   * Write into polygon, the points of the open ring are kept in ring
+   */
+  ResultSink(Polygon &polygon, std::vector<Point> &ring)
+      : m_polygon(&polygon), m_ring(&ring) {
+    m_ring->clear();
+  }
+
+  explicit ResultSink(Buffer &buffer) : m_buffer(&buffer) {}
+
+  /**
+   * The polygon written into, null for a buffer
+   */
+  Polygon *polygon() const { return m_polygon; }
+
+  void add_point(const Point &p) {
+    if (m_buffer) {
+      m_buffer->coords.emplace_back(p.x);
+      m_buffer->coords.emplace_back(p.y);
+    } else {
+      m_ring->emplace_back(p);
+    }
+  }
+
+  /**
+   * End the ring of the points added since the last call, a ring of fewer
+   * than three points is dropped
+   */
+  void close_ring();
+
+  /**
+   * Append a whole ring, dropped as above
+   */
+  void add_ring(const std::vector<Point> &points);
+
+  /**
+   * Copy ring of polygon or view, backwards if reverse is set
+   */
+  void add_ring(const Polygon &polygon, size_t ring, bool reverse);
+
+  void add_ring(const View &view, size_t ring, bool reverse);
+
+  /**
+   * Make polygon the whole result, nothing may have been written before
+   */
+  void take(Polygon &&polygon);
+
+  size_t vertex_count() const;
+
+  /**
+   * Bytes reserved by the result
+   */
+  size_t memory_size() const;
+
+private:
+  Polygon *m_polygon = nullptr;
+  std::vector<Point> *m_ring = nullptr;
+  Buffer *m_buffer = nullptr;
+};
+
+extern template class ResultSink<float>;
+extern template class ResultSink<double>;
+extern template class ResultSink<int32_t>;
+
+} // namespace pc
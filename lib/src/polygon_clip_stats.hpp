@@ -0,0 +1,51 @@
+#pragma once
+
+#include "polygon_clip.hpp"
+
+#include <chrono>
+#include <cstdint>
+
+// statements only compiled when ClipStats are collected
+#ifdef PC_ENABLE_STATS
+#define PC_STATS(...) __VA_ARGS__
+#else
+#define PC_STATS(...)
+#endif
+
+namespace pc {
+
+/**
+ * Add the wall time between construction and destruction to one phase of
+ * stats, nothing is measured if stats is null
+ */
+class PhaseTimer {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  PhaseTimer(ClipStats *stats, uint64_t ClipStats::*phase)
+      : m_stats(stats), m_phase(phase) {
+    if (m_stats) {
+      m_start = Clock::now();
+    }
+  }
+
+  ~PhaseTimer() {
+    if (m_stats) {
+      auto elapsed = Clock::now() - m_start;
+
+      m_stats->*m_phase += static_cast<uint64_t>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+              .count());
+    }
+  }
+
+  PhaseTimer(const PhaseTimer &) = delete;
+  PhaseTimer &operator=(const PhaseTimer &) = delete;
+
+private:
+  ClipStats *m_stats;
+  uint64_t ClipStats::*m_phase;
+  Clock::time_point m_start = {};
+};
+
+} // namespace pc
@@ -0,0 +1,439 @@
+#include "polygon_clip_sweep.hpp"
+#include "polygon_clip_flat.hpp"
+#include "polygon_clip_index.hpp"
+#include "polygon_clip_math.hpp"
+#include "polygon_clip_stats.hpp"
+#include "polygon_clip_thread_pool.hpp"
+
+#include <algorithm>
+
+namespace pc {
+
+// below this many edges a single threaded sweep is faster
+constexpr size_t kParallelSweepEdges = 4096;
+
+constexpr uint32_t kBandsPerWorker = 4;
+
+template <typename T>
+SweepLine<T>::SweepLine(FlatPolygon<T> &subject, FlatPolygon<T> &clipping,
+                        Degeneracy degeneracy,
+                        const EdgeIndex<T> *subject_index,
+                        const EdgeIndex<T> *clipping_index, Buffers *buffers)
+    : m_subject(subject), m_clipping(clipping),
+      m_degeneracy(ScalarTraits<T>::kExact ? Degeneracy::kSymbolic
+                                           : degeneracy),
+      m_buffers(buffers ? *buffers : m_own_buffers),
+      m_edges(m_buffers.edges) {
+  m_edges.clear();
+
+  // the index of the larger polygon saves the most, querying both would cost
+  // more than a plain sweep of the smaller one
+  bool subject_larger = subject.input_count() > clipping.input_count();
+
+  if (subject_index && (subject_larger || !clipping_index)) {
+    m_edges.reserve(clipping.input_count());
+
+    add_edges(subject, *subject_index, clipping, true);
+    add_edges(clipping, subject, false);
+  } else if (clipping_index) {
+    m_edges.reserve(subject.input_count());
+
+    add_edges(subject, clipping, true);
+    add_edges(clipping, *clipping_index, subject, false);
+  } else {
+    m_edges.reserve(subject.input_count() + clipping.input_count());
+
+    add_edges(subject, clipping, true);
+    add_edges(clipping, subject, false);
+  }
+
+  sort_edges();
+}
+
+template <typename T>
+SweepLine<T>::SweepLine(FlatPolygon<T> &subject,
+                        const std::vector<EdgeRef> &subject_edges,
+                        FlatPolygon<T> &clipping, Degeneracy degeneracy)
+    : m_subject(subject), m_clipping(clipping),
+      m_degeneracy(ScalarTraits<T>::kExact ? Degeneracy::kSymbolic
+                                           : degeneracy),
+      m_buffers(m_own_buffers), m_edges(m_buffers.edges) {
+  m_edges.reserve(subject_edges.size() + clipping.input_count());
+
+  for (const auto &ref : subject_edges) {
+    add_edge(subject, ref, true);
+  }
+
+  for (size_t r = 0; r < clipping.ring_count(); r++) {
+    uint32_t begin = clipping.ring_offsets[r];
+    uint32_t end = clipping.ring_offsets[r + 1];
+
+    for (uint32_t i = begin; i < end; i++) {
+      add_edge(clipping, EdgeRef{i, i, i + 1 == end ? begin : i + 1}, false);
+    }
+  }
+
+  sort_edges();
+}
+
+template <typename T> void SweepLine<T>::sort_edges() {
+  std::sort(m_edges.begin(), m_edges.end(), [](const Edge &e1, const Edge &e2) {
+    return e1.y_min < e2.y_min;
+  });
+}
+
+template <typename T>
+void SweepLine<T>::add_edges(const FlatPolygon<T> &polygon,
+                             const FlatPolygon<T> &other, bool subject) {
+  if (!other.bounds) {
+    return;
+  }
+
+  for (size_t r = 0; r < polygon.ring_count(); r++) {
+    if (!polygon.ring_bounds[r].overlaps(*other.bounds)) {
+      continue;
+    }
+
+    uint32_t begin = polygon.ring_offsets[r];
+    uint32_t end = polygon.ring_offsets[r + 1];
+
+    for (uint32_t i = begin; i < end; i++) {
+      add_edge(polygon, EdgeRef{i, i, i + 1 == end ? begin : i + 1}, subject);
+    }
+  }
+}
+
+template <typename T>
+void SweepLine<T>::add_edges(const FlatPolygon<T> &polygon,
+                             const EdgeIndex<T> &index,
+                             const FlatPolygon<T> &other, bool subject) {
+  if (!polygon.bounds) {
+    return;
+  }
+
+  auto &refs = m_buffers.refs;
+  refs.clear();
+
+  for (size_t r = 0; r < other.ring_count(); r++) {
+    if (!other.ring_bounds[r].overlaps(*polygon.bounds)) {
+      continue;
+    }
+
+    uint32_t begin = other.ring_offsets[r];
+    uint32_t end = other.ring_offsets[r + 1];
+
+    for (uint32_t i = begin; i < end; i++) {
+      uint32_t j = i + 1 == end ? begin : i + 1;
+
+      BasicRect<T> box(
+          BasicPoint<T>(std::min(other.x[i], other.x[j]),
+                        std::min(other.y[i], other.y[j])),
+          BasicPoint<T>(std::max(other.x[i], other.x[j]),
+                        std::max(other.y[i], other.y[j])));
+
+      index.query(box, [&refs](const typename EdgeIndex<T>::Edge &edge) {
+        refs.emplace_back(EdgeRef{edge.from, edge.from, edge.to});
+      });
+    }
+  }
+
+  // an edge near several edges of other is found once for each of them
+  std::sort(refs.begin(), refs.end(),
+            [](const EdgeRef &r1, const EdgeRef &r2) { return r1.id < r2.id; });
+  refs.erase(std::unique(refs.begin(), refs.end(),
+                         [](const EdgeRef &r1, const EdgeRef &r2) {
+                           return r1.id == r2.id;
+                         }),
+             refs.end());
+
+  m_edges.reserve(m_edges.size() + refs.size());
+
+  for (const auto &ref : refs) {
+    add_edge(polygon, ref, subject);
+  }
+}
+
+template <typename T>
+void SweepLine<T>::add_edge(const FlatPolygon<T> &polygon, const EdgeRef &ref,
+                            bool subject) {
+  auto i = ref.from;
+  auto j = ref.to;
+
+  Edge edge{};
+  edge.id = ref.id;
+  edge.from = i;
+  edge.to = j;
+  edge.x_min = std::min(polygon.x[i], polygon.x[j]);
+  edge.x_max = std::max(polygon.x[i], polygon.x[j]);
+  edge.y_min = std::min(polygon.y[i], polygon.y[j]);
+  edge.y_max = std::max(polygon.y[i], polygon.y[j]);
+  edge.subject = subject;
+
+  m_edges.emplace_back(edge);
+}
+
+template <typename T>
+template <typename GetEdge, typename Visit>
+void SweepLine<T>::sweep(size_t count, GetEdge &&get_edge, Visit &&visit,
+                         std::vector<const Edge *> (&active)[2]) const {
+  // active edges for subject and clipping
+  active[0].clear();
+  active[1].clear();
+
+  for (size_t k = 0; k < count; k++) {
+    const Edge &edge = get_edge(k);
+
+    auto &self = active[edge.subject ? 0 : 1];
+    auto &other = active[edge.subject ? 1 : 0];
+
+    size_t i = 0;
+    while (i < other.size()) {
+      auto e = other[i];
+
+      if (e->y_max < edge.y_min) {
+        // sweep line already passed this edge
+        other[i] = other.back();
+        other.pop_back();
+        continue;
+      }
+
+      if (e->x_max < edge.x_min || edge.x_max < e->x_min) {
+        i++;
+        continue;
+      }
+
+      if (edge.subject) {
+        visit(edge, *e);
+      } else {
+        visit(*e, edge);
+      }
+
+      i++;
+    }
+
+    self.emplace_back(&edge);
+  }
+}
+
+template <typename T>
+void SweepLine<T>::test_pairs(const EdgePair *pairs, uint32_t count,
+                              SegmentLanes<T> &lanes,
+                              SegmentLaneResult<T> &result) const {
+  for (uint32_t i = 0; i < count; i++) {
+    const Edge &subj = *pairs[i].first;
+    const Edge &clip = *pairs[i].second;
+
+    lanes.p1x[i] = m_subject.x[subj.from];
+    lanes.p1y[i] = m_subject.y[subj.from];
+    lanes.p2x[i] = m_subject.x[subj.to];
+    lanes.p2y[i] = m_subject.y[subj.to];
+    lanes.q1x[i] = m_clipping.x[clip.from];
+    lanes.q1y[i] = m_clipping.y[clip.from];
+    lanes.q2x[i] = m_clipping.x[clip.to];
+    lanes.q2y[i] = m_clipping.y[clip.to];
+  }
+
+  if constexpr (ScalarTraits<T>::kExact) {
+    // never reached, exact coordinates are swept with cross()
+    result = SegmentLaneResult<T>();
+  } else {
+    Math::segment_test_lanes(lanes, count, result);
+  }
+}
+
+template <typename T>
+void SweepLine<T>::cross(const Edge &subj, const Edge &clip,
+                         std::vector<Intersection> &result) const {
+  SegmentCrossing<T> crossing;
+
+  if (!Math::segment_cross(m_subject, subj.from, subj.to, m_clipping,
+                           clip.from, clip.to, crossing)) {
+    return;
+  }
+
+  Intersection e{subj.id, clip.id, crossing.t1, crossing.t2};
+
+  std::copy(crossing.t1_order, crossing.t1_order + 2, e.t1_order);
+  std::copy(crossing.t2_order, crossing.t2_order + 2, e.t2_order);
+
+  result.emplace_back(e);
+}
+
+template <typename T>
+void SweepLine<T>::intersect(const Edge &subj, const Edge &clip,
+                             std::vector<Intersection> &result) {
+  if constexpr (!ScalarTraits<T>::kExact) {
+    T t1 = 0;
+    T t2 = 0;
+
+    if (Math::segment_intersect(m_subject, subj.from, subj.to, m_clipping,
+                                clip.from, clip.to, t1, t2)) {
+      result.emplace_back(Intersection{subj.id, clip.id, t1, t2});
+    }
+  }
+}
+
+template <typename T>
+std::vector<EdgeIntersection<T>> SweepLine<T>::find_intersections() {
+  std::vector<Intersection> result;
+
+  find_intersections(result);
+
+  return result;
+}
+
+template <typename T>
+void SweepLine<T>::find_intersections(std::vector<Intersection> &result) {
+  result.clear();
+
+  if (m_degeneracy == Degeneracy::kSymbolic) {
+    sweep(
+        m_edges.size(),
+        [this](size_t k) -> const Edge & { return m_edges[k]; },
+        [this, &result](const Edge &subj, const Edge &clip) {
+          PC_STATS(m_pair_tests++);
+          cross(subj, clip, result);
+        },
+        m_buffers.active);
+
+    return;
+  }
+
+  EdgePair pairs[kSegmentLanes];
+  uint32_t count = 0;
+  SegmentLanes<T> lanes;
+  SegmentLaneResult<T> lane_result;
+
+  auto flush = [&]() {
+    test_pairs(pairs, count, lanes, lane_result);
+
+    for (uint32_t i = 0; i < count; i++) {
+      if (lane_result.degenerate_mask & (1u << i)) {
+        // perturbation moves vertices which the following lanes may have
+        // read, finish this batch one pair at a time
+        for (; i < count; i++) {
+          intersect(*pairs[i].first, *pairs[i].second, result);
+        }
+        break;
+      }
+
+      if (lane_result.hit_mask & (1u << i)) {
+        result.emplace_back(Intersection{pairs[i].first->id,
+                                         pairs[i].second->id,
+                                         lane_result.t1[i],
+                                         lane_result.t2[i]});
+      }
+    }
+
+    count = 0;
+  };
+
+  sweep(
+      m_edges.size(), [this](size_t k) -> const Edge & { return m_edges[k]; },
+      [&](const Edge &subj, const Edge &clip) {
+        PC_STATS(m_pair_tests++);
+        pairs[count++] = EdgePair(&subj, &clip);
+
+        if (count == kSegmentLanes) {
+          flush();
+        }
+      },
+      m_buffers.active);
+
+  if (count > 0) {
+    flush();
+  }
+}
+
+template <typename T>
+std::vector<EdgeIntersection<T>>
+SweepLine<T>::find_intersections(ThreadPool &pool) {
+  // a perturbed vertex changes the pairs decided before it was moved, which
+  // bands running side by side would each see at a different time
+  if (m_degeneracy != Degeneracy::kSymbolic || pool.size() < 2 ||
+      m_edges.size() < kParallelSweepEdges) {
+    return find_intersections();
+  }
+
+  // bands are laid out in double, integer coordinates may span fewer units
+  // than there are bands
+  double y_min = m_edges.front().y_min;
+  double y_max = y_min;
+  for (const auto &edge : m_edges) {
+    y_max = std::max<double>(y_max, edge.y_max);
+  }
+
+  if (!(y_max > y_min)) {
+    return find_intersections();
+  }
+
+  // more bands than workers, so stealing can even out dense bands
+  uint32_t band_count = pool.size() * kBandsPerWorker;
+  double band_height = (y_max - y_min) / band_count;
+
+  auto band_of = [=](T y) {
+    auto band = static_cast<int64_t>((y - y_min) / band_height);
+    return static_cast<uint32_t>(
+        std::clamp<int64_t>(band, 0, static_cast<int64_t>(band_count) - 1));
+  };
+
+  // every band sweeps the edges overlapping it, still sorted by y_min
+  std::vector<std::vector<uint32_t>> band_edges(band_count);
+  for (uint32_t k = 0; k < m_edges.size(); k++) {
+    auto b0 = band_of(m_edges[k].y_min);
+    auto b1 = band_of(m_edges[k].y_max);
+
+    for (auto b = b0; b <= b1; b++) {
+      band_edges[b].emplace_back(k);
+    }
+  }
+
+  struct BandResult {
+    std::vector<Intersection> intersections = {};
+    uint64_t pair_tests = 0;
+  };
+
+  std::vector<BandResult> results(band_count);
+
+  pool.parallel_for(band_count, 1, [&](size_t begin, size_t end, uint32_t) {
+    for (size_t b = begin; b < end; b++) {
+      const auto &edges = band_edges[b];
+      auto &band = results[b];
+
+      std::vector<const Edge *> active[2];
+
+      sweep(
+          edges.size(),
+          [this, &edges](size_t k) -> const Edge & {
+            return m_edges[edges[k]];
+          },
+          [&](const Edge &subj, const Edge &clip) {
+            // a pair overlapping several bands is tested in the band where
+            // its overlap starts
+            if (band_of(std::max(subj.y_min, clip.y_min)) != b) {
+              return;
+            }
+
+            PC_STATS(band.pair_tests++);
+            cross(subj, clip, band.intersections);
+          },
+          active);
+    }
+  });
+
+  std::vector<Intersection> result;
+
+  for (auto &band : results) {
+    result.insert(result.end(), band.intersections.begin(),
+                  band.intersections.end());
+    PC_STATS(m_pair_tests += band.pair_tests);
+  }
+
+  return result;
+}
+
+template class SweepLine<float>;
+template class SweepLine<double>;
+template class SweepLine<int32_t>;
+
+} // namespace pc
@@ -0,0 +1,195 @@
+#pragma once
+
+#include "polygon_clip.hpp"
+#include "polygon_clip_math.hpp"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace pc {
+
+template <typename T> struct FlatPolygon;
+template <typename T> class EdgeIndex;
+class ThreadPool;
+
+/**
+ * One crossing between a subject edge and a clipping edge.
+ *
+ * Edges are referenced by their id, which is the index of their start vertex
+ * unless the caller handed explicit edges to SweepLine. t1 and t2 are the
+ * parametric positions along the subject and clipping edge, the order arrays
+ * break ties between equal t as described in SegmentCrossing.
+ */
+template <typename T> struct EdgeIntersection {
+  uint32_t subject_edge;
+  uint32_t clipping_edge;
+  EdgeParam<T> t1;
+  EdgeParam<T> t2;
+  EdgeParam<T> t1_order[2] = {};
+  EdgeParam<T> t2_order[2] = {};
+};
+
+/**
+ * Sweep a horizontal line through the edges of both polygons and only test
+ * edge pairs whose y-ranges overlap.
+ *
+ * Edges are sorted by their lowest y, an edge becomes active when the sweep
+ * line reaches it and is retired once the sweep line passes its highest y.
+ * When an edge becomes active it is tested against the active edges of the
+ * other polygon only, so every overlapping pair is tested exactly once. Pairs
+ * whose x-ranges are disjoint are skipped without calling
+ * Math::segment_intersect.
+ *
+ * Rings whose bounding box misses the other polygon are left out of the sweep.
+ * If the larger polygon comes with an EdgeIndex, only its edges overlapping an
+ * edge of the other polygon enter the sweep.
+ */
+template <typename T> class SweepLine {
+public:
+  using Intersection = EdgeIntersection<T>;
+
+  struct EdgeRef {
+    uint32_t id;
+    uint32_t from;
+    uint32_t to;
+  };
+
+  struct Edge {
+    uint32_t id;
+    uint32_t from;
+    uint32_t to;
+    T x_min;
+    T x_max;
+    T y_min;
+    T y_max;
+    bool subject;
+  };
+
+  /**
+   * Lists a search fills, callers running many searches keep them so their
+   * memory is reused. The parallel search still allocates its bands.
+   */
+  struct Buffers {
+    std::vector<Edge> edges = {};
+    std::vector<EdgeRef> refs = {};
+    std::vector<const Edge *> active[2] = {};
+  };
+
+  /**
+   * With Degeneracy::kSymbolic pairs are tested with Math::segment_cross and
+   * neither polygon is modified. Integer coordinates are always swept this
+   * way. The indexes are optional and must be built from the polygons the
+   * working copies were assigned from. If buffers is set, the search works in
+   * these lists instead of its own.
+   */
+  SweepLine(FlatPolygon<T> &subject, FlatPolygon<T> &clipping,
+            Degeneracy degeneracy = Degeneracy::kPerturb,
+            const EdgeIndex<T> *subject_index = nullptr,
+            const EdgeIndex<T> *clipping_index = nullptr,
+            Buffers *buffers = nullptr);
+
+  /**
+   * Only sweep the given subject edges against all clipping edges
+   */
+  SweepLine(FlatPolygon<T> &subject,
+            const std::vector<EdgeRef> &subject_edges,
+            FlatPolygon<T> &clipping,
+            Degeneracy degeneracy = Degeneracy::kPerturb);
+  ~SweepLine() = default;
+
+  std::vector<Intersection> find_intersections();
+
+  /**
+   * Same as above, the intersections are written to result which is cleared
+   * first
+   */
+  void find_intersections(std::vector<Intersection> &result);
+
+  /**
+   * Same result as above with the search split into horizontal bands which
+   * are swept on the workers of pool. Only the symbolic search is split,
+   * with Degeneracy::kPerturb the result depends on the order in which
+   * vertices are moved, so it runs on the calling thread.
+   */
+  std::vector<Intersection> find_intersections(ThreadPool &pool);
+
+  /**
+   * Edge pairs tested by the searches so far, only counted with
+   * PC_ENABLE_STATS
+   */
+  uint64_t pair_tests() const { return m_pair_tests; }
+
+  /**
+   * Bytes reserved for the sorted edge list
+   */
+  size_t memory_size() const {
+    return m_buffers.edges.capacity() * sizeof(Edge);
+  }
+
+private:
+  void add_edges(const FlatPolygon<T> &polygon, const FlatPolygon<T> &other,
+                 bool subject);
+
+  /**
+   * Add the edges of index overlapping any edge of other
+   */
+  void add_edges(const FlatPolygon<T> &polygon, const EdgeIndex<T> &index,
+                 const FlatPolygon<T> &other, bool subject);
+
+  void add_edge(const FlatPolygon<T> &polygon, const EdgeRef &ref,
+                bool subject);
+
+  void sort_edges();
+
+  /**
+   * Sweep edges get_edge(0) ... get_edge(count - 1), which must be sorted by
+   * y_min, and call visit(subject_edge, clipping_edge) on every pair with
+   * overlapping ranges. active holds the active edges of both polygons and
+   * is cleared first.
+   */
+  template <typename GetEdge, typename Visit>
+  void sweep(size_t count, GetEdge &&get_edge, Visit &&visit,
+             std::vector<const Edge *> (&active)[2]) const;
+
+  using EdgePair = std::pair<const Edge *, const Edge *>;
+
+  /**
+   * Load up to kSegmentLanes (subject, clipping) pairs into lanes and test
+   * them with one call of Math::segment_test_lanes
+   */
+  void test_pairs(const EdgePair *pairs, uint32_t count,
+                  SegmentLanes<T> &lanes, SegmentLaneResult<T> &result) const;
+
+  /**
+   * Append the crossing of subj and clip to result if there is one, used
+   * instead of the lanes with Degeneracy::kSymbolic
+   */
+  void cross(const Edge &subj, const Edge &clip,
+             std::vector<Intersection> &result) const;
+
+  /**
+   * Append the crossing of subj and clip found by Math::segment_intersect,
+   * which may perturb their vertices
+   */
+  void intersect(const Edge &subj, const Edge &clip,
+                 std::vector<Intersection> &result);
+
+private:
+  FlatPolygon<T> &m_subject;
+  FlatPolygon<T> &m_clipping;
+  Degeneracy m_degeneracy = ScalarTraits<T>::kExact ? Degeneracy::kSymbolic
+                                                     : Degeneracy::kPerturb;
+  // used when the caller passes no buffers
+  Buffers m_own_buffers = {};
+  Buffers &m_buffers;
+  // sorted by y_min
+  std::vector<Edge> &m_edges;
+  uint64_t m_pair_tests = 0;
+};
+
+extern template class SweepLine<float>;
+extern template class SweepLine<double>;
+extern template class SweepLine<int32_t>;
+
+} // namespace pc
@@ -0,0 +1,150 @@
+#include "polygon_clip_thread_pool.hpp"
+
+#include <algorithm>
+
+namespace pc {
+
+ThreadPool::ThreadPool(uint32_t thread_count) {
+  thread_count = std::max<uint32_t>(thread_count, 1);
+
+  for (uint32_t i = 0; i < thread_count; i++) {
+    m_workers.emplace_back(std::make_unique<Worker>());
+  }
+
+  for (uint32_t i = 0; i < thread_count; i++) {
+    m_threads.emplace_back([this, i]() { worker_loop(i); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+
+  m_wake.notify_all();
+
+  for (auto &thread : m_threads) {
+    thread.join();
+  }
+}
+
+void ThreadPool::parallel_for(size_t count, size_t grain,
+                              const RangeFunc &func) {
+  if (count == 0) {
+    return;
+  }
+
+  grain = std::max<size_t>(grain, 1);
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_func = &func;
+    m_error = nullptr;
+    m_pending.store(count);
+
+    // deal contiguous blocks of ranges to the workers
+    size_t range_count = (count + grain - 1) / grain;
+    size_t per_worker = (range_count + size() - 1) / size();
+
+    for (size_t r = 0; r < range_count; r++) {
+      auto &worker = *m_workers[r / per_worker];
+
+      std::lock_guard<std::mutex> worker_lock(worker.mutex);
+      worker.ranges.emplace_back(
+          Range{r * grain, std::min(count, (r + 1) * grain)});
+    }
+
+    m_generation++;
+  }
+
+  m_wake.notify_all();
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_done.wait(lock, [this]() { return m_pending.load() == 0; });
+
+  m_func = nullptr;
+
+  if (m_error) {
+    std::rethrow_exception(m_error);
+  }
+}
+
+void ThreadPool::worker_loop(uint32_t index) {
+  uint64_t generation = 0;
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_wake.wait(lock, [this, generation]() {
+        return m_stop || m_generation != generation;
+      });
+
+      if (m_stop) {
+        return;
+      }
+
+      generation = m_generation;
+    }
+
+    Range range{};
+    while (pop(index, range) || steal(index, range)) {
+      run(range, index);
+    }
+  }
+}
+
+bool ThreadPool::pop(uint32_t index, Range &range) {
+  auto &worker = *m_workers[index];
+
+  std::lock_guard<std::mutex> lock(worker.mutex);
+
+  if (worker.ranges.empty()) {
+    return false;
+  }
+
+  range = worker.ranges.back();
+  worker.ranges.pop_back();
+
+  return true;
+}
+
+bool ThreadPool::steal(uint32_t index, Range &range) {
+  for (uint32_t i = 1; i < size(); i++) {
+    auto &worker = *m_workers[(index + i) % size()];
+
+    std::lock_guard<std::mutex> lock(worker.mutex);
+
+    if (worker.ranges.empty()) {
+      continue;
+    }
+
+    range = worker.ranges.front();
+    worker.ranges.pop_front();
+
+    return true;
+  }
+
+  return false;
+}
+
+void ThreadPool::run(const Range &range, uint32_t index) {
+  try {
+    (*m_func)(range.begin, range.end, index);
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_error) {
+      m_error = std::current_exception();
+    }
+  }
+
+  if (m_pending.fetch_sub(range.end - range.begin) ==
+      range.end - range.begin) {
+    // last range, wake up the caller
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_done.notify_all();
+  }
+}
+
+} // namespace pc
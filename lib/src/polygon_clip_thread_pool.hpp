@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pc {
+
+/**
+ * Fixed size thread pool with work stealing.
+ *
+ * Each worker owns a deque of index ranges. A worker pops ranges from the
+ * back of its own deque and, once that is empty, steals from the front of
+ * the other deques, so uneven jobs still keep every worker busy.
+ */
+class ThreadPool {
+public:
+  /**
+   * Called with a range [begin, end) and the index of the running worker
+   */
+  using RangeFunc = std::function<void(size_t, size_t, uint32_t)>;
+
+  explicit ThreadPool(uint32_t thread_count);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  uint32_t size() const { return static_cast<uint32_t>(m_workers.size()); }
+
+  /**
+   * Split [0, count) into ranges of at most grain items, run func on them and
+   * block until all ranges are done. The first exception thrown by func is
+   * rethrown here.
+   */
+  void parallel_for(size_t count, size_t grain, const RangeFunc &func);
+
+private:
+  struct Range {
+    size_t begin;
+    size_t end;
+  };
+
+  struct Worker {
+    std::mutex mutex = {};
+    std::deque<Range> ranges = {};
+  };
+
+  void worker_loop(uint32_t index);
+
+  bool pop(uint32_t index, Range &range);
+
+  bool steal(uint32_t index, Range &range);
+
+  void run(const Range &range, uint32_t index);
+
+private:
+  std::vector<std::unique_ptr<Worker>> m_workers = {};
+  std::vector<std::thread> m_threads = {};
+
+  std::mutex m_mutex = {};
+  std::condition_variable m_wake = {};
+  std::condition_variable m_done = {};
+  uint64_t m_generation = 0;
+  bool m_stop = false;
+
+  const RangeFunc *m_func = nullptr;
+  std::atomic<size_t> m_pending = {0};
+  std::exception_ptr m_error = {};
+};
+
+} // namespace pc
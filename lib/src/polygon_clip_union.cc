@@ -0,0 +1,332 @@
+#include "polygon_clip_union.hpp"
+#include "polygon_clip_index.hpp"
+#include "polygon_clip_thread_pool.hpp"
+
+#include <algorithm>
+#include <thread>
+
+namespace pc {
+
+// UnionAll hands each worker about this many subtrees
+constexpr size_t kUnionSubtreesPerWorker = 8;
+
+template <typename T>
+BasicPolygon<T> UnionMerger<T>::merge(Polygon &&p1, Polygon &&p2,
+                                      Workspace &workspace) {
+  auto bounds1 = p1.get_bounds();
+  auto bounds2 = p2.get_bounds();
+
+  if (!bounds1) {
+    return std::move(p2);
+  }
+  if (!bounds2) {
+    return std::move(p1);
+  }
+
+  std::vector<bool> near1;
+  std::vector<bool> near2;
+
+  if (!bounds1->overlaps(*bounds2) ||
+      !mark_near(p1.m_sub_bounds, p2.m_sub_bounds, near1, near2)) {
+    // nothing overlaps, the union is both ring lists
+    return Polygon(std::move(p1), std::move(p2));
+  }
+
+  auto all_near = [](const std::vector<bool> &near) {
+    return std::all_of(near.begin(), near.end(), [](bool b) { return b; });
+  };
+
+  // only copy the rings near the other polygon if some of them are not
+  bool whole1 = all_near(near1);
+  bool whole2 = all_near(near2);
+
+  Polygon part1;
+  Polygon part2;
+  if (!whole1) {
+    append_rings(part1, p1, near1, true);
+  }
+  if (!whole2) {
+    append_rings(part2, p2, near2, true);
+  }
+
+  auto result = ClipAlgorithm<T>::do_op(BoolOp::kUnion, whole1 ? p1 : part1,
+                                        whole2 ? p2 : part2, workspace);
+
+  append_rings(result, p1, near1, false);
+  append_rings(result, p2, near2, false);
+
+  return result;
+}
+
+template <typename T>
+BasicPolygon<T> UnionMerger<T>::merge_all(const std::vector<Polygon> &polygons,
+                                          uint32_t thread_count,
+                                          Degeneracy degeneracy) {
+  if (thread_count == 0) {
+    thread_count = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  ThreadPool pool(thread_count);
+
+  std::vector<std::unique_ptr<Workspace>> workspaces;
+  for (uint32_t i = 0; i < pool.size(); i++) {
+    workspaces.emplace_back(std::make_unique<Workspace>());
+    workspaces.back()->degeneracy = degeneracy;
+  }
+
+  // leaves of the tree, neighbours next to each other
+  auto order = spatial_order(polygons);
+
+  // each worker reduces whole subtrees depth first, which keeps the polygons
+  // of a subtree in its cache, several subtrees per worker so uneven ones
+  // still balance
+  size_t subtree_count =
+      std::min<size_t>(order.size(), kUnionSubtreesPerWorker * pool.size());
+
+  std::vector<Polygon> parts(subtree_count);
+  pool.parallel_for(
+      subtree_count, 1, [&](size_t begin, size_t end, uint32_t worker) {
+        for (size_t i = begin; i < end; i++) {
+          parts[i] = merge_range(polygons, order,
+                                 i * order.size() / subtree_count,
+                                 (i + 1) * order.size() / subtree_count,
+                                 *workspaces[worker]);
+        }
+      });
+
+  // then the subtree roots are merged pairwise, one level at a time
+  while (parts.size() > 2) {
+    std::vector<Polygon> next(parts.size() / 2);
+
+    pool.parallel_for(
+        next.size(), 1, [&](size_t begin, size_t end, uint32_t worker) {
+          for (size_t i = begin; i < end; i++) {
+            next[i] = merge(std::move(parts[2 * i]),
+                            std::move(parts[2 * i + 1]), *workspaces[worker]);
+          }
+        });
+
+    if (parts.size() % 2 == 1) {
+      next.emplace_back(std::move(parts.back()));
+    }
+
+    parts = std::move(next);
+  }
+
+  if (parts.empty()) {
+    return Polygon();
+  }
+  if (parts.size() == 1) {
+    return std::move(parts.front());
+  }
+
+  // the root merge is the largest one, the workers split its intersection
+  // search instead
+  auto &workspace = *workspaces.front();
+  workspace.pool = &pool;
+
+  return merge(std::move(parts[0]), std::move(parts[1]), workspace);
+}
+
+template <typename T>
+BasicPolygon<T> UnionMerger<T>::merge_range(
+    const std::vector<Polygon> &polygons, const std::vector<uint32_t> &order,
+    size_t begin, size_t end, Workspace &workspace) {
+  if (end - begin == 1) {
+    return Polygon(polygons[order[begin]]);
+  }
+
+  size_t mid = begin + (end - begin) / 2;
+
+  return merge(merge_range(polygons, order, begin, mid, workspace),
+               merge_range(polygons, order, mid, end, workspace), workspace);
+}
+
+template <typename T>
+std::vector<uint32_t>
+UnionMerger<T>::spatial_order(const std::vector<Polygon> &polygons) {
+  std::vector<Rect> boxes;
+  std::vector<uint32_t> inputs;
+  std::optional<Rect> bounds;
+
+  for (uint32_t i = 0; i < polygons.size(); i++) {
+    auto box = polygons[i].get_bounds();
+    if (!box) {
+      continue;
+    }
+
+    if (!bounds) {
+      bounds = box;
+    } else {
+      bounds->left_top.x = std::min(bounds->left_top.x, box->left_top.x);
+      bounds->left_top.y = std::min(bounds->left_top.y, box->left_top.y);
+      bounds->right_bottom.x =
+          std::max(bounds->right_bottom.x, box->right_bottom.x);
+      bounds->right_bottom.y =
+          std::max(bounds->right_bottom.y, box->right_bottom.y);
+    }
+
+    boxes.emplace_back(*box);
+    inputs.emplace_back(i);
+  }
+
+  if (!bounds) {
+    return inputs;
+  }
+
+  std::vector<uint32_t> order;
+  order.reserve(inputs.size());
+  for (auto i : hilbert_order(boxes, *bounds)) {
+    order.emplace_back(inputs[i]);
+  }
+
+  return order;
+}
+
+template <typename T>
+bool UnionMerger<T>::mark_near(const std::vector<Rect> &bounds1,
+                               const std::vector<Rect> &bounds2,
+                               std::vector<bool> &near1,
+                               std::vector<bool> &near2) {
+  near1.assign(bounds1.size(), false);
+  near2.assign(bounds2.size(), false);
+
+  struct Box {
+    const Rect *rect;
+    uint32_t ring;
+    uint32_t side;
+  };
+
+  std::vector<Box> boxes;
+  boxes.reserve(bounds1.size() + bounds2.size());
+  for (uint32_t i = 0; i < bounds1.size(); i++) {
+    boxes.emplace_back(Box{&bounds1[i], i, 0});
+  }
+  for (uint32_t i = 0; i < bounds2.size(); i++) {
+    boxes.emplace_back(Box{&bounds2[i], i, 1});
+  }
+
+  std::sort(boxes.begin(), boxes.end(), [](const Box &b1, const Box &b2) {
+    return b1.rect->left_top.x < b2.rect->left_top.x;
+  });
+
+  // sweep towards +x, testing each box against the boxes of the other side
+  // still reaching its left edge
+  std::vector<Box> active[2];
+  std::vector<bool> *near[2] = {&near1, &near2};
+  bool found = false;
+
+  for (const auto &box : boxes) {
+    auto &others = active[1 - box.side];
+    T left = box.rect->left_top.x;
+
+    others.erase(std::remove_if(others.begin(), others.end(),
+                                [left](const Box &other) {
+                                  return other.rect->right_bottom.x < left;
+                                }),
+                 others.end());
+
+    for (const auto &other : others) {
+      if (other.rect->left_top.y <= box.rect->right_bottom.y &&
+          box.rect->left_top.y <= other.rect->right_bottom.y) {
+        (*near[box.side])[box.ring] = true;
+        (*near[other.side])[other.ring] = true;
+        found = true;
+      }
+    }
+
+    active[box.side].emplace_back(box);
+  }
+
+  return found;
+}
+
+template <typename T>
+void UnionMerger<T>::append_rings(Polygon &result, const Polygon &polygon,
+                                  const std::vector<bool> &near,
+                                  bool keep_near) {
+  for (size_t i = 0; i < polygon.m_sub_polygons.size(); i++) {
+    if (near[i] == keep_near) {
+      result.append_ring(polygon, i, false);
+    }
+  }
+}
+
+template <typename T>
+BasicUnionAccumulator<T>::BasicUnionAccumulator(Degeneracy degeneracy)
+    : m_workspace(std::make_unique<ClipWorkspace<T>>()) {
+  m_workspace->degeneracy = degeneracy;
+}
+
+template <typename T>
+BasicUnionAccumulator<T>::~BasicUnionAccumulator() = default;
+
+template <typename T>
+void BasicUnionAccumulator<T>::add(const Polygon &polygon) {
+  push(Polygon(polygon));
+}
+
+template <typename T> void BasicUnionAccumulator<T>::add(Polygon &&polygon) {
+  push(std::move(polygon));
+}
+
+template <typename T>
+void BasicUnionAccumulator<T>::add(const std::vector<Polygon> &polygons) {
+  auto order = UnionMerger<T>::spatial_order(polygons);
+
+  // empty polygons add nothing but still count as added
+  m_count += polygons.size() - order.size();
+
+  // neighbours are merged first, so later merges mostly see rings far apart
+  for (auto i : order) {
+    add(polygons[i]);
+  }
+}
+
+template <typename T>
+const BasicPolygon<T> &BasicUnionAccumulator<T>::result() {
+  if (m_stack.empty()) {
+    m_stack.emplace_back();
+  }
+
+  while (m_stack.size() > 1) {
+    merge_top();
+  }
+
+  return m_stack.front().polygon;
+}
+
+template <typename T> void BasicUnionAccumulator<T>::clear() {
+  m_stack.clear();
+  m_count = 0;
+}
+
+template <typename T> void BasicUnionAccumulator<T>::push(Polygon &&polygon) {
+  m_count++;
+  m_stack.emplace_back(Partial{std::move(polygon), 1});
+
+  while (m_stack.size() > 1 &&
+         m_stack.back().count >= m_stack[m_stack.size() - 2].count) {
+    merge_top();
+  }
+}
+
+template <typename T> void BasicUnionAccumulator<T>::merge_top() {
+  auto top = std::move(m_stack.back());
+  m_stack.pop_back();
+
+  auto &below = m_stack.back();
+  below.polygon = UnionMerger<T>::merge(
+      std::move(below.polygon), std::move(top.polygon), *m_workspace);
+  below.count += top.count;
+}
+
+template class UnionMerger<float>;
+template class UnionMerger<double>;
+template class UnionMerger<int32_t>;
+
+template class BasicUnionAccumulator<float>;
+template class BasicUnionAccumulator<double>;
+template class BasicUnionAccumulator<int32_t>;
+
+} // namespace pc
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "polygon_clip.hpp"
+#include "polygon_clip_priv.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace pc {
+
+/**
+ * Union of two partial results of a multi polygon union.
+ *
+ * A ring whose bounding box does not touch the box of any ring of the other
+ * polygon cannot overlap the other polygon, so it is part of the union as it
+ * is. Only the remaining rings of both sides go through ClipAlgorithm, the
+ * untouched ones are appended to its result. Inputs must be simple polygons
+ * whose rings at most touch at vertices.
+ */
+template <typename T> class UnionMerger {
+public:
+  using Rect = BasicRect<T>;
+  using Polygon = BasicPolygon<T>;
+  using Workspace = ClipWorkspace<T>;
+
+  static Polygon merge(Polygon &&p1, Polygon &&p2, Workspace &workspace);
+
+  /**
+   * Union of all polygons, merged pairwise along a binary tree whose levels
+   * run in parallel
+   *
+   * @thread_count  number of worker threads, 0 means one per hardware thread
+   */
+  static Polygon merge_all(const std::vector<Polygon> &polygons,
+                           uint32_t thread_count, Degeneracy degeneracy);
+
+  /**
+   * Indices of the non-empty polygons along a Hilbert curve through the
+   * centers of their bounding boxes
+   */
+  static std::vector<uint32_t>
+  spatial_order(const std::vector<Polygon> &polygons);
+
+private:
+  /**
+   * Union of polygons[order[begin]] to polygons[order[end - 1]], halves are
+   * merged recursively, end must be greater than begin
+   */
+  static Polygon merge_range(const std::vector<Polygon> &polygons,
+                             const std::vector<uint32_t> &order, size_t begin,
+                             size_t end, Workspace &workspace);
+
+  /**
+   * Set near1[i] if ring i of bounds1 touches a ring of bounds2 and near2[j]
+   * for the rings of bounds2 the other way round
+   *
+   * @return true if any ring touches
+   */
+  static bool mark_near(const std::vector<Rect> &bounds1,
+                        const std::vector<Rect> &bounds2,
+                        std::vector<bool> &near1, std::vector<bool> &near2);
+
+  /**
+   * Copy the rings of polygon whose flag in near equals keep_near
+   */
+  static void append_rings(Polygon &result, const Polygon &polygon,
+                           const std::vector<bool> &near, bool keep_near);
+};
+
+extern template class UnionMerger<float>;
+extern template class UnionMerger<double>;
+extern template class UnionMerger<int32_t>;
+
+} // namespace pc
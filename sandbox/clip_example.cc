@@ -18,7 +18,9 @@ int main(int argc, const char **argv) {
   pc::Polygon clipping;
   clipping.append_vertices(points2);
 
-  pc::Polygon clip_result = pc::Polygon::Clip(subject, clipping);
+  // filled straight from the result walk, the renderer uploads its arrays
+  pc::PolygonBuffer clip_result;
+  pc::Polygon::Clip(subject, clipping, clip_result);
 
   pc::Polygon union_result = pc::Polygon::Union(subject, clipping);
 
@@ -154,6 +154,13 @@ PolygonRender::PolygonRender(uint32_t screen_width, uint32_t screen_height,
 PolygonRender::~PolygonRender() {}
 
 void PolygonRender::init(const pc::Polygon &polygon, bool is_stroke) {
+  pc::PolygonBuffer buffer;
+  buffer.append(polygon);
+
+  init(buffer, is_stroke);
+}
+
+void PolygonRender::init(const pc::PolygonBuffer &buffer, bool is_stroke) {
   m_program = GlProgram::GetProgram();
 
   m_stroke = is_stroke;
@@ -163,9 +170,9 @@ void PolygonRender::init(const pc::Polygon &polygon, bool is_stroke) {
   glGenBuffers(1, &m_ibo);
 
   if (m_stroke) {
-    init_stroke(polygon);
+    init_stroke(buffer);
   } else {
-    init_fill(polygon);
+    init_fill(buffer);
   }
 
   glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -238,113 +245,61 @@ void PolygonRender::draw_fill(const std::array<float, 4> &color) {
   glDisable(GL_STENCIL_TEST);
 }
 
-void PolygonRender::init_stroke(const pc::Polygon &polygon) {
-  std::vector<float> stage_vertices;
+void PolygonRender::init_stroke(const pc::PolygonBuffer &buffer) {
   std::vector<uint32_t> stage_index;
 
-  for (auto head : polygon.get_vertices()) {
-    auto curr = head;
+  for (size_t r = 0; r < buffer.ring_count(); r++) {
     uint32_t offset = stage_index.size() * sizeof(uint32_t);
-    uint32_t count = 0;
-    do {
-      uint32_t i = stage_vertices.size() / 2;
+    uint32_t count = buffer.ring_offsets[r + 1] - buffer.ring_offsets[r];
 
+    for (uint32_t i = buffer.ring_offsets[r]; i < buffer.ring_offsets[r + 1];
+         i++) {
       stage_index.emplace_back(i);
-
-      stage_vertices.emplace_back(curr->point.x);
-      stage_vertices.emplace_back(curr->point.y);
-
-      count++;
-
-      curr = curr->next;
-    } while (curr != head);
+    }
 
     m_cmds.emplace_back(DrawCmd{offset, count});
   }
 
-  glBindVertexArray(m_vao);
-  glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-
-  glBufferData(GL_ARRAY_BUFFER, stage_vertices.size() * sizeof(float),
-               stage_vertices.data(), GL_STATIC_DRAW);
-
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ibo);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, stage_index.size() * sizeof(uint32_t),
-               stage_index.data(), GL_STATIC_DRAW);
+  upload(buffer, stage_index);
 }
 
-void PolygonRender::init_fill(const pc::Polygon &polygon) {
-  std::vector<float> stage_vertices;
+void PolygonRender::init_fill(const pc::PolygonBuffer &buffer) {
   std::vector<uint32_t> stage_index;
 
-  for (auto head : polygon.get_vertices()) {
-    auto curr = head;
-
-    if (curr->next->next->next == head) {
-      uint32_t i = stage_vertices.size() / 2;
-      stage_vertices.emplace_back(curr->point.x);
-      stage_vertices.emplace_back(curr->point.y);
-      uint32_t j = stage_vertices.size() / 2;
-      stage_vertices.emplace_back(curr->next->point.x);
-      stage_vertices.emplace_back(curr->next->point.x);
-      uint32_t k = stage_vertices.size() / 2;
-      stage_vertices.emplace_back(curr->next->next->point.x);
-      stage_vertices.emplace_back(curr->next->next->point.y);
-
-      uint32_t offset = stage_index.size() * sizeof(uint32_t);
-
-      stage_index.emplace_back(i);
-      stage_index.emplace_back(j);
-      stage_index.emplace_back(k);
-
-      m_cmds.emplace_back(DrawCmd{offset, 3});
-
-      continue;
-    }
-
+  // a fan around the first vertex of each ring, the stencil pass takes care
+  // of concave rings and holes
+  for (size_t r = 0; r < buffer.ring_count(); r++) {
     uint32_t offset = stage_index.size() * sizeof(uint32_t);
     uint32_t count = 0;
 
-    uint32_t i_first = stage_vertices.size() / 2;
-
-    stage_vertices.emplace_back(curr->point.x);
-    stage_vertices.emplace_back(curr->point.y);
-
-    uint32_t i_prev = stage_vertices.size() / 2;
-    curr = curr->next;
-
-    stage_vertices.emplace_back(curr->point.x);
-    stage_vertices.emplace_back(curr->point.y);
-
-    do {
-
-      uint32_t i_curr = stage_vertices.size() / 2;
-
-      stage_vertices.emplace_back(curr->point.x);
-      stage_vertices.emplace_back(curr->point.y);
+    uint32_t i_first = buffer.ring_offsets[r];
 
+    for (uint32_t i = i_first + 2; i < buffer.ring_offsets[r + 1]; i++) {
       stage_index.emplace_back(i_first);
-      stage_index.emplace_back(i_prev);
-      stage_index.emplace_back(i_curr);
-
-      i_prev = i_curr;
+      stage_index.emplace_back(i - 1);
+      stage_index.emplace_back(i);
 
-      curr = curr->next;
       count += 3;
-    } while (curr != head);
+    }
 
     m_cmds.emplace_back(DrawCmd{offset, count});
   }
 
+  upload(buffer, stage_index);
+}
+
+void PolygonRender::upload(const pc::PolygonBuffer &buffer,
+                           const std::vector<uint32_t> &index) {
   glBindVertexArray(m_vao);
   glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
 
-  glBufferData(GL_ARRAY_BUFFER, stage_vertices.size() * sizeof(float),
-               stage_vertices.data(), GL_STATIC_DRAW);
+  // the coordinates are laid out as the vertex attribute expects them
+  glBufferData(GL_ARRAY_BUFFER, buffer.coords.size() * sizeof(float),
+               buffer.coords.data(), GL_STATIC_DRAW);
 
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ibo);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, stage_index.size() * sizeof(uint32_t),
-               stage_index.data(), GL_STATIC_DRAW);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, index.size() * sizeof(uint32_t),
+               index.data(), GL_STATIC_DRAW);
 }
 
 App::App(std::string title, uint32_t width, uint32_t height)
@@ -28,13 +28,18 @@ public:
 
   void init(const pc::Polygon &polygon, bool is_stroke);
 
+  void init(const pc::PolygonBuffer &buffer, bool is_stroke);
+
   void terminate();
 
   void draw(const std::array<float, 4> &color);
 
 private:
-  void init_stroke(const pc::Polygon &polygon);
-  void init_fill(const pc::Polygon &polygon);
+  void init_stroke(const pc::PolygonBuffer &buffer);
+  void init_fill(const pc::PolygonBuffer &buffer);
+
+  void upload(const pc::PolygonBuffer &buffer,
+              const std::vector<uint32_t> &index);
 
   void draw_stroke(const std::array<float, 4> &color);
   void draw_fill(const std::array<float, 4> &color);
@@ -0,0 +1,169 @@
+#include "polygon_clip.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace pc {
+namespace check {
+
+constexpr float kPi = 3.14159265358979f;
+
+/**
+ * Integer in [low, high], drawn without a std distribution so every standard
+ * library generates the same shapes
+ */
+static int random_int(std::mt19937 &rng, int low, int high) {
+  return low + static_cast<int>(rng() % static_cast<uint32_t>(high - low + 1));
+}
+
+/**
+ * Star with count corners around center, coordinates rounded to integers so
+ * that windows and subjects share vertices and collinear edges
+ */
+static Polygon snapped_star(std::mt19937 &rng, int count, Point center) {
+  std::vector<Point> points;
+
+  for (int i = 0; i < count; i++) {
+    float a = 2.f * kPi * i / count;
+    float r = static_cast<float>(random_int(rng, 6, 20));
+
+    if (i % 2 == 0) {
+      r *= 0.5f;
+    }
+
+    points.emplace_back(std::round(center.x + r * std::cos(a)),
+                        std::round(center.y + r * std::sin(a)));
+  }
+
+  Polygon polygon;
+  polygon.append_vertices(points);
+
+  return polygon;
+}
+
+static Polygon snapped_rect(std::mt19937 &rng) {
+  float x0 = static_cast<float>(random_int(rng, -15, 15));
+  float y0 = static_cast<float>(random_int(rng, -15, 15));
+  float x1 = x0 + static_cast<float>(random_int(rng, 1, 16));
+  float y1 = y0 + static_cast<float>(random_int(rng, 1, 32));
+
+  Polygon polygon;
+  polygon.append_vertices(
+      {Point(x0, y0), Point(x1, y0), Point(x1, y1), Point(x0, y1)});
+
+  return polygon;
+}
+
+/**
+ * Whether p is too close to an edge of polygon for its side to be told
+ * reliably in float
+ */
+static bool near_boundary(const Polygon &polygon, const Point &p) {
+  for (auto head : polygon.get_vertices()) {
+    auto current = head;
+
+    do {
+      auto a = current->point;
+      auto b = current->next->point;
+
+      double dx = b.x - a.x;
+      double dy = b.y - a.y;
+      double t = ((p.x - a.x) * dx + (p.y - a.y) * dy) / (dx * dx + dy * dy);
+      t = std::fmin(std::fmax(t, 0.0), 1.0);
+
+      double ex = a.x + t * dx - p.x;
+      double ey = a.y + t * dy - p.y;
+
+      if (ex * ex + ey * ey < 1e-6) {
+        return true;
+      }
+
+      current = current->next;
+    } while (current != head);
+  }
+
+  return false;
+}
+
+/**
+ * Sample points where result disagrees with being inside subject and window
+ */
+static int wrong_points(const Polygon &subject, const Polygon &window,
+                        const Polygon &result) {
+  int wrong = 0;
+
+  for (float y = -36.37f; y < 36.f; y += 0.71f) {
+    for (float x = -36.29f; x < 36.f; x += 0.73f) {
+      Point p(x, y);
+
+      if (near_boundary(subject, p) || near_boundary(window, p)) {
+        continue;
+      }
+
+      bool expected = subject.contains(p) && window.contains(p);
+
+      if (result.contains(p) != expected) {
+        wrong++;
+      }
+    }
+  }
+
+  return wrong;
+}
+
+/**
+ * Clip snapped subjects against snapped rectangles and stars in one batch
+ * call, every window has to give the same region as the exact answer
+ */
+static int check_snapped_batch(Degeneracy degeneracy) {
+  std::mt19937 rng(7);
+
+  int wrong_windows = 0;
+
+  for (int s = 0; s < 150; s++) {
+    Polygon subject = snapped_star(rng, 8 + s % 24, Point(0.f, 0.f));
+
+    std::vector<Polygon> windows;
+
+    for (int w = 0; w < 6; w++) {
+      if (w % 2 == 0) {
+        windows.emplace_back(snapped_rect(rng));
+      } else {
+        Point center(static_cast<float>(random_int(rng, -15, 15)),
+                     static_cast<float>(random_int(rng, -15, 15)));
+
+        windows.emplace_back(snapped_star(rng, 5 + w, center));
+      }
+    }
+
+    auto results = Polygon::Clip(subject, windows, degeneracy);
+
+    for (size_t w = 0; w < windows.size(); w++) {
+      int wrong = wrong_points(subject, windows[w], results[w]);
+
+      if (wrong > 0) {
+        std::printf("subject %d window %zu: %d wrong sample points\n", s, w,
+                    wrong);
+        wrong_windows++;
+      }
+    }
+  }
+
+  return wrong_windows;
+}
+
+} // namespace check
+} // namespace pc
+
+int main() {
+  int perturb = pc::check::check_snapped_batch(pc::Degeneracy::kPerturb);
+  int symbolic = pc::check::check_snapped_batch(pc::Degeneracy::kSymbolic);
+
+  std::printf("batch clip of snapped windows: %d wrong with kPerturb, %d "
+              "wrong with kSymbolic\n",
+              perturb, symbolic);
+
+  return perturb == 0 && symbolic == 0 ? 0 : 1;
+}
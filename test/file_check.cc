@@ -0,0 +1,297 @@
+#include "polygon_clip.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace pc {
+namespace check {
+
+constexpr float kPi = 3.14159265358979f;
+
+const char *const kPath = "file_check.pcpf";
+
+static Polygon star(std::mt19937 &rng, int spikes, Point center) {
+  std::vector<Point> points;
+
+  for (int i = 0; i < spikes * 2; i++) {
+    float a = kPi * i / spikes;
+    float r = i % 2 == 0 ? 6.f + static_cast<float>(rng() % 1000) / 250.f
+                         : 3.f;
+
+    points.emplace_back(center.x + r * std::cos(a), center.y + r * std::sin(a));
+  }
+
+  Polygon polygon;
+  polygon.append_vertices(points);
+
+  return polygon;
+}
+
+/**
+ * A star with more edges than one index node holds, a square with a hole and
+ * a triangle
+ */
+static std::vector<Polygon> sample_polygons() {
+  std::mt19937 rng(3);
+
+  std::vector<Polygon> polygons;
+  polygons.emplace_back(star(rng, 40, Point(0.f, 0.f)));
+
+  Polygon square;
+  square.append_vertices({Point(-8.f, -8.f), Point(8.f, -8.f), Point(8.f, 8.f),
+                          Point(-8.f, 8.f)});
+  square.append_vertices({Point(-2.f, -2.f), Point(-2.f, 2.f), Point(2.f, 2.f),
+                          Point(2.f, -2.f)});
+  polygons.emplace_back(std::move(square));
+
+  Polygon triangle;
+  triangle.append_vertices({Point(1.f, 1.f), Point(9.f, 2.f), Point(4.f, 7.f)});
+  polygons.emplace_back(std::move(triangle));
+
+  return polygons;
+}
+
+static bool write_file(const std::vector<Polygon> &polygons, bool index) {
+  PolygonFileWriter writer;
+  if (!writer.open(kPath, index)) {
+    return false;
+  }
+
+  for (const auto &polygon : polygons) {
+    if (!writer.write(polygon)) {
+      return false;
+    }
+  }
+
+  return writer.close();
+}
+
+static std::vector<char> read_bytes() {
+  std::ifstream in(kPath, std::ios::binary);
+
+  return std::vector<char>(std::istreambuf_iterator<char>(in),
+                           std::istreambuf_iterator<char>());
+}
+
+static void write_bytes(const std::vector<char> &bytes, size_t size) {
+  std::ofstream out(kPath, std::ios::binary | std::ios::trunc);
+  out.write(bytes.data(), static_cast<std::streamsize>(size));
+}
+
+static bool same_rect(const Rect &a, const Rect &b) {
+  return a.left_top.x == b.left_top.x && a.left_top.y == b.left_top.y &&
+         a.right_bottom.x == b.right_bottom.x &&
+         a.right_bottom.y == b.right_bottom.y;
+}
+
+/**
+ * Whether a and b cover the same sample points
+ */
+static bool same_region(const Polygon &a, const Polygon &b) {
+  for (float y = -12.37f; y < 12.f; y += 0.83f) {
+    for (float x = -12.29f; x < 12.f; x += 0.79f) {
+      if (a.contains(Point(x, y)) != b.contains(Point(x, y))) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+static PolygonBuffer window() {
+  Polygon polygon;
+  polygon.append_vertices({Point(-5.f, -3.f), Point(7.f, -5.f),
+                           Point(6.f, 6.f), Point(-4.f, 5.f)});
+
+  PolygonBuffer buffer;
+  buffer.append(polygon);
+
+  return buffer;
+}
+
+/**
+ * Write polygons and read them back, every record must come back unchanged
+ * and with index the stored edge index must give the same results as none
+ */
+static int check_round_trip(const std::vector<Polygon> &polygons, bool index) {
+  if (!write_file(polygons, index)) {
+    std::printf("index %d: cannot write the file\n", index ? 1 : 0);
+    return 1;
+  }
+
+  PolygonFile file;
+  if (!file.open(kPath) || file.polygon_count() != polygons.size() ||
+      file.has_index() != index) {
+    std::printf("index %d: cannot read the file back\n", index ? 1 : 0);
+    return 1;
+  }
+
+  auto clipping = window();
+
+  int wrong = 0;
+
+  for (size_t i = 0; i < polygons.size(); i++) {
+    PolygonBuffer expected;
+    expected.append(polygons[i]);
+
+    auto view = file.view(i);
+    bool same = view.ring_count == expected.view().ring_count &&
+                view.vertex_count() == expected.view().vertex_count();
+
+    for (size_t r = 0; same && r <= view.ring_count; r++) {
+      same = view.ring_offsets[r] == expected.ring_offsets[r];
+    }
+    for (size_t k = 0; same && k < view.vertex_count(); k++) {
+      same = view.point(k).x == expected.coords[2 * k] &&
+             view.point(k).y == expected.coords[2 * k + 1];
+    }
+
+    const auto &sub_bounds = polygons[i].get_sub_bounds();
+    for (size_t r = 0; same && r < sub_bounds.size(); r++) {
+      same = same_rect(file.get_sub_bounds(i)[r], sub_bounds[r]);
+    }
+    same = same && same_rect(*file.get_bounds(i), *polygons[i].get_bounds());
+
+    auto indexed = file.indexed_view(i);
+    same = same && (indexed.index != nullptr) == index &&
+           same_region(Polygon::Clip(indexed, clipping.view()),
+                       Polygon::Clip(expected.view(), clipping.view())) &&
+           same_region(Polygon::Diff(indexed, clipping.view()),
+                       Polygon::Diff(expected.view(), clipping.view()));
+
+    if (!same) {
+      std::printf("index %d: polygon %zu differs after the round trip\n",
+                  index ? 1 : 0, i);
+      wrong++;
+    }
+  }
+
+  return wrong;
+}
+
+/**
+ * Read everything an opened file hands out. Views of a damaged file may hold
+ * other coordinates, but their rings must be well formed, and an edge index
+ * accepted with them must give the same results as none.
+ */
+static bool read_all(const PolygonFile &file) {
+  auto clipping = window();
+
+  for (size_t i = 0; i < file.polygon_count(); i++) {
+    auto view = file.view(i);
+
+    for (size_t r = 0; r < view.ring_count; r++) {
+      if (view.ring_offsets[r + 1] < view.ring_offsets[r] + 3) {
+        return false;
+      }
+    }
+
+    // damaged coordinates may be anything, only sane ones are clipped
+    bool finite = true;
+    for (size_t k = 0; k < view.vertex_count(); k++) {
+      auto p = view.point(k);
+      finite = finite && std::fabs(p.x) < 1e6f && std::fabs(p.y) < 1e6f;
+    }
+
+    if (view.ring_count > 0) {
+      file.get_bounds(i);
+      file.get_sub_bounds(i);
+    }
+
+    auto indexed = file.indexed_view(i);
+    if (finite && indexed.index &&
+        !same_region(Polygon::Clip(indexed, clipping.view()),
+                     Polygon::Clip(view, clipping.view()))) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * Every shorter prefix of a file must be refused, and every byte of the
+ * header, the tables and the index set to a few other values must either be
+ * refused or read back as well formed polygons.
+ */
+static int check_damaged(const std::vector<Polygon> &polygons, bool index) {
+  if (!write_file(polygons, index)) {
+    std::printf("index %d: cannot write the file\n", index ? 1 : 0);
+    return 1;
+  }
+
+  auto bytes = read_bytes();
+
+  int wrong = 0;
+
+  for (size_t size = 0; size < bytes.size(); size++) {
+    write_bytes(bytes, size);
+
+    PolygonFile file;
+    if (file.open(kPath)) {
+      std::printf("index %d: file cut to %zu of %zu bytes is read\n",
+                  index ? 1 : 0, size, bytes.size());
+      wrong++;
+    }
+  }
+
+  int accepted = 0;
+
+  for (size_t at = 0; at < bytes.size(); at++) {
+    auto original = static_cast<unsigned char>(bytes[at]);
+
+    for (unsigned char value : {0x00, 0xff, original ^ 0x01}) {
+      if (value == original) {
+        continue;
+      }
+
+      auto damaged = bytes;
+      damaged[at] = static_cast<char>(value);
+      write_bytes(damaged, damaged.size());
+
+      PolygonFile file;
+      if (!file.open(kPath)) {
+        continue;
+      }
+
+      accepted++;
+
+      if (!read_all(file)) {
+        std::printf("index %d: byte %zu set to %d is read wrongly\n",
+                    index ? 1 : 0, at, value);
+        wrong++;
+      }
+    }
+  }
+
+  std::printf("index %d: %zu bytes, %d damaged files accepted\n",
+              index ? 1 : 0, bytes.size(), accepted);
+
+  return wrong;
+}
+
+} // namespace check
+} // namespace pc
+
+int main() {
+  auto polygons = pc::check::sample_polygons();
+
+  int wrong = 0;
+
+  for (bool index : {false, true}) {
+    wrong += pc::check::check_round_trip(polygons, index);
+    wrong += pc::check::check_damaged(polygons, index);
+  }
+
+  std::remove(pc::check::kPath);
+
+  std::printf("binary files: %d wrong\n", wrong);
+
+  return wrong == 0 ? 0 : 1;
+}